@@ -30,6 +30,9 @@ var isStandby = false;      // TRUE = Device is in standby (display is off)
 var z_index = 0;            // Draw order of elements
 var panelID = 0;            // The ID of the panel in the range from 10000 to 11000
 var hdOffTimer = null;
+var pingCounter = 0;        // Number of the last PING sent to the server
+var pingRtt = -1;           // Round trip time of the last PING in milliseconds
+var pingTimer = null;
 var __debug = true;         // TRUE = Display debugging messages
 var __errlog = true;        // TRUE = Display error messages
 var __TRACE = true;         // TRUE = Display trace messages
@@ -185,7 +188,7 @@ var cmdArray = {
         { "cmd": "#REG-", "call": doREG },
 		{ "cmd": "#ERR-", "call": doERR },
 		{ "cmd": "#FTR-", "call": doFTR },
-        { "cmd": "#PONG-", "call": unsupported }
+        { "cmd": "#PONG-", "call": doPONG }
     ]
 };
 
@@ -350,77 +353,113 @@ function iterateButtonStates(addr, bts, callback, pars, port = true)
     }
 }
 
+var __buttonCache = {};     // Page number --> { button ID --> button }
+
 function getButton(pnum, bi)
 {
-    var pgKey = eval("structPage" + pnum);
-
-    if (pgKey === null)
-        return null;
+    var cache = __buttonCache[pnum];
 
-    for (var i in pgKey.buttons)
+    if (typeof cache == "undefined")
     {
-        if (pgKey.buttons[i].bID == bi)
-            return pgKey.buttons[i];
+        var pgKey = eval("structPage" + pnum);
+
+        if (pgKey === null)
+            return null;
+
+        cache = {};
+
+        for (var i in pgKey.buttons)
+        {
+            if (typeof cache[pgKey.buttons[i].bID] == "undefined")
+                cache[pgKey.buttons[i].bID] = pgKey.buttons[i];
+        }
+
+        __buttonCache[pnum] = cache;
     }
 
-    return null;
+    var button = cache[bi];
+    return (typeof button == "undefined") ? null : button;
 }
 
-function getBargraphLevel(pnum, id)
+/*
+ * Returns the positions stored in one of the lookup tables written by the
+ * server (buttonIndex, bargraphIndex). The key consists of 2 numbers, like
+ * port and channel. If there is no table, null is returned and the caller
+ * must scan the whole array.
+ */
+function indexLookup(table, name, a, b)
 {
+    if (typeof table == "undefined" || table === null || typeof table[name] != "object")
+        return null;
+
+    var pos = table[name][a + "," + b];
+
+    if (typeof pos == "undefined")
+        return [];
+
+    return pos;
+}
+
+function findBargraphDistinct(pnum, id)
+{
+    var idx = indexLookup((typeof bargraphIndex == "undefined") ? null : bargraphIndex, "bt", pnum, id);
+
+    if (idx !== null)
+        return (idx.length > 0) ? bargraphs.bargraphs[idx[0]] : null;
+
     for (var i in bargraphs.bargraphs)
     {
         var bg = bargraphs.bargraphs[i];
 
         if (bg.pnum == pnum && bg.bi == id)
-            return bg.level;
+            return bg;
     }
 
+    return null;
+}
+
+function getBargraphLevel(pnum, id)
+{
+    var bg = findBargraphDistinct(pnum, id);
+
+    if (bg !== null)
+        return bg.level;
+
     return 0;
 }
 
 function getBargraphPC(pnum, id)
 {
-    for (var i in bargraphs.bargraphs)
-    {
-        var bg = bargraphs.bargraphs[i];
+    var bg = findBargraphDistinct(pnum, id);
 
-        if (bg.pnum == pnum && bg.bi == id)
-            return [bg.lp, bg.lv];
-    }
+    if (bg !== null)
+        return [bg.lp, bg.lv];
 
     return -1;
 }
 
 function getBargraphPars(pnum, id)
 {
-    for (var i in bargraphs.bargraphs)
-    {
-        var bg = bargraphs.bargraphs[i];
+    var bg = findBargraphDistinct(pnum, id);
 
-        if (bg.pnum == pnum && bg.bi == id)
-            return bg;
-    }
+    if (bg !== null)
+        return bg;
 
     return -1;
 }
 
 function setBargraphLevel(pnum, id, level)
 {
-    var PC = getBargraphPC(pnum, id);
+    var bg = findBargraphDistinct(pnum, id);
 
-    if (PC === -1)
+    if (bg === null)
         return;
 
-    for (var i in bargraphs.bargraphs)
-    {
-        var bg = bargraphs.bargraphs[i];
+    bg.level = level;
+    var bgArray = findBargraphs(bg.lp, bg.lv);
 
-        if (bg.lp == PC[0] && bg.lv == PC[1])
-            bargraphs.bargraphs[i].level = level;
-        else if (bg.pnum == pnum && bg.bi == id)
-            bargraphs.bargraphs[i].level = level;
-    }
+    for (var i in bgArray)
+        bgArray[i].level = level;
 }
 
 function getField(msg, field, sep)
@@ -701,6 +740,15 @@ function findPageGroup(name)
 function findButton(num)
 {
     var btArray = [];
+    var idx = indexLookup((typeof buttonIndex == "undefined") ? null : buttonIndex, "ch", curPort, num);
+
+    if (idx !== null)
+    {
+        for (var i in idx)
+            btArray.push(buttonArray.buttons[idx[i]]);
+
+        return btArray;
+    }
 
     for (var i in buttonArray.buttons)
     {
@@ -716,6 +764,15 @@ function findButton(num)
 function findButtonPort(num)
 {
     var btArray = [];
+    var idx = indexLookup((typeof buttonIndex == "undefined") ? null : buttonIndex, "ad", curPort, num);
+
+    if (idx !== null)
+    {
+        for (var i in idx)
+            btArray.push(buttonArray.buttons[idx[i]]);
+
+        return btArray;
+    }
 
     for (var i in buttonArray.buttons)
     {
@@ -730,6 +787,11 @@ function findButtonPort(num)
 
 function findButtonDistinct(pnum, bi)
 {
+    var idx = indexLookup((typeof buttonIndex == "undefined") ? null : buttonIndex, "bt", pnum, bi);
+
+    if (idx !== null)
+        return (idx.length > 0) ? buttonArray.buttons[idx[0]] : null;
+
     for (var i in buttonArray.buttons)
     {
         var bt = buttonArray.buttons[i];
@@ -745,6 +807,15 @@ function findBargraphs(port, channel)
 {
     var i;
     var bgArray = [];
+    var idx = indexLookup((typeof bargraphIndex == "undefined") ? null : bargraphIndex, "lv", port, channel);
+
+    if (idx !== null)
+    {
+        for (i in idx)
+            bgArray.push(bargraphs.bargraphs[idx[i]]);
+
+        return bgArray;
+    }
 
     for (i in bargraphs.bargraphs)
     {
@@ -1326,9 +1397,12 @@ function textToWeb(txt)
 
 function setON(msg)
 {
-    var b;
+    setChannelON(getField(msg, 0, ','));
+}
 
-    var addr = getField(msg, 0, ',');
+function setChannelON(addr)
+{
+    var b;
     var bt = findButton(addr);
 
     if (bt.length == 0)
@@ -1368,9 +1442,12 @@ function setON(msg)
 
 function setOFF(msg)
 {
-    var b;
+    setChannelOFF(getField(msg, 0, ','));
+}
 
-    var addr = getField(msg, 0, ',');
+function setChannelOFF(addr)
+{
+    var b;
     var bt = findButton(addr);
 
     if (bt.length == 0)
@@ -1411,8 +1488,11 @@ function setOFF(msg)
 
 function setLEVEL(msg)
 {
-    var addr = getField(msg, 0, ',');
-    var level = getField(msg, 1, ',');
+    setLevelValue(getField(msg, 0, ','), getField(msg, 1, ','));
+}
+
+function setLevelValue(addr, level)
+{
     var bgArray = findBargraphs(curPort, addr);
 
     for (var i in bgArray)
@@ -4644,19 +4724,160 @@ function doREG(msg)
     {
         regStatus = true;
         writeTextOut("PANEL:"+panelID+":"+regID);
+
+        if (pingTimer === null)
+            pingTimer = window.setInterval(sendPing, 30000);
     }
     else
         regStatus = false;
 }
 
+/*
+ * Sends a PING to the server. The round trip time of the previous PING is
+ * appended, so the server can collect the times of all browsers.
+ */
+function sendPing()
+{
+    if (!regStatus || wsocket.readyState != WebSocket.OPEN)
+        return;
+
+    pingCounter++;
+    var msg = "PING:" + panelID + ":" + pingCounter + ":" + new Date().getTime();
+
+    if (pingRtt >= 0)
+        msg = msg + ":" + pingRtt;
+
+    writeTextOut(msg);
+}
+
+function doPONG(msg)
+{
+    var counter = parseInt(getField(msg, 1, ','));
+    var time = parseInt(getField(msg, 2, ','));
+
+    if (isNaN(time) || counter != pingCounter)
+        return;
+
+    pingRtt = new Date().getTime() - time;
+}
+
 function parseMessage(msg)
 {
+    if (typeof msg != "string")
+    {
+        parseBinary(msg);
+        return;
+    }
+
+    // Several messages in one frame are sent as a JSON array.
+    if (msg.charAt(0) == '[')
+    {
+        try
+        {
+            var msgs = JSON.parse(msg);
+
+            for (var i = 0; i < msgs.length; i++)
+                parseMessage(msgs[i]);
+        }
+        catch (e)
+        {
+            errlog("parseMessage: Invalid batch: " + e);
+        }
+
+        return;
+    }
+
     TRACE("parseMessage: " + msg);
     var pID = splittCmd(msg);
 
     if ((pID <= 32000 || pID >= 34000) && pID != panelID)
         return;
 
+    dispatchCommand();
+}
+
+/*
+ * Decodes a binary frame. The server sends them instead of text, after it
+ * was asked with "PROTO:BIN". All numbers are in network byte order.
+ * Every frame starts with the type (1 byte), the panel ID (2 bytes) and the
+ * port (2 bytes). A BATCH frame has only the type. It contains several
+ * frames, each with its length (2 bytes) in front.
+ */
+const BIN_TYPE = Object.freeze({
+    ON: 1,              // channel (2 bytes)
+    OFF: 2,             // channel (2 bytes)
+    LEVEL_INT: 3,       // level (2 bytes), value (signed 32 bit)
+    LEVEL_FLOAT: 4,     // level (2 bytes), value (64 bit float)
+    COMMAND: 5,         // command (UTF-8) up to the end of the frame
+    BATCH: 6            // frames, each as length (2 bytes) and frame
+});
+
+var binDecoder = (typeof TextDecoder != "undefined") ? new TextDecoder("utf-8") : null;
+
+function parseBinary(buf)
+{
+    if (!(buf instanceof ArrayBuffer) || buf.byteLength < 1)
+        return;
+
+    var view = new DataView(buf);
+    var type = view.getUint8(0);
+
+    if (type == BIN_TYPE.BATCH)
+    {
+        var pos = 1;
+
+        while (pos + 2 <= buf.byteLength)
+        {
+            var len = view.getUint16(pos);
+            parseBinary(buf.slice(pos + 2, pos + 2 + len));
+            pos += 2 + len;
+        }
+
+        return;
+    }
+
+    if (buf.byteLength < 5)
+        return;
+
+    var pID = view.getUint16(1);
+
+    if (pID != panelID)
+        return;
+
+    curPort = view.getUint16(3);
+
+    if (_BLOCK_ALL)
+        return;
+
+    try
+    {
+        switch (type)
+        {
+            case BIN_TYPE.ON: setChannelON(view.getUint16(5)); break;
+            case BIN_TYPE.OFF: setChannelOFF(view.getUint16(5)); break;
+            case BIN_TYPE.LEVEL_INT: setLevelValue(view.getUint16(5), view.getInt32(7)); break;
+            case BIN_TYPE.LEVEL_FLOAT: setLevelValue(view.getUint16(5), view.getFloat64(7)); break;
+
+            case BIN_TYPE.COMMAND:
+                if (binDecoder === null)
+                    return;
+
+                curCommand = binDecoder.decode(new Uint8Array(buf, 5));
+                dispatchCommand();
+            break;
+
+            default:
+                errlog("parseBinary: Unknown frame type " + type + "!");
+        }
+    }
+    catch (e)
+    {
+        errlog("parseBinary: Error: " + e);
+    }
+}
+
+function dispatchCommand()
+{
     for (var i in cmdArray.commands)
     {
         try
@@ -5156,6 +5377,92 @@ function checkTime(i)
     return i;
 }
 
+/*
+ * The clock and date buttons (system reserved addresses 141 to 158) are all
+ * updated by one timer. It ticks once a second, formats every registered
+ * format once and writes the result to all elements of that format.
+ */
+var __clockWeekdays = ['Sunday', 'Monday', 'Tuesday', 'Wednesday', 'Thursday', 'Friday', 'Saturday'];
+var __clockMonths = ['January', 'February', 'March', 'April', 'May', 'June', 'July', 'August', 'September', 'October', 'November', 'December'];
+var __clockFormats = {
+    141: function(d) { return checkTime(d.getHours()) + ":" + checkTime(d.getMinutes()) + ":" + checkTime(d.getSeconds()); },
+    142: function(d) {
+        var h = d.getHours();
+        var s = (h >= 12) ? "PM" : "AM";
+        h = h % 12;
+
+        if (h == 0)
+            h = 12;
+
+        return checkTime(h) + ":" + checkTime(d.getMinutes()) + " " + s;
+    },
+    143: function(d) { return checkTime(d.getHours()) + ":" + checkTime(d.getMinutes()); },
+    151: function(d) { return __clockWeekdays[d.getDay()]; },
+    152: function(d) { return checkTime(d.getMonth() + 1) + '/' + checkTime(d.getDate()); },
+    153: function(d) { return checkTime(d.getDate()) + '/' + checkTime(d.getMonth() + 1); },
+    154: function(d) { return checkTime(d.getMonth() + 1) + '/' + checkTime(d.getDate()) + '/' + d.getFullYear(); },
+    155: function(d) { return checkTime(d.getDate()) + '/' + checkTime(d.getMonth() + 1) + '/' + d.getFullYear(); },
+    156: function(d) { return __clockMonths[d.getMonth()] + ' ' + checkTime(d.getDate()) + ', ' + d.getFullYear(); },
+    157: function(d) { return checkTime(d.getDate()) + ' ' + __clockMonths[d.getMonth()] + ', ' + d.getFullYear(); },
+    158: function(d) { return d.getFullYear() + '-' + checkTime(d.getMonth() + 1) + '-' + checkTime(d.getDate()); }
+};
+var __clockElements = {};   // address --> { element ID --> { "elem":element, "text":last text } }
+var __clockTimer = null;
+
+function registerClock(addr, ids)
+{
+    if (typeof __clockFormats[addr] != "function")
+    {
+        errlog("registerClock: Unknown clock address " + addr + "!");
+        return;
+    }
+
+    if (typeof __clockElements[addr] == "undefined")
+        __clockElements[addr] = {};
+
+    for (var i in ids)
+    {
+        if (typeof __clockElements[addr][ids[i]] == "undefined")
+            __clockElements[addr][ids[i]] = { "elem":null, "text":"" };
+    }
+
+    if (__clockTimer === null)
+        clockTick();
+}
+
+function clockTick()
+{
+    var now = new Date();
+
+    for (var addr in __clockElements)
+    {
+        var text = __clockFormats[addr](now);
+        var list = __clockElements[addr];
+
+        for (var id in list)
+        {
+            var entry = list[id];
+
+            // Pages are created and removed on demand, so the element may
+            // have changed since the last tick.
+            if (entry.elem === null || !entry.elem.isConnected)
+            {
+                entry.elem = document.getElementById(id);
+                entry.text = "";
+            }
+
+            if (entry.elem === null || entry.text == text)
+                continue;
+
+            entry.elem.innerHTML = text;
+            entry.text = text;
+        }
+    }
+
+    // Next tick at the start of the next second
+    __clockTimer = setTimeout(clockTick, 1000 - now.getMilliseconds());
+}
+
 function setSystemBattery(hook = false)
 {
     var battery = navigator.battery || navigator.webkitBattery || navigator.mozBattery || navigator.msBattery;
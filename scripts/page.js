@@ -894,11 +894,17 @@ function doDraw(pgKey, pageID, what)
 	if (pgKey.timeout > 0)
 		window.setTimeout(tmPPT.bind(null, pgKey.name), pgKey.timeout * 100);
 
-	page.style.position = "absolute";
-	page.style.left = pgKey.left+"px";
-	page.style.top = pgKey.top+"px";
-	page.style.width = pgKey.width+"px";
-	page.style.height = pgKey.height+"px";
+	// The shared CSS classes in amxpanel.css contain position and size.
+	if (typeof pgKey.cls == "string" && pgKey.cls.length > 0)
+		page.className = pgKey.cls;
+	else
+	{
+		page.style.position = "absolute";
+		page.style.left = pgKey.left+"px";
+		page.style.top = pgKey.top+"px";
+		page.style.width = pgKey.width+"px";
+		page.style.height = pgKey.height+"px";
+	}
 
 	if (pgKey.showEffect > 0 && pgKey.showTime > 0)
 		setShowAnimation(pgKey.name);
@@ -971,14 +977,20 @@ function doDraw(pgKey, pageID, what)
 			var bt = document.createElement('div');
 			bt.id = "Page_"+pageID+"_Button_"+button.bID;
 			page.appendChild(bt);
-			bt.style.position = "absolute";
-			bt.style.left = button.lt+"px";
-			bt.style.top = button.tp+"px";
-			bt.style.width = button.wt+"px";
-			bt.style.height = button.ht+"px";
 
-			if (button.hs == "bounding")
-				bt.style.overflow = "hidden";
+			if (typeof button.cls == "string" && button.cls.length > 0)
+				bt.className = button.cls;
+			else
+			{
+				bt.style.position = "absolute";
+				bt.style.left = button.lt+"px";
+				bt.style.top = button.tp+"px";
+				bt.style.width = button.wt+"px";
+				bt.style.height = button.ht+"px";
+
+				if (button.hs == "bounding")
+					bt.style.overflow = "hidden";
+			}
 
 			if (button.hs != "passThru")
 			{
@@ -1205,9 +1217,8 @@ function doDraw(pgKey, pageID, what)
 				bsr.style.position = "absolute";
 				bsr.style.left = "0px";
 				bsr.style.top = "0px";
-				bsr.style.width = bt.style.width;
-				bsr.style.height = bt.style.height;
-				bsr.style.opacity = 1.0 / 255.0 * sr.oo;
+				bsr.style.width = button.wt+"px";
+				bsr.style.height = button.ht+"px";
 				bt.appendChild(bsr);
 				var nm;
 
@@ -1217,34 +1228,42 @@ function doDraw(pgKey, pageID, what)
 					nm = "Page_"+pageID+"_Button_"+button.bID+"_"
 
 				bsr.id = nm+sr.number;
-				bsr.style.color = getWebColor(sr.ct);
 
-				if (sr.mi.length == 0 || sr.bs.length > 0)
-					bsr.style.backgroundColor = getWebColor(sr.cf);
-
-				if (sr.bs.length > 0)		// Border
+				// The shared CSS class in amxpanel.css contains the skin of the state.
+				if (typeof sr.cls == "string" && sr.cls.length > 0)
+					bsr.className = sr.cls;
+				else
 				{
-					var brd = getBorderStyle(sr.bs);
+					bsr.style.opacity = 1.0 / 255.0 * sr.oo;
+					bsr.style.color = getWebColor(sr.ct);
+
+					if (sr.mi.length == 0 || sr.bs.length > 0)
+						bsr.style.backgroundColor = getWebColor(sr.cf);
 
-					if (brd !== -1)
+					if (sr.bs.length > 0)		// Border
 					{
-						for (var x = 0; x < brd.length; x++)
+						var brd = getBorderStyle(sr.bs);
+
+						if (brd !== -1)
 						{
-							switch(x)
+							for (var x = 0; x < brd.length; x++)
 							{
-								case 0: bsr.style.borderStyle = brd[x]; break;
-								case 1: bsr.style.borderWidth = brd[x]; break;
-								case 2: bsr.style.borderRadius = brd[x]; break;
+								switch(x)
+								{
+									case 0: bsr.style.borderStyle = brd[x]; break;
+									case 1: bsr.style.borderWidth = brd[x]; break;
+									case 2: bsr.style.borderRadius = brd[x]; break;
+								}
 							}
-						}
 
-						bsr.style.borderColor = getWebColor(sr.cb);
+							bsr.style.borderColor = getWebColor(sr.cb);
+						}
+						else
+							bsr.style.border = "none";
 					}
 					else
 						bsr.style.border = "none";
 				}
-				else
-					bsr.style.border = "none";
 
 				var idx = parseInt(j);
 
@@ -1394,9 +1413,6 @@ function doDraw(pgKey, pageID, what)
 				{
 					var fnt = document.createElement('span');
 					fnt.id = nm+sr.number+'_font';
-					fnt.style.position = "absolute";
-					fnt.style.paddingLeft = "4px";
-					fnt.style.paddingRight = "4px";
 					var border = getBorderSize(sr.bs);
 
 					if (sr.jt != TEXT_ORIENTATION.ORI_ABSOLUT)
@@ -1405,32 +1421,41 @@ function doDraw(pgKey, pageID, what)
 						fnt.style.height = bsr.style.height - border * 2;
 					}
 
-					// Clipping
-					fnt.style.overflow = "hidden";
-					fnt.style.textOverflow = "clip";
-					// Prevent text from being selected.
-					fnt.style.webkitTouchCallout = 'none';
-					fnt.style.webkitUserSelect = 'none';
-					fnt.style.khtmlUserSelect = 'none';
-					fnt.style.mozUserSelect = 'none';
-					fnt.style.userSelect = 'none';
-					// A text receives no pointer events
-					fnt.style.pointerEvents = 'none';
-					// The font
-					fnt.style.fontFamily = "\""+font.name+"\"";
-					fnt.style.fontSize = font.size+"pt";
-					fnt.style.fontStyle = getFontStyle(font.subfamilyName);
-					fnt.style.fontWeight = getFontWeight(font.subfamilyName);
-
-					if (sr.ww != 0)		// line break
-					{
-						fnt.style.wordWrap = "break-word";
-						fnt.style.wordBreak = "break-all";
-					}
+					// The shared CSS class in amxpanel.css contains the font and the text effect.
+					if (typeof sr.fcls == "string" && sr.fcls.length > 0)
+						fnt.className = sr.fcls;
 					else
 					{
-						fnt.style.wordWrap = "normal";
-						fnt.style.wordBreak = "keep-all";
+						fnt.style.position = "absolute";
+						fnt.style.paddingLeft = "4px";
+						fnt.style.paddingRight = "4px";
+						// Clipping
+						fnt.style.overflow = "hidden";
+						fnt.style.textOverflow = "clip";
+						// Prevent text from being selected.
+						fnt.style.webkitTouchCallout = 'none';
+						fnt.style.webkitUserSelect = 'none';
+						fnt.style.khtmlUserSelect = 'none';
+						fnt.style.mozUserSelect = 'none';
+						fnt.style.userSelect = 'none';
+						// A text receives no pointer events
+						fnt.style.pointerEvents = 'none';
+						// The font
+						fnt.style.fontFamily = "\""+font.name+"\"";
+						fnt.style.fontSize = font.size+"pt";
+						fnt.style.fontStyle = getFontStyle(font.subfamilyName);
+						fnt.style.fontWeight = getFontWeight(font.subfamilyName);
+
+						if (sr.ww != 0)		// line break
+						{
+							fnt.style.wordWrap = "break-word";
+							fnt.style.wordBreak = "break-all";
+						}
+						else
+						{
+							fnt.style.wordWrap = "normal";
+							fnt.style.wordBreak = "keep-all";
+						}
 					}
 
 					bsr.appendChild(fnt);
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include "allocstats.h"
+
+#ifdef _ALLOCSTATS
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <new>
+#include <cstdlib>
+#include <unistd.h>
+#include "syslog.h"
+#include "metrics.h"
+
+extern Syslog *sysl;
+extern std::atomic<bool> killed;
+
+using namespace std;
+using namespace amx;
+
+namespace
+{
+	/*
+	 * The counters are constant initialized, so they are valid for the
+	 * allocations made before main() is called. Each subsystem has its own
+	 * cache line.
+	 */
+	struct alignas(64) ALLOC_COUNT
+	{
+		atomic<uint64_t> count{0};
+		atomic<uint64_t> bytes{0};
+	};
+
+	ALLOC_COUNT allocCounts[AT_COUNT];
+	thread_local ALLOC_TAG_T currentTag = AT_OTHER;
+
+	Counter *mCount[AT_COUNT];
+	Counter *mBytes[AT_COUNT];
+	uint64_t exported[AT_COUNT][2];		// Values already added to the metrics
+	mutex collectMut;
+}
+
+amx::AllocTag::AllocTag(ALLOC_TAG_T tag)
+	: previous(currentTag)
+{
+	currentTag = tag;
+}
+
+amx::AllocTag::~AllocTag()
+{
+	currentTag = previous;
+}
+
+void amx::AllocStats::count(size_t size)
+{
+	ALLOC_COUNT& ac = allocCounts[currentTag];
+	ac.count.fetch_add(1, memory_order_relaxed);
+	ac.bytes.fetch_add(size, memory_order_relaxed);
+}
+
+uint64_t amx::AllocStats::getCount(ALLOC_TAG_T tag)
+{
+	return allocCounts[tag].count.load(memory_order_relaxed);
+}
+
+uint64_t amx::AllocStats::getBytes(ALLOC_TAG_T tag)
+{
+	return allocCounts[tag].bytes.load(memory_order_relaxed);
+}
+
+const char *amx::AllocStats::getName(ALLOC_TAG_T tag)
+{
+	switch (tag)
+	{
+		case AT_OTHER:		return "other";
+		case AT_AMXNET:		return "amxnet";
+		case AT_DISPATCH:	return "dispatch";
+		case AT_WEBSOCKET:	return "websocket";
+		case AT_PAGEGEN:	return "pagegen";
+		case AT_LOGGING:	return "logging";
+		case AT_COUNT:		break;
+	}
+
+	return "unknown";
+}
+
+/*
+ * Registers the counters with the metrics and starts the thread writing
+ * the summary into the log every "interval" seconds (0 = never).
+ */
+void amx::AllocStats::start(int interval)
+{
+	for (int i = 0; i < AT_COUNT; i++)
+	{
+		string lbl = string("subsystem=\"")+getName((ALLOC_TAG_T)i)+"\"";
+		mCount[i] = Metrics::get().counter("amxpanel_allocations_total", lbl, "Heap allocations by subsystem");
+		mBytes[i] = Metrics::get().counter("amxpanel_allocated_bytes_total", lbl, "Bytes allocated on the heap by subsystem");
+	}
+
+	Metrics::get().addCollector(collect);
+
+	if (interval <= 0)
+		return;
+
+	try
+	{
+		thread thr = thread([=] { run(interval); });
+		thr.detach();
+	}
+	catch (std::exception& e)
+	{
+		sysl->errlog(string("AllocStats::start: Error starting the thread: ")+e.what());
+	}
+}
+
+/*
+ * Called by the metrics before they are exported. The counters of the
+ * metrics only grow, so the difference to the last call is added.
+ */
+void amx::AllocStats::collect()
+{
+	lock_guard<mutex> lock(collectMut);
+
+	for (int i = 0; i < AT_COUNT; i++)
+	{
+		uint64_t c = getCount((ALLOC_TAG_T)i);
+		uint64_t b = getBytes((ALLOC_TAG_T)i);
+		mCount[i]->inc(c - exported[i][0]);
+		mBytes[i]->inc(b - exported[i][1]);
+		exported[i][0] = c;
+		exported[i][1] = b;
+	}
+}
+
+void amx::AllocStats::run(int interval)
+{
+	ALLOC_TAG(AT_LOGGING);
+	uint64_t last[AT_COUNT][2] = {};
+
+	while (!killed)
+	{
+		sleep(interval);
+		string msg = "AllocStats: Allocations in the last "+to_string(interval)+" seconds:";
+
+		for (int i = 0; i < AT_COUNT; i++)
+		{
+			uint64_t c = getCount((ALLOC_TAG_T)i);
+			uint64_t b = getBytes((ALLOC_TAG_T)i);
+			msg += string(" ")+getName((ALLOC_TAG_T)i)+"="+to_string(c - last[i][0])+" ("+to_string((b - last[i][1]) / 1024)+" KB)";
+			last[i][0] = c;
+			last[i][1] = b;
+		}
+
+		sysl->log(Syslog::INFO, msg);
+	}
+}
+
+/*
+ * Replacements of the global operator new and delete.
+ */
+void *operator new(size_t size)
+{
+	AllocStats::count(size);
+	void *p = malloc(size ? size : 1);
+
+	if (!p)
+		throw bad_alloc();
+
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(size_t size, const nothrow_t&) noexcept
+{
+	AllocStats::count(size);
+	return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const nothrow_t&) noexcept
+{
+	AllocStats::count(size);
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept				{ free(p); }
+void operator delete[](void *p) noexcept			{ free(p); }
+void operator delete(void *p, size_t) noexcept		{ free(p); }
+void operator delete[](void *p, size_t) noexcept	{ free(p); }
+void operator delete(void *p, const nothrow_t&) noexcept	{ free(p); }
+void operator delete[](void *p, const nothrow_t&) noexcept	{ free(p); }
+
+/*
+ * The overloads for over-aligned types (alignas() bigger than the default
+ * alignment). posix_memalign() needs an alignment of at least the size of
+ * a pointer. Its memory is released by free() as well.
+ */
+static void *alignedAlloc(size_t size, align_val_t al) noexcept
+{
+	size_t align = (size_t)al;
+	void *p = nullptr;
+
+	if (align < sizeof(void *))
+		align = sizeof(void *);
+
+	if (posix_memalign(&p, align, size ? size : 1) != 0)
+		return nullptr;
+
+	return p;
+}
+
+void *operator new(size_t size, align_val_t al)
+{
+	AllocStats::count(size);
+	void *p = alignedAlloc(size, al);
+
+	if (!p)
+		throw bad_alloc();
+
+	return p;
+}
+
+void *operator new[](size_t size, align_val_t al)
+{
+	return operator new(size, al);
+}
+
+void *operator new(size_t size, align_val_t al, const nothrow_t&) noexcept
+{
+	AllocStats::count(size);
+	return alignedAlloc(size, al);
+}
+
+void *operator new[](size_t size, align_val_t al, const nothrow_t&) noexcept
+{
+	AllocStats::count(size);
+	return alignedAlloc(size, al);
+}
+
+void operator delete(void *p, align_val_t) noexcept						{ free(p); }
+void operator delete[](void *p, align_val_t) noexcept					{ free(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept				{ free(p); }
+void operator delete[](void *p, size_t, align_val_t) noexcept			{ free(p); }
+void operator delete(void *p, align_val_t, const nothrow_t&) noexcept	{ free(p); }
+void operator delete[](void *p, align_val_t, const nothrow_t&) noexcept	{ free(p); }
+#endif
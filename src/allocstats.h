@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __ALLOCSTATS_H__
+#define __ALLOCSTATS_H__
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Accounting of heap allocations per subsystem.
+ *
+ * It is compiled in with the CMake option ALLOCSTATS (cmake -DALLOCSTATS=ON).
+ * Then the global operator new, including the overloads for over-aligned
+ * types, counts every allocation and its size for the subsystem currently
+ * set for the thread. A function sets its subsystem with the macro
+ * ALLOC_TAG(). The previous subsystem is restored when the function
+ * returns.
+ *
+ * The counts are exported as the metrics amxpanel_allocations_total and
+ * amxpanel_allocated_bytes_total and written to the log periodically
+ * (AllocLogInterval). Without the option the macro compiles to nothing.
+ */
+namespace amx
+{
+	enum ALLOC_TAG_T
+	{
+		AT_OTHER,			// Everything not tagged
+		AT_AMXNET,			// Communication with the controller
+		AT_DISPATCH,		// TouchPanel::setCommand() and TouchPanel::webMsg()
+		AT_WEBSOCKET,		// Communication with the browsers
+		AT_PAGEGEN,			// Generation of the pages
+		AT_LOGGING,			// Syslog and LogSink
+		AT_COUNT
+	};
+
+#ifdef _ALLOCSTATS
+	class AllocTag
+	{
+		public:
+			explicit AllocTag(ALLOC_TAG_T tag);
+			~AllocTag();
+
+		private:
+			ALLOC_TAG_T previous;
+	};
+
+	class AllocStats
+	{
+		public:
+			static void count(size_t size);
+			static uint64_t getCount(ALLOC_TAG_T tag);
+			static uint64_t getBytes(ALLOC_TAG_T tag);
+			static const char *getName(ALLOC_TAG_T tag);
+			static void start(int interval);
+
+		private:
+			static void collect();
+			static void run(int interval);
+	};
+
+	#define ALLOC_TAG(tag)		amx::AllocTag _hidden_alloc_tag(tag)
+#else
+	class AllocStats
+	{
+		public:
+			static void start(int) {}
+	};
+
+	#define ALLOC_TAG(tag)
+#endif
+}
+
+#endif
@@ -49,6 +49,9 @@
 #include "amxnet.h"
 #include "nameformat.h"
 #include "trace.h"
+#include "capture.h"
+#include "probes.h"
+#include "allocstats.h"
 #include "str.h"
 #include "expand.h"
 #include "directory.h"
@@ -93,39 +96,144 @@ string cmdList[] = {
 
 #define NUMBER_CMDS		144
 
+/*
+ * ComQueue
+ */
+COM_CLASS amx::ComQueue::classOf(uint16_t MC)
+{
+	switch (MC)
+	{
+		case 0x008a:	// level value changed
+		case 0x008b:	// string command
+		case 0x008c:	// send command string
+		case 0x008d:	// Custom event
+			return CC_DATA;
+
+		case 0x0204:	// File transfer
+			return CC_BULK;
+	}
+
+	return CC_EVENT;
+}
+
+void amx::ComQueue::push(const ANET_COMMAND& com, COM_CLASS cls)
+{
+	queues[cls].push_back(com);
+	count++;
+}
+
+bool amx::ComQueue::pop(ANET_COMMAND& com)
+{
+	static const int starveLimit[CC_MAX] = { 0, CC_STARVE_DATA, CC_STARVE_BULK };
+	int cls = -1;
+
+	if (count == 0)
+		return false;
+
+	// A class passed over too often goes first.
+	for (int i = CC_EVENT + 1; i < CC_MAX; i++)
+	{
+		if (!queues[i].empty() && skipped[i] >= starveLimit[i])
+		{
+			cls = i;
+			break;
+		}
+	}
+
+	if (cls < 0)
+	{
+		for (int i = 0; i < CC_MAX; i++)
+		{
+			if (!queues[i].empty())
+			{
+				cls = i;
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < CC_MAX; i++)
+	{
+		if (i == cls)
+			skipped[i] = 0;
+		else if (i > cls && !queues[i].empty())
+			skipped[i]++;
+	}
+
+	com = queues[cls].front();
+	queues[cls].pop_front();
+	count--;
+	return true;
+}
+
+/*
+ * Moves the level changes (0x008a) of the \a port waiting in CC_DATA to
+ * the end of CC_EVENT. Their order is kept. Returns the number of
+ * messages moved.
+ */
+size_t amx::ComQueue::promoteLevels(int port)
+{
+	std::deque<ANET_COMMAND>& data = queues[CC_DATA];
+	std::deque<ANET_COMMAND>::iterator itr = data.begin();
+	size_t moved = 0;
+
+	while (itr != data.end())
+	{
+		if (itr->MC != 0x008a || (int)itr->data.message_value.port != port)
+		{
+			++itr;
+			continue;
+		}
+
+		queues[CC_EVENT].push_back(*itr);
+		itr = data.erase(itr);
+		moved++;
+	}
+
+	return moved;
+}
+
+void amx::ComQueue::clear()
+{
+	for (int i = 0; i < CC_MAX; i++)
+	{
+		queues[i].clear();
+		skipped[i] = 0;
+	}
+
+	count = 0;
+}
+
 AMXNet::AMXNet()
 	: deadline_(io_context),
-	  heartbeat_timer_(io_context),
 	  socket_(io_context)
 {
-	sysl->TRACE(Syslog::ENTRY, "AMXNet::AMXNet()");
+	TRACER(Syslog::ENTRY, "AMXNet::AMXNet()");
 	init();
 }
 
 AMXNet::AMXNet(const string& sn)
 	: deadline_(io_context),
-	  heartbeat_timer_(io_context),
 	  socket_(io_context),
 	  serNum(sn)
 {
-	sysl->TRACE(Syslog::ENTRY, "AMXNet::AMXNet(const string& sn)");
+	TRACER(Syslog::ENTRY, "AMXNet::AMXNet(const string& sn)");
 	init();
 }
 
 AMXNet::AMXNet(const string& sn, const string& nm)
 	: deadline_(io_context),
-	  heartbeat_timer_(io_context),
 	  socket_(io_context),
 	  panName(nm),
 	  serNum(sn)
 {
-	sysl->TRACE(Syslog::ENTRY, "AMXNet::AMXNet(const string& sn)");
+	TRACER(Syslog::ENTRY, "AMXNet::AMXNet(const string& sn)");
 	size_t pos = nm.find(" (TPC)");
 
 	if (pos != string::npos)
 	{
 		panName = nm.substr(0, pos) + "i";
-		sysl->TRACE("AMXNet::AMXNet: Converted TP name: "+panName);
+		TRACER("AMXNet::AMXNet: Converted TP name: "+panName);
 	}
 
 	init();
@@ -134,11 +242,12 @@ AMXNet::AMXNet(const string& sn, const string& nm)
 AMXNet::~AMXNet()
 {
 	devInfo.clear();
-	comStack.clear();
 	callback = 0;
 	stop();
+	stopWriter();
+	comQueue.clear();
     io_context.stop();
-	sysl->TRACE(Syslog::EXIT, "AMXNet::~AMXNet()");
+	TRACER(Syslog::EXIT, "AMXNet::~AMXNet()");
 }
 
 void AMXNet::init()
@@ -148,7 +257,6 @@ void AMXNet::init()
 	sendCounter = 0;
 	initSend = false;
 	ready = false;
-	write_busy = false;
 	string version = "v2.01.00";		// A version > 2.0 is needed for file transfer!
 	int devID = 0x0163, fwID = 0x0290;
 
@@ -209,6 +317,9 @@ void AMXNet::start(asio::ip::tcp::resolver::results_type endpoints, int id)
 	DECL_TRACER(string("AMXNet::start(asio::ip::tcp::resolver::results_type endpoints, int id)"));
 	endpoints_ = endpoints;
 	panelID = id;
+	mcIn.init("in", panelID);
+	mcOut.init("out", panelID);
+	stackDepth = Metrics::get().gauge("amxpanel_controller_queue_length", Metrics::panelLabel(panelID), "Messages waiting to be sent to the controller");
 
 	try
 	{
@@ -231,10 +342,9 @@ void AMXNet::stop()
 {
 	DECL_TRACTHR("AMXNet::stop: Stopping the client...");
 
-	if (stopped_)
+	if (stopped_.exchange(true))
 		return;
 
-	stopped_ = true;
 #ifdef __APPLE__
 	system::error_code ignored_error;
 #else
@@ -243,10 +353,14 @@ void AMXNet::stop()
 	try
 	{
 		deadline_.cancel();
-		heartbeat_timer_.cancel();
+
+		{
+			std::lock_guard<std::mutex> lock(comMut);
+			comCond.notify_all();
+		}
 		socket_.shutdown(asio::socket_base::shutdown_both, ignored_error);
 		socket_.close(ignored_error);
-		sysl->TRACE(string("AMXNet::stop: Client was stopped."), true);
+		TRACER(string("AMXNet::stop: Client was stopped."), true);
 	}
 	catch (std::exception& e)
 	{
@@ -256,7 +370,9 @@ void AMXNet::stop()
 
 void AMXNet::Run()
 {
+	TraceContext::setPanel(panelID);
 	DECL_TRACER("AMXNet::Run()");
+	ALLOC_TAG(AT_AMXNET);
 
 	while (reconCounter < 3)
 	{
@@ -265,7 +381,7 @@ void AMXNet::Run()
 			asio::ip::tcp::resolver r(io_context);
 			start(r.resolve(Configuration->getAMXController(), to_string(Configuration->getAMXPort())), panelID);
 			io_context.run();
-			sysl->TRACE("AMXNet::Run: Thread ended.");
+			TRACER("AMXNet::Run: Thread ended.");
 
 			if (stopped_)
 				break;
@@ -273,6 +389,7 @@ void AMXNet::Run()
 		catch (std::exception& e)
 		{
 			sysl->errlog("AMXNet::Run: Error connecting to "+Configuration->getAMXController()+":"+to_string(Configuration->getAMXPort())+" ["+e.what()+"]");
+			PacketCapture::get().dumpOnError("connection error on panel "+to_string(panelID));
 		}
 
 		reconCounter++;
@@ -293,7 +410,7 @@ void AMXNet::start_connect(asio::ip::tcp::resolver::results_type::iterator endpo
 
 	if (endpoint_iter != endpoints_.end())
 	{
-		sysl->TRACE("AMXNet::start_connect: Trying "+endpoint_iter->endpoint().address().to_string()+":"+to_string(endpoint_iter->endpoint().port())+" ...");
+		TRACER("AMXNet::start_connect: Trying "+endpoint_iter->endpoint().address().to_string()+":"+to_string(endpoint_iter->endpoint().port())+" ...");
 
 		// Set a deadline for the connect operation.
 		deadline_.expires_after(chrono::seconds(120));
@@ -322,7 +439,7 @@ void AMXNet::handle_connect(const error_code& error, asio::ip::tcp::resolver::re
 	// the timeout handler must have run first.
 	if (!socket_.is_open())
 	{
-		sysl->TRACE("AMXNet::handle_connect: Connect timed out", true);
+		TRACER("AMXNet::handle_connect: Connect timed out", true);
 
 		// Try the next available endpoint.
 		start_connect(++endpoint_iter);
@@ -344,23 +461,23 @@ void AMXNet::handle_connect(const error_code& error, asio::ip::tcp::resolver::re
 
 		try
 		{
+			// The messages to the controller are written by their own
+			// thread, while this one reads.
+			startWriter();
+
 			while (isRunning())
-			{
-				// Start the input actor.
 				start_read();
 
-				// Start the output actor.
-				if (isRunning())
-					start_write();
-			}
-
 			if (!stopped_ && killed)
 				stop();
 		}
 		catch (std::exception& e)
 		{
 			sysl->errlogThr(string("AMXNet::handle_connect: Error: ")+e.what());
+			PacketCapture::get().dumpOnError("read error on panel "+to_string(panelID));
 		}
+
+		stopWriter();
 	}
 }
 
@@ -491,10 +608,17 @@ void AMXNet::handle_read(const asio::error_code& error, size_t n, R_TOKEN tk)
 		len = (n < BUF_SIZE) ? n : BUF_SIZE-1;
 		input_buffer_.assign((char *)&buff_[0], len);
 
-		if (len >= 8)
-			sysl->DebugMsg("AMXNet::handle_read: read:\n"+NameFormat::strToHex(input_buffer_, 8, true, 26)+"\n\t\t\t\t\tToken: "+to_string(tk)+", "+to_string(len)+" bytes", true);
-		else
-			sysl->DebugMsg("AMXNet::handle_read: read: "+NameFormat::strToHex(input_buffer_, 1)+", Token: "+to_string(tk)+", "+to_string(len)+" bytes", true);
+		// Collect the parts of the frame for the packet capture
+		if (PacketCapture::isEnabled())
+		{
+			if (tk == RT_ID)
+				capFrame.clear();
+
+			capFrame.append(input_buffer_);
+
+			if (tk == RT_DATA)
+				PacketCapture::get().add(PacketCapture::CAP_IN, panelID, (const unsigned char *)capFrame.data(), capFrame.length());
+		}
 
 		switch (tk)
 		{
@@ -533,10 +657,16 @@ void AMXNet::handle_read(const asio::error_code& error, size_t n, R_TOKEN tk)
 			case RT_MC:		comm.MC = makeWord(buff_[0], buff_[1]); break;
 
 			case RT_DATA:
+				if (protError)
+					PacketCapture::get().dumpOnError("protocol error from controller on panel "+to_string(panelID));
+
 				if (protError || !isRunning())
 					break;
 
-				sysl->TRACE("AMXNet::handle_read: Received message type: 0x"+NameFormat::toHex(comm.MC, 4), true);
+				TRACER("AMXNet::handle_read: Received message type: 0x"+NameFormat::toHex(comm.MC, 4), true);
+				mcIn.count(comm.MC);
+				AMX_PROBE3(frame_receive, panelID, comm.MC, comm.hlen + 4);
+				comm.stamp = Metrics::now();
 
 				switch (comm.MC)
 				{
@@ -698,7 +828,11 @@ void AMXNet::handle_read(const asio::error_code& error, size_t n, R_TOKEN tk)
 							comm.data.srDeviceInfo.flag = 0x0000;
 							comm.data.srDeviceInfo.parentID = 0;
 							comm.data.srDeviceInfo.herstID = 1;
-							msg97fill(&comm);
+							vector<ANET_COMMAND> infos;
+							msg97fill(&comm, infos);
+
+							for (size_t i = 0; i < infos.size(); i++)
+								pushCommand(infos[i]);
 						}
 						else
 							sendCommand(s);
@@ -813,7 +947,7 @@ void AMXNet::handle_read(const asio::error_code& error, size_t n, R_TOKEN tk)
 
 						sendCommand(s);
 
-						sysl->TRACE(string("AMXNet::handle_read: S/N: ")+(char *)&comm.data.srDeviceInfo.serial[0]+" | "+(char *)&comm.data.srDeviceInfo.info[0], true);
+						TRACER(string("AMXNet::handle_read: S/N: ")+(char *)&comm.data.srDeviceInfo.serial[0]+" | "+(char *)&comm.data.srDeviceInfo.info[0], true);
 					break;
 
 					case 0x00a1:	// request status
@@ -966,15 +1100,200 @@ void AMXNet::handle_read(const asio::error_code& error, size_t n, R_TOKEN tk)
 	}
 }
 
+/*
+ * Queues a message for the controller. Level changes (0x008a) are limited
+ * to one per LevelSendInterval milliseconds and level, so dragging a slider
+ * doesn't flood the controller. A button event on a port sends the held
+ * levels of the port first.
+ */
 bool AMXNet::sendCommand (const ANET_SEND& s)
 {
 	DECL_TRACTHR("AMXNet::sendCommand (const ANET_SEND& s)");
 
+	if (s.MC == 0x008a && limitLevel(s))
+		return true;
+
+	if (s.MC == 0x0084 || s.MC == 0x0085)
+		flushLevels(s.port);
+
+	return queueCommand(s);
+}
+
+/*
+ * Returns TRUE if the level change was held back. The writer thread queues
+ * it at the end of the interval (queueDueLevels()), unless a newer value
+ * replaces it.
+ */
+bool AMXNet::limitLevel(const ANET_SEND& s)
+{
+	int interval = Configuration->getLevelSendInterval();
+
+	if (interval <= 0)
+		return false;
+
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	std::lock_guard<std::mutex> lock(comMut);
+	LEVEL_LIMIT_T& ll = levelLimits[((uint32_t)s.port << 16) | s.level];
+
+	if (ll.held)
+	{
+		ll.pending = s;
+		return true;
+	}
+
+	if (now - ll.last >= chrono::milliseconds(interval))
+	{
+		ll.last = now;
+		return false;
+	}
+
+	ll.pending = s;
+	ll.held = true;
+	comCond.notify_one();
+	return true;
+}
+
+/*
+ * Queues the held levels of the \a port at once. They are queued with the
+ * priority of the button event following them, so they stay in front of
+ * it. The levels of the port already waiting in the queue are moved to the
+ * same priority first, because they are older.
+ */
+void AMXNet::flushLevels(int port)
+{
+	vector<ANET_SEND> due;
+
+	{
+		std::lock_guard<std::mutex> lock(comMut);
+		comQueue.promoteLevels(port);
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		map<uint32_t, LEVEL_LIMIT_T>::iterator itr;
+
+		for (itr = levelLimits.begin(); itr != levelLimits.end(); ++itr)
+		{
+			if (!itr->second.held || itr->second.pending.port != port)
+				continue;
+
+			itr->second.held = false;
+			itr->second.last = now;
+			due.push_back(itr->second.pending);
+		}
+	}
+
+	for (size_t i = 0; i < due.size(); i++)
+		queueCommand(due[i], CC_EVENT);
+}
+
+/*
+ * Moves the held levels whose interval is over into the queue. comMut must
+ * be locked.
+ */
+void AMXNet::queueDueLevels()
+{
+	if (levelLimits.empty())
+		return;
+
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	chrono::milliseconds interval(Configuration->getLevelSendInterval());
+	map<uint32_t, LEVEL_LIMIT_T>::iterator itr;
+
+	for (itr = levelLimits.begin(); itr != levelLimits.end(); ++itr)
+	{
+		if (!itr->second.held || now - itr->second.last < interval)
+			continue;
+
+		itr->second.held = false;
+		itr->second.last = now;
+		vector<ANET_COMMAND> coms;
+
+		if (makeCommand(itr->second.pending, coms))
+		{
+			for (size_t i = 0; i < coms.size(); i++)
+				comQueue.push(coms[i]);
+		}
+	}
+}
+
+/*
+ * Returns the end of the earliest interval of a held level, but not more
+ * than a second from now. comMut must be locked.
+ */
+chrono::steady_clock::time_point AMXNet::nextLevelDue()
+{
+	chrono::steady_clock::time_point next = chrono::steady_clock::now() + chrono::seconds(1);
+	chrono::milliseconds interval(Configuration->getLevelSendInterval());
+	map<uint32_t, LEVEL_LIMIT_T>::iterator itr;
+
+	for (itr = levelLimits.begin(); itr != levelLimits.end(); ++itr)
+	{
+		if (itr->second.held && itr->second.last + interval < next)
+			next = itr->second.last + interval;
+	}
+
+	return next;
+}
+
+/*
+ * Queues the message with the priority of the class \a cls. With a
+ * negative \a cls the class is taken from the message command.
+ */
+bool AMXNet::queueCommand (const ANET_SEND& s, int cls)
+{
+	DECL_TRACTHR("AMXNet::queueCommand (const ANET_SEND& s, int cls)");
+
+	vector<ANET_COMMAND> coms;
+	std::lock_guard<std::mutex> lock(comMut);
+
+	if (!makeCommand(s, coms))
+		return false;
+
+	for (size_t i = 0; i < coms.size(); i++)
+	{
+		if (cls < 0)
+			comQueue.push(coms[i]);
+		else
+			comQueue.push(coms[i], (COM_CLASS)cls);
+	}
+
+	if (stackDepth)
+		stackDepth->set((int64_t)comQueue.size());
+
+	comCond.notify_one();
+	return true;
+}
+
+/*
+ * Puts a message into the queue, which was made without queueCommand().
+ */
+void AMXNet::pushCommand (const ANET_COMMAND& com)
+{
+	std::lock_guard<std::mutex> lock(comMut);
+	comQueue.push(com);
+
+	if (stackDepth)
+		stackDepth->set((int64_t)comQueue.size());
+
+	comCond.notify_one();
+}
+
+/*
+ * Makes the messages for the controller out of \a s and appends them to
+ * \a coms. This is one message, except for the device info (0x0097),
+ * which has one message per device. Returns FALSE if the message command
+ * is not supported.
+ */
+bool AMXNet::makeCommand (const ANET_SEND& s, vector<ANET_COMMAND>& coms)
+{
+	DECL_TRACTHR("AMXNet::makeCommand (const ANET_SEND& s, vector<ANET_COMMAND>& coms)");
+
 	bool status = false;
 	size_t len, size;
 	ANET_COMMAND com;
 	com.clear();
 	com.MC = s.MC;
+	com.stamp = s.stamp;
+	com.queued = Metrics::now();
+	Metrics::latency(LAT_WEB_DISPATCH, s.stamp);
 
 	if (s.MC == 0x0204)		// file transfer
 		com.device1 = s.device;
@@ -996,7 +1315,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.channel.system = com.system;
 			com.data.channel.channel = s.channel;
 			com.hlen = 0x0016 - 0x0003 + sizeof(ANET_CHANNEL);
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1006,7 +1324,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.channel.system = com.system;
 			com.data.channel.channel = s.channel;
 			com.hlen = 0x0016 - 0x0003 + sizeof(ANET_CHANNEL);
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1017,7 +1334,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.channel.system = com.system;
 			com.data.channel.channel = s.channel;
 			com.hlen = 0x0016 - 0x0003 + sizeof(ANET_CHANNEL);
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1028,7 +1344,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.channel.system = com.system;
 			com.data.channel.channel = s.channel;
 			com.hlen = 0x0016 - 0x0003 + sizeof(ANET_CHANNEL);
-			comStack.push_back(com);
 			status = true;
 			break;
 
@@ -1040,7 +1355,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.message_value.type = 0x20;		// unsigned integer
 			com.data.message_value.content.integer = s.value;
 			com.hlen = 0x0016 - 0x0003 + 11;
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1059,7 +1373,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.message_string.length = len;
 			strncpy((char *)&com.data.message_string.content[0], s.msg.c_str(), len);
 			com.hlen = 0x0016 - 3 + 9 + len;
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1084,7 +1397,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			memset(com.data.customEvent.data, 0, sizeof(com.data.customEvent.data));
 			memcpy(&com.data.customEvent.data[0], s.msg.c_str(), s.msg.length());
 			com.hlen = 0x0016 - 3 + 29 + s.msg.length();
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1093,7 +1405,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.sendPortNumber.system = com.system;
 			com.data.sendPortNumber.pcount = s.value;
 			com.hlen = 0x0016 - 3 + 6;
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1104,7 +1415,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.sendOutpChannels.system = com.system;
 			com.data.sendOutpChannels.count = s.value;
 			com.hlen = 0x0016 - 3 + 8;
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1116,7 +1426,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.sendSize.type = 0x01;
 			com.data.sendSize.length = s.value;
 			com.hlen = 0x0016 - 3 + 9;
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1133,7 +1442,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.sendLevSupport.types[4] = 0x40;
 			com.data.sendLevSupport.types[5] = 0x41;
 			com.hlen = 0x0016 - 0x0003 + sizeof(ANET_LEVSUPPORT);
-			comStack.push_back(com);
 		break;
 
 		case 0x0096:		// Status code
@@ -1146,7 +1454,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.sendStatusCode.str[0] = 'O';
 			com.data.sendStatusCode.str[1] = 'K';
 			com.hlen = 0x0016 - 3 + 13;
-			comStack.push_back(com);
 		break;
 
 		case 0x0097:		// device info
@@ -1156,15 +1463,13 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			com.data.srDeviceInfo.objectID = 0;
 			com.data.srDeviceInfo.parentID = 0;
 			com.data.srDeviceInfo.herstID = 1;
-			msg97fill(&com);
-			status = true;
-		break;
+			msg97fill(&com, coms);
+		return !coms.empty();
 
 		case 0x0098:
 			com.data.reqPortCount.device = com.device2;
 			com.data.reqPortCount.system = com.system;
 			com.hlen = 0x0016 - 3 + 4;
-			comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1204,7 +1509,6 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			}
 
 			com.hlen = 0x0016 - 3 + len;
-            comStack.push_back(com);
 			status = true;
 		break;
 
@@ -1225,13 +1529,12 @@ bool AMXNet::sendCommand (const ANET_SEND& s)
 			}
 
 			com.hlen = 0x0016 - 3 + 14;
-			comStack.push_back(com);
 			status = true;
 		break;
 	}
 
 	if (status)
-		start_write();
+		coms.push_back(com);
 
 	return status;
 }
@@ -1264,7 +1567,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 		s.value1 = 0;				// 1st data byte 0x00
 		s.value2 = 0x10;			// 2nd data byte 0x10
 		string f((char *)&ft.data);
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0000/0x0105: Directory "+f+" exist?", true);
+		TRACER("AMXNet::handleFTransfer: 0x0000/0x0105: Directory "+f+" exist?", true);
 
 		if (f.compare(0, 8, "AMXPanel") == 0)
 		{
@@ -1321,7 +1624,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 				len = dr.getFileSize(realPath);
 		}
 
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0000/0x0100: Request directory "+fname, true);
+		TRACER("AMXNet::handleFTransfer: 0x0000/0x0100: Request directory "+fname, true);
 		snprintf((char *)&ftr.data.filetransfer.data[0], sizeof(ftr.data.filetransfer.data), "Syncing %d files ...", ftransfer.maxFiles);
 
 		if (callback)
@@ -1363,7 +1666,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 	}
 	else if (ft.ftype == 4 && ft.function == 0x0100)	// Have more files to send.
 	{
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0100: Have more files to send.", true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0100: Have more files to send.", true);
 		s.channel = 0;
 		s.level = 0;
 		s.port = 0;
@@ -1405,7 +1708,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 		else
 			isOpenRcv = true;
 
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0102: Controller will send file "+rcvFileName, true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0102: Controller will send file "+rcvFileName, true);
 		ftransfer.actFileNum++;
 		ftransfer.lengthFile = ft.unk;
 
@@ -1455,7 +1758,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 		if ((pos = f.find("AMXPanel/")) == string::npos)
 			pos = f.find("__system/");
 
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0000/0x0104: Delete file "+f, true);
+		TRACER("AMXNet::handleFTransfer: 0x0000/0x0104: Delete file "+f, true);
 
 		if (pos != string::npos)
 			f = Configuration->getHTTProot()+"/"+f.substr(pos+9);
@@ -1515,7 +1818,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 		size_t pos;
 		len = 0;
 		sndFileName.assign(Configuration->getHTTProot());
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0104: Request file "+f, true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0104: Request file "+f, true);
 
 		if (f.find("AMXPanel") != string::npos)
 		{
@@ -1542,7 +1845,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 		else
 			len = 0;
 
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0104: ("+to_string(len)+") File: "+sndFileName, true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0104: ("+to_string(len)+") File: "+sndFileName, true);
 
 		s.channel = 0;
 		s.level = 0;
@@ -1557,7 +1860,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 	}
 	else if (ft.ftype == 4 && ft.function == 0x0106)	// Controller is ready for receiving file
 	{
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0106: Controller is ready for receiving file.", true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0106: Controller is ready for receiving file.", true);
 
 		if (!access(sndFileName.c_str(), R_OK))
 		{
@@ -1616,7 +1919,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 	}
 	else if (ft.ftype == 4 && ft.function == 0x0002)	// request next part of file
 	{
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0002: Request next part of file.", true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0002: Request next part of file.", true);
 		s.channel = 0;
 		s.level = 0;
 		s.port = 0;
@@ -1653,7 +1956,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 	}
 	else if (ft.ftype == 4 && ft.function == 0x0003)	// File content
 	{
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0003: Received (part of) file.", true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0003: Received (part of) file.", true);
 		len = ft.unk;
 
 		if (isOpenRcv)
@@ -1686,7 +1989,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 	}
 	else if (ft.ftype == 4 && ft.function == 0x0004)	// End of file
 	{
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0004: End of file.", true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0004: End of file.", true);
 
 		if (isOpenRcv)
 		{
@@ -1722,7 +2025,7 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 	}
 	else if (ft.ftype == 4 && ft.function == 0x0005)	// ACK, controller received file, no answer
 	{
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0005: Controller received file.", true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0005: Controller received file.", true);
 		posSnd = 0;
 		lenSnd = 0;
 
@@ -1734,11 +2037,11 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 	}
 	else if (ft.ftype == 4 && ft.function == 0x0006)	// End of directory transfer ACK
 	{
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0006: End of directory transfer.", true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0006: End of directory transfer.", true);
 	}
 	else if (ft.ftype == 4 && ft.function == 0x0007)	// End of file transfer
 	{
-		sysl->TRACE("AMXNet::handleFTransfer: 0x0004/0x0007: End of file transfer.", true);
+		TRACER("AMXNet::handleFTransfer: 0x0004/0x0007: End of file transfer.", true);
 
 		if (callback)
 			callback(ftr);
@@ -1747,9 +2050,12 @@ void AMXNet::handleFTransfer (ANET_SEND &s, ANET_FILETRANSFER &ft)
 	}
 }
 
-int AMXNet::msg97fill(ANET_COMMAND *com)
+/*
+ * Appends one device info message (0x0097) per device to \a coms.
+ */
+int AMXNet::msg97fill(ANET_COMMAND *com, vector<ANET_COMMAND>& coms)
 {
-	DECL_TRACTHR("AMXNet::msg97fill(ANET_COMMAND *com)");
+	DECL_TRACTHR("AMXNet::msg97fill(ANET_COMMAND *com, vector<ANET_COMMAND>& coms)");
 
 	int pos = 0;
 	unsigned char buf[512];
@@ -1793,7 +2099,7 @@ int AMXNet::msg97fill(ANET_COMMAND *com)
 		com->data.srDeviceInfo.len = pos;
 		memcpy(com->data.srDeviceInfo.info, buf, pos);
 		com->hlen = 0x0016 - 3 + 31 + pos - 1;
-		comStack.push_back(*com);
+		coms.push_back(*com);
 		sendCounter++;
 		com->count = sendCounter;
 	}
@@ -1801,63 +2107,142 @@ int AMXNet::msg97fill(ANET_COMMAND *com)
 	return pos;
 }
 
-void AMXNet::start_write()
+/*
+ * Starts the thread writing the messages to the controller. It runs as
+ * long as the connection is up.
+ */
+void AMXNet::startWriter()
 {
-	DECL_TRACTHR("AMXNet::start_write()");
+	DECL_TRACTHR("AMXNet::startWriter()");
 
-	if (!isRunning())
-		return;
+	std::lock_guard<std::mutex> lock(writerMut);
+	joinWriter();
 
-	if (write_busy)
-		return;
-
-	write_busy = true;
-
-	while (comStack.size() > 0)
+	try
 	{
-		if (!isRunning())
 		{
-			comStack.clear();
-			write_busy = false;
-			return;
+			std::lock_guard<std::mutex> lock(comMut);
+			writerEnd = false;
 		}
 
-		send = comStack.at(0);
-		comStack.erase(comStack.begin());	// delete oldest element
-		unsigned char *buf = makeBuffer(send);
+		writer = std::thread([this] { writeLoop(); });
+	}
+	catch (std::exception& e)
+	{
+		sysl->errlogThr(string("AMXNet::startWriter: Error starting the writer thread: ")+e.what());
+		stop();
+	}
+}
+
+/*
+ * Waits for the end of the writer thread. This is called by the thread
+ * reading from the controller and by the destructor.
+ */
+void AMXNet::stopWriter()
+{
+	std::lock_guard<std::mutex> lock(writerMut);
+	joinWriter();
+}
 
-		if (buf == 0)
+/*
+ * writerMut must be locked.
+ */
+void AMXNet::joinWriter()
+{
+	if (!writer.joinable() || writer.get_id() == std::this_thread::get_id())
+		return;
+
+	{
+		// A failed read doesn't stop the client, because Run() reconnects.
+		// The writer must end anyway.
+		std::lock_guard<std::mutex> lock(comMut);
+		writerEnd = true;
+		comCond.notify_all();
+	}
+
+	writer.join();
+}
+
+/*
+ * Takes the messages out of the queue in the order of their priority and
+ * writes them to the controller. The held back levels are queued when their
+ * interval is over, so the thread wakes up at that time.
+ */
+void AMXNet::writeLoop()
+{
+	TraceContext::setPanel(panelID);
+	DECL_TRACTHR("AMXNet::writeLoop()");
+	ALLOC_TAG(AT_AMXNET);
+
+	std::unique_lock<std::mutex> lock(comMut);
+	ANET_COMMAND com;
+
+	while (isRunning() && !writerEnd)
+	{
+		queueDueLevels();
+
+		if (!comQueue.pop(com))
 		{
-			sysl->errlogThr("AMXNet::start_write: Error creating a buffer! Token number: "+to_string(send.MC));
+			comCond.wait_until(lock, nextLevelDue());
 			continue;
 		}
 
-		asio::async_write(socket_, asio::buffer(buf, send.hlen + 4), bind(&AMXNet::handle_write, this, _1));
-		delete[] buf;
+		if (stackDepth)
+			stackDepth->set((int64_t)comQueue.size());
+
+		lock.unlock();
+		bool ok = writeCommand(com);
+		lock.lock();
+
+		if (!ok)
+			break;
 	}
 
-	write_busy = false;
+	comQueue.clear();
 }
 
-void AMXNet::handle_write(const error_code& error)
+/*
+ * Writes one message to the controller. Returns FALSE if the connection
+ * failed.
+ */
+bool AMXNet::writeCommand(const ANET_COMMAND& com)
 {
-	DECL_TRACTHR("AMXNet::handle_write(const error_code& error)");
+	DECL_TRACTHR("AMXNet::writeCommand(const ANET_COMMAND& com)");
 
-	if (!isRunning())
-		return;
+	unsigned char *buf = makeBuffer(com);
 
-	if (!error)
+	if (buf == 0)
 	{
-		while (comStack.size() == 0)
-			heartbeat_timer_.expires_after(chrono::microseconds(150));
+		sysl->errlogThr("AMXNet::writeCommand: Error creating a buffer! Token number: "+to_string(com.MC));
+		return true;
+	}
 
-		heartbeat_timer_.async_wait(bind(&AMXNet::start_write, this));
+	mcOut.count(com.MC);
+	AMX_PROBE3(frame_send, panelID, com.MC, com.hlen + 4);
+	PacketCapture::get().add(PacketCapture::CAP_OUT, panelID, buf, com.hlen + 4);
+
+	if (com.stamp)
+	{
+		Metrics::latency(LAT_WEB_WRITE, com.queued);
+		Metrics::latency(LAT_WEB_TOTAL, com.stamp);
 	}
-	else
+
+#ifdef __APPLE__
+	system::error_code error;
+#else
+	asio::error_code error;
+#endif
+	asio::write(socket_, asio::buffer(buf, com.hlen + 4), error);
+	delete[] buf;
+
+	if (error)
 	{
-		sysl->errlogThr("AMXNet::handle_write: Error on heartbeat: "+error.message());
+		sysl->errlogThr("AMXNet::writeCommand: Error writing to the controller: "+error.message());
 		stop();
+		return false;
 	}
+
+	return true;
 }
 
 void AMXNet::check_deadline()
@@ -1910,7 +2295,7 @@ unsigned char AMXNet::calcChecksum(const unsigned char* buffer, size_t len)
 		sum += (unsigned long)(*(buffer+i)) & 0x000000ff;
 
 	sum &= 0x000000ff;
-	sysl->TRACE("AMXNet::calcChecksum: Checksum="+NameFormat::toHex((int)sum, 2)+", #bytes="+to_string(len)+" bytes.", true);
+	TRACER("AMXNet::calcChecksum: Checksum="+NameFormat::toHex((int)sum, 2)+", #bytes="+to_string(len)+" bytes.", true);
 	return (unsigned char)sum;
 }
 
@@ -2408,7 +2793,7 @@ unsigned char *AMXNet::makeBuffer (const ANET_COMMAND& s)
 	}
 
 	string b((char *)buf, s.hlen+4);
-	sysl->TRACE("AMXNet::makeBuffer:\n"+NameFormat::strToHex(b, 8, true, 26), true);
+	TRACER("AMXNet::makeBuffer:\n"+NameFormat::strToHex(b, 8, true, 26), true);
 	return buf;
 }
 
@@ -23,6 +23,14 @@
 #include <cstring>
 #include <cstdio>
 #include <atomic>
+#include <map>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include "metrics.h"
 
 #ifdef __APPLE__
 using namespace boost;
@@ -52,6 +60,7 @@ namespace amx
 		uint32_t value3{0};		// Value 3
 		unsigned char dtype{0};	// Type of data
 		std::string msg;		// message string
+		uint64_t stamp{0};		// Time received from the browser (Metrics::now())
 	}ANET_SEND;
 
 	typedef union
@@ -248,6 +257,8 @@ namespace amx
 		uint16_t MC{0};			// 0x14 - 0x15: Message command identifier
 		ANET_DATA data;			// 0x16 - n     Data block
 		unsigned char checksum{0};	// last byte:   Checksum
+		uint64_t stamp{0};		// Time decoded or received from the browser (Metrics::now())
+		uint64_t queued{0};		// Time put into the send queue
 
 		void clear()
 		{
@@ -265,6 +276,8 @@ namespace amx
 			count = 0;
 			MC = 0;
 			checksum = 0;
+			stamp = 0;
+			queued = 0;
 		}
 	}ANET_COMMAND;
 
@@ -285,6 +298,61 @@ namespace amx
 		unsigned char addr[8];		// Extended address as indicated by the type and length of the extended address.
 	}DEVICE_INFO;
 
+	/*
+	 * The classes of the messages sent to the controller, in the order of
+	 * their priority.
+	 */
+	enum COM_CLASS
+	{
+		CC_EVENT,		// Button and channel events, answers to the controller
+		CC_DATA,		// Levels, strings and commands
+		CC_BULK,		// File transfer
+		CC_MAX
+	};
+
+	/*
+	 * The queue of the messages waiting to be sent to the controller. Every
+	 * class has its own FIFO and pop() takes the message of the class with
+	 * the highest priority. So a button press doesn't wait behind a file
+	 * transfer. To keep the lower classes from starving, a class passed over
+	 * CC_STARVE_DATA resp. CC_STARVE_BULK times in a row is served next.
+	 *
+	 * The class is not thread safe. AMXNet uses it under comMut.
+	 */
+	#define CC_STARVE_DATA	4
+	#define CC_STARVE_BULK	16
+
+	class ComQueue
+	{
+		public:
+			static COM_CLASS classOf(uint16_t MC);
+
+			void push(const ANET_COMMAND& com, COM_CLASS cls);
+			void push(const ANET_COMMAND& com) { push(com, classOf(com.MC)); }
+			bool pop(ANET_COMMAND& com);
+			size_t promoteLevels(int port);
+			void clear();
+			size_t size() const { return count; }
+			bool empty() const { return count == 0; }
+
+		private:
+			std::deque<ANET_COMMAND> queues[CC_MAX];
+			int skipped[CC_MAX]{0};		// Times the class was passed over
+			size_t count{0};
+	};
+
+	/*
+	 * The rate limit of a level sent to the controller. A value arriving
+	 * before LevelSendInterval milliseconds since the last value of the same
+	 * level are over, is held back. A newer value replaces it.
+	 */
+	typedef struct LEVEL_LIMIT_T
+	{
+		std::chrono::steady_clock::time_point last;	// Time the last value was queued
+		ANET_SEND pending;							// Latest value held back
+		bool held{false};							// TRUE = pending waits for the timer
+	}LEVEL_LIMIT_T;
+
 	typedef struct FTRANSFER
 	{
 		int percent{0};				// Status indicating the percent done
@@ -345,8 +413,18 @@ namespace amx
 #else
 			void handle_read(const asio::error_code& error, size_t n, R_TOKEN tk);
 #endif
-			void start_write();
-			void handle_write(const std::error_code& error);
+			bool queueCommand(const ANET_SEND& s, int cls = -1);
+			void pushCommand(const ANET_COMMAND& com);
+			bool makeCommand(const ANET_SEND& s, std::vector<ANET_COMMAND>& coms);
+			bool limitLevel(const ANET_SEND& s);
+			void flushLevels(int port);
+			void queueDueLevels();
+			std::chrono::steady_clock::time_point nextLevelDue();
+			void startWriter();
+			void stopWriter();
+			void joinWriter();
+			void writeLoop();
+			bool writeCommand(const ANET_COMMAND& com);
 			void handleFTransfer(ANET_SEND& s, ANET_FILETRANSFER& ft);
 			void check_deadline();
 			uint16_t swapWord(uint16_t w);
@@ -355,19 +433,19 @@ namespace amx
 			uint16_t makeWord(unsigned char b1, unsigned char b2);
 			uint32_t makeDWord(unsigned char b1, unsigned char b2, unsigned char b3, unsigned char b4);
 			unsigned char *makeBuffer(const ANET_COMMAND& s);
-			int msg97fill(ANET_COMMAND *com);
+			int msg97fill(ANET_COMMAND *com, std::vector<ANET_COMMAND>& coms);
 			bool isCommand(const std::string& cmd);
 			bool isRunning() { return !(stopped_ || killed); }
 			int countFiles();
 
 			asio::io_context io_context;
 			asio::steady_timer deadline_;
-			asio::steady_timer heartbeat_timer_;
 
-			bool stopped_{false};
+			std::atomic<bool> stopped_{false};	// Written by several threads, read by the writer
 			asio::ip::tcp::resolver::results_type endpoints_;
 			asio::ip::tcp::socket socket_;
 			std::string input_buffer_;
+			std::string capFrame;		// Frame collected for the packet capture
 			unsigned char buff_[BUF_SIZE];
 			std::function<void(const ANET_COMMAND&)> callback;
 			std::function<bool(AMXNet *)> cbWebConn;
@@ -376,12 +454,19 @@ namespace amx
 			std::atomic<int> reconCounter{0};	// Reconnect counter
 			uint16_t reqDevStatus{0};
 			ANET_COMMAND comm;			// received command
-			ANET_COMMAND send;			// answer / request
 			uint16_t sendCounter{0};	// Counter increment on every send
-			std::vector<ANET_COMMAND> comStack;	// commands to answer
+			ComQueue comQueue;			// Messages waiting to be sent, protected by comMut
+			std::mutex comMut;			// Protects comQueue and levelLimits
+			std::condition_variable comCond;	// Wakes up the writer thread
+			std::thread writer;			// Writes comQueue to the controller
+			bool writerEnd{false};		// TRUE = writer must end. Protected by comMut
+			std::mutex writerMut;		// Serializes starting and stopping writer
+			McMetrics mcIn;				// Received messages per MC
+			McMetrics mcOut;			// Sent messages per MC
+			Gauge *stackDepth{nullptr};	// Length of comQueue
+			std::map<uint32_t, LEVEL_LIMIT_T> levelLimits;	// (port << 16) | level --> rate limit
 			bool initSend{false};		// TRUE = all init messages are send.
 			bool ready{false};			// TRUE = ready for communication
-			bool write_busy{false};
 			std::vector<DEVICE_INFO> devInfo;
 			std::string oldCmd;
 			int panelID{0};				// Panel ID of currently legalized panel.
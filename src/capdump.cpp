@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * amxcapdump: Prints the ICSP frames of the capture files written by
+ * amxpanel.
+ *
+ * Usage: amxcapdump [-p <panel>] [-x] <file> [<file> ...]
+ *
+ * With -p only the frames of the given panel are printed. With -x the data
+ * block of each frame is printed as a hex dump.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <vector>
+#include <arpa/inet.h>
+#include "capfile.h"
+
+using namespace std;
+using namespace amx;
+
+static uint32_t swap32(uint32_t v, bool swap)
+{
+	return swap ? __builtin_bswap32(v) : v;
+}
+
+static uint16_t getWord(const unsigned char *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void hexDump(const unsigned char *p, size_t len)
+{
+	for (size_t i = 0; i < len; i += 16)
+	{
+		printf("        %04zx:", i);
+
+		for (size_t j = i; j < i + 16; j++)
+		{
+			if (j < len)
+				printf(" %02x", p[j]);
+			else
+				printf("   ");
+		}
+
+		printf("  ");
+
+		for (size_t j = i; j < i + 16 && j < len; j++)
+			putchar((p[j] >= 0x20 && p[j] < 0x7f) ? p[j] : '.');
+
+		putchar('\n');
+	}
+}
+
+/*
+ * Prints the header of an ICSP frame. The layout is the one of the
+ * structure ANET_COMMAND (see amxnet.h).
+ */
+static void printFrame(const unsigned char *p, size_t len, bool hex)
+{
+	if (len < 0x16 || p[0] != 0x02)
+	{
+		printf("    Invalid frame of %zu bytes\n", len);
+
+		if (hex)
+			hexDump(p, len);
+
+		return;
+	}
+
+	printf("    len=%u type=0x%02x from %u:%u:%u to %u:%u count=%u MC=0x%04x\n",
+		   getWord(p+1), p[4], getWord(p+7), getWord(p+9), getWord(p+11),
+		   getWord(p+13), getWord(p+15), getWord(p+18), getWord(p+20));
+
+	if (hex && len > 0x16)
+		hexDump(p + 0x16, len - 0x16);
+}
+
+static bool dumpFile(const char *fname, uint32_t panel, bool hex)
+{
+	FILE *fp = fopen(fname, "rb");
+
+	if (!fp)
+	{
+		fprintf(stderr, "%s: %s\n", fname, strerror(errno));
+		return false;
+	}
+
+	CAP_FILE_HEADER hdr;
+	bool swap = false;
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+		(hdr.magic != CAP_MAGIC && !(swap = (hdr.magic == __builtin_bswap32(CAP_MAGIC)))) ||
+		swap32(hdr.linktype, swap) != CAP_LINKTYPE)
+	{
+		fprintf(stderr, "%s: Not a capture file of amxpanel!\n", fname);
+		fclose(fp);
+		return false;
+	}
+
+	printf("# %s\n", fname);
+	CAP_RECORD_HEADER rec;
+	vector<unsigned char> data;
+
+	while (fread(&rec, sizeof(rec), 1, fp) == 1)
+	{
+		uint32_t len = swap32(rec.incl_len, swap);
+		data.resize(len);
+
+		if (len > 0 && fread(data.data(), 1, len, fp) != len)
+		{
+			fprintf(stderr, "%s: Truncated frame!\n", fname);
+			break;
+		}
+
+		if (len < sizeof(CAP_PSEUDO_HEADER))
+			continue;
+
+		CAP_PSEUDO_HEADER ph;
+		memcpy(&ph, data.data(), sizeof(ph));
+		uint32_t pan = ntohl(ph.panel);
+
+		if (panel && pan != panel)
+			continue;
+
+		time_t sec = (time_t)swap32(rec.sec, swap);
+		struct tm lt;
+		char ts[64];
+		localtime_r(&sec, &lt);
+		strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &lt);
+		uint32_t orig = swap32(rec.orig_len, swap) - sizeof(ph);
+		printf("%s.%06u P%u %s %u bytes%s\n", ts, swap32(rec.usec, swap), pan,
+			   ph.direction ? "-->" : "<--", orig, (orig > len - sizeof(ph)) ? " (truncated)" : "");
+		printFrame(data.data() + sizeof(ph), len - sizeof(ph), hex);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t panel = 0;
+	bool hex = false;
+	int i = 1;
+
+	while (i < argc && argv[i][0] == '-')
+	{
+		if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+		{
+			panel = (uint32_t)atoi(argv[i+1]);
+			i += 2;
+		}
+		else if (strcmp(argv[i], "-x") == 0)
+		{
+			hex = true;
+			i++;
+		}
+		else
+			break;
+	}
+
+	if (i >= argc)
+	{
+		fprintf(stderr, "Usage: %s [-p <panel>] [-x] <file> [<file> ...]\n", argv[0]);
+		return 1;
+	}
+
+	int ret = 0;
+
+	for (; i < argc; i++)
+	{
+		if (!dumpFile(argv[i], panel, hex))
+			ret = 1;
+	}
+
+	return ret;
+}
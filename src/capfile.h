@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __CAPFILE_H__
+#define __CAPFILE_H__
+
+#include <cstdint>
+
+/*
+ * Layout of the packet capture files.
+ *
+ * The files are in the classic pcap format and can be opened with any tool
+ * reading pcap files (e.g. wireshark) using the link type USER0. Every
+ * packet starts with a CAP_PSEUDO_HEADER followed by the raw ICSP frame as
+ * it was read from or written to the controller.
+ *
+ * The files are decoded offline with the tool "amxcapdump".
+ */
+#define CAP_MAGIC			0xa1b2c3d4	// Micro second resolution, byte order of the writer
+#define CAP_VERSION_MAJOR	2
+#define CAP_VERSION_MINOR	4
+#define CAP_LINKTYPE		147			// LINKTYPE_USER0
+
+namespace amx
+{
+	typedef struct CAP_FILE_HEADER
+	{
+		uint32_t magic;			// CAP_MAGIC
+		uint16_t major;			// CAP_VERSION_MAJOR
+		uint16_t minor;			// CAP_VERSION_MINOR
+		int32_t thiszone;		// Always 0 (UTC)
+		uint32_t sigfigs;		// Always 0
+		uint32_t snaplen;		// Maximum number of bytes saved per frame
+		uint32_t linktype;		// CAP_LINKTYPE
+	}CAP_FILE_HEADER;
+
+	typedef struct CAP_RECORD_HEADER
+	{
+		uint32_t sec;			// Time of capture (seconds since the epoch)
+		uint32_t usec;			// Micro seconds
+		uint32_t incl_len;		// Bytes saved in the file (pseudo header included)
+		uint32_t orig_len;		// Length of the frame (pseudo header included)
+	}CAP_RECORD_HEADER;
+
+	typedef struct CAP_PSEUDO_HEADER
+	{
+		uint8_t direction;		// 0 = from the controller, 1 = to the controller
+		uint8_t reserved[3];
+		uint32_t panel;			// Panel ID (channel) of the connection
+	}CAP_PSEUDO_HEADER;
+}
+
+#endif
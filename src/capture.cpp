@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "syslog.h"
+#include "capture.h"
+#include "capfile.h"
+#include "trace.h"
+
+extern Syslog *sysl;
+extern std::atomic<bool> killed;
+
+using namespace std;
+using namespace amx;
+
+atomic<bool> amx::PacketCapture::enabled{false};
+atomic<bool> amx::PacketCapture::dumpRequested{false};
+
+PacketCapture& amx::PacketCapture::get()
+{
+	static PacketCapture capture;
+	return capture;
+}
+
+/*
+ * Allocates the ring buffer for the given number of frames. With 0 frames
+ * the capture is off.
+ */
+void amx::PacketCapture::init(size_t frames, int smp, const string& dir)
+{
+	DECL_TRACER("PacketCapture::init(size_t frames, int smp, const string& dir)");
+
+	lock_guard<mutex> lock(mut);
+	enabled = false;
+	ring.clear();
+	ring.shrink_to_fit();
+	next = count = 0;
+	sample = (smp > 0) ? smp : 1;
+	capDir = dir;
+
+	if (frames == 0)
+		return;
+
+	try
+	{
+		ring.resize(frames);
+		enabled = true;
+
+		if (!threadStarted)
+		{
+			thread thr = thread([this] { run(); });
+			thr.detach();
+			threadStarted = true;
+		}
+	}
+	catch (std::exception& e)
+	{
+		sysl->errlog(string("PacketCapture::init: Error allocating the capture buffer: ")+e.what());
+	}
+}
+
+/*
+ * Puts a frame into the ring. If the ring is full, the oldest frame is
+ * overwritten.
+ */
+void amx::PacketCapture::add(DIRECTION dir, int panel, const unsigned char *data, size_t len)
+{
+	if (!enabled || !data)
+		return;
+
+	int smp = sample.load(memory_order_relaxed);
+
+	if (smp > 1 && (seen.fetch_add(1, memory_order_relaxed) % smp) != 0)
+		return;
+
+	struct timeval tv;
+	gettimeofday(&tv, nullptr);
+	lock_guard<mutex> lock(mut);
+
+	if (ring.empty())
+		return;
+
+	CAP_FRAME& fr = ring[next];
+	fr.stamp = tv;
+	fr.panel = (uint32_t)panel;
+	fr.direction = (uint8_t)dir;
+	fr.origLen = (uint32_t)len;
+	fr.len = (uint32_t)((len < CAP_SNAPLEN) ? len : CAP_SNAPLEN);
+	memcpy(fr.data, data, fr.len);
+	next = (next + 1) % ring.size();
+
+	if (count < ring.size())
+		count++;
+}
+
+/*
+ * Writes all frames in the ring, the oldest first, into a new file in the
+ * capture directory. The frames stay in the ring.
+ */
+bool amx::PacketCapture::dump(const string& reason)
+{
+	DECL_TRACER("PacketCapture::dump(const string& reason)");
+
+	if (!enabled)
+		return false;
+
+	vector<CAP_FRAME> frames;
+	snapshot(frames);
+	lock_guard<mutex> dlock(dumpMut);
+	return writeFile(frames, reason);
+}
+
+/*
+ * Copies the frames in the ring, the oldest first.
+ */
+void amx::PacketCapture::snapshot(vector<CAP_FRAME>& frames)
+{
+	lock_guard<mutex> lock(mut);
+
+	if (ring.empty())
+		return;
+
+	frames.reserve(count);
+	size_t start = (next + ring.size() - count) % ring.size();
+
+	for (size_t i = 0; i < count; i++)
+		frames.push_back(ring[(start + i) % ring.size()]);
+}
+
+/*
+ * Writes the \a frames into a new file in the capture directory. dumpMut
+ * must be locked.
+ */
+bool amx::PacketCapture::writeFile(const vector<CAP_FRAME>& frames, const string& reason)
+{
+	char ts[32];
+	time_t t = time(nullptr);
+	struct tm lt;
+	localtime_r(&t, &lt);
+	strftime(ts, sizeof(ts), "%Y%m%d-%H%M%S", &lt);
+	string fname = capDir+"/amxpanel."+to_string(getpid())+"."+ts+".pcap";
+	FILE *fp = fopen(fname.c_str(), "wb");
+
+	if (!fp)
+	{
+		sysl->errlog("PacketCapture::writeFile: Error creating file "+fname+": "+strerror(errno));
+		return false;
+	}
+
+	CAP_FILE_HEADER hdr;
+	hdr.magic = CAP_MAGIC;
+	hdr.major = CAP_VERSION_MAJOR;
+	hdr.minor = CAP_VERSION_MINOR;
+	hdr.thiszone = 0;
+	hdr.sigfigs = 0;
+	hdr.snaplen = CAP_SNAPLEN + sizeof(CAP_PSEUDO_HEADER);
+	hdr.linktype = CAP_LINKTYPE;
+	bool ok = (fwrite(&hdr, sizeof(hdr), 1, fp) == 1);
+
+	for (size_t i = 0; ok && i < frames.size(); i++)
+	{
+		const CAP_FRAME& fr = frames[i];
+		CAP_RECORD_HEADER rec;
+		CAP_PSEUDO_HEADER ph;
+		memset(&ph, 0, sizeof(ph));
+		ph.direction = fr.direction;
+		ph.panel = htonl(fr.panel);
+		rec.sec = (uint32_t)fr.stamp.tv_sec;
+		rec.usec = (uint32_t)fr.stamp.tv_usec;
+		rec.incl_len = fr.len + sizeof(ph);
+		rec.orig_len = fr.origLen + sizeof(ph);
+		ok = fwrite(&rec, sizeof(rec), 1, fp) == 1 &&
+			 fwrite(&ph, sizeof(ph), 1, fp) == 1 &&
+			 fwrite(fr.data, 1, fr.len, fp) == fr.len;
+	}
+
+	if (fclose(fp) != 0)
+		ok = false;
+
+	if (!ok)
+	{
+		sysl->errlog("PacketCapture::writeFile: Error writing file "+fname+": "+strerror(errno));
+		return false;
+	}
+
+	sysl->log(Syslog::INFO, "PacketCapture::writeFile: Wrote "+to_string(frames.size())+" frames to "+fname+" ("+reason+")");
+	return true;
+}
+
+/*
+ * Dumps the ring because of an error. To keep a flapping connection from
+ * filling the disk, there is at most one dump in CAP_ERROR_WAIT seconds.
+ * This is called by the thread reading from the controller. Only the copy
+ * of the ring is made here, the file is written by a thread of its own.
+ */
+void amx::PacketCapture::dumpOnError(const string& reason)
+{
+	DECL_TRACER("PacketCapture::dumpOnError(const string& reason)");
+
+	if (!enabled)
+		return;
+
+	time_t t = time(nullptr);
+
+	{
+		lock_guard<mutex> lock(dumpMut);
+
+		if (lastErrorDump != 0 && (t - lastErrorDump) < CAP_ERROR_WAIT)
+			return;
+
+		lastErrorDump = t;
+	}
+
+	vector<CAP_FRAME> frames;
+	snapshot(frames);
+
+	try
+	{
+		thread thr = thread([this, frames = std::move(frames), reason] {
+			lock_guard<mutex> lock(dumpMut);
+			writeFile(frames, reason);
+		});
+
+		thr.detach();
+	}
+	catch (std::exception& e)
+	{
+		sysl->errlog(string("PacketCapture::dumpOnError: Error starting the dump thread: ")+e.what());
+	}
+}
+
+/*
+ * A signal handler must not write files. It only sets a flag, which is
+ * checked here once a second.
+ */
+void amx::PacketCapture::run()
+{
+	while (!killed)
+	{
+		sleep(1);
+
+		if (dumpRequested.exchange(false))
+			dump("requested by signal");
+	}
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <ctime>
+#include <sys/time.h>
+
+namespace amx
+{
+	/*
+	 * Keeps the last ICSP frames exchanged with the controller in a ring
+	 * buffer of a fixed size. Nothing is formatted while capturing. The
+	 * frames are written into a pcap file (see capfile.h) on demand (signal
+	 * SIGUSR1) or if an error occured on the connection to the controller.
+	 *
+	 * With a sample rate of n only every n-th frame is kept.
+	 */
+	#define CAP_SNAPLEN		2048	// Maximum number of bytes kept of a frame
+	#define CAP_ERROR_WAIT	60		// Minimum seconds between two dumps on error
+
+	class PacketCapture
+	{
+		public:
+			enum DIRECTION
+			{
+				CAP_IN = 0,			// Read from the controller
+				CAP_OUT = 1			// Written to the controller
+			};
+
+			static PacketCapture& get();
+			static bool isEnabled() { return enabled; }
+			static void requestDump() { dumpRequested = true; }
+
+			void init(size_t frames, int sample, const std::string& dir);
+			void add(DIRECTION dir, int panel, const unsigned char *data, size_t len);
+			bool dump(const std::string& reason);
+			void dumpOnError(const std::string& reason);
+
+		private:
+			typedef struct CAP_FRAME
+			{
+				struct timeval stamp;
+				uint32_t panel{0};
+				uint8_t direction{0};
+				uint32_t origLen{0};
+				uint32_t len{0};
+				unsigned char data[CAP_SNAPLEN];
+			}CAP_FRAME;
+
+			PacketCapture() = default;
+
+			void run();
+			void snapshot(std::vector<CAP_FRAME>& frames);
+			bool writeFile(const std::vector<CAP_FRAME>& frames, const std::string& reason);
+
+			static std::atomic<bool> enabled;
+			static std::atomic<bool> dumpRequested;
+			bool threadStarted{false};
+
+			std::vector<CAP_FRAME> ring;
+			size_t next{0};					// Position of the next frame to write
+			size_t count{0};				// Number of valid frames in the ring
+			std::atomic<int> sample{1};		// Read by add() without the lock
+			std::atomic<uint64_t> seen{0};	// Number of frames offered
+			std::string capDir;
+			time_t lastErrorDump{0};
+			std::mutex mut;
+			std::mutex dumpMut;
+	};
+}
+
+#endif
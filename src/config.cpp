@@ -36,7 +36,7 @@ runtime_error rConfig("Error opening a file");
 
 Config::Config()
 {
-	sysl->TRACE(Syslog::ENTRY, string("Config::Config()"));
+	TRACER(Syslog::ENTRY, string("Config::Config()"));
 	this->fflag = false;
 	initialized = false;
 	Debug = false;
@@ -100,6 +100,29 @@ void Config::init()
 	grp = "nobody";
 	LogFile = "";
 	ClientLog = "";
+	logAsync = true;
+	logQueueSize = 4096;
+	logRotateSize = 0;
+	logRotateCount = 5;
+	traceDir.clear();
+	tracePanel = 0;
+	metricsListen = "127.0.0.1";
+	metricsPort = 0;
+	captureFrames = 512;
+	captureSample = 1;
+	captureDir = "/tmp";
+	allocLogInterval = 300;
+	webSocketBinary = false;
+	webSocketThreads = 0;
+	webSocketDeflate = true;
+	deflateWindowBits = 11;
+	deflateThreshold = 256;
+	webSocketHighWater = 262144;
+	webSocketSlowTimeout = 30;
+	webSocketBatchTime = 0;
+	levelRate = 30;
+	levelRates.clear();
+	levelSendInterval = 50;
 	FontPath = "/usr/share/amxpanel/fonts";
 	web_location = "/amxpanel";
 //	AMXPanelType = "MVS-5200i";
@@ -187,6 +210,84 @@ void Config::readConfig(const string &sFile)
 				LogFile = right;
 			else if (Str::caseCompare(left, "CLIENTLOG") == 0 && !right.empty())
 				ClientLog = right;
+			else if (Str::caseCompare(left, "LogAsync") == 0 && !right.empty())
+			{
+				string b = right;
+
+				if (b.compare("0") == 0 || Str::caseCompare(b, "FALSE") == 0 ||
+					Str::caseCompare(b, "NO") == 0 || Str::caseCompare(b, "OFF") == 0)
+					logAsync = false;
+			}
+			else if (Str::caseCompare(left, "LogQueueSize") == 0 && !right.empty())
+				logQueueSize = stoul(right);
+			else if (Str::caseCompare(left, "LogRotateSize") == 0 && !right.empty())
+				logRotateSize = stoul(right);
+			else if (Str::caseCompare(left, "LogRotateCount") == 0 && !right.empty())
+				logRotateCount = stoi(right);
+			else if (Str::caseCompare(left, "TraceDir") == 0 && !right.empty())
+				traceDir = right;
+			else if (Str::caseCompare(left, "TracePanel") == 0 && !right.empty())
+				tracePanel = stoi(right);
+			else if (Str::caseCompare(left, "MetricsListen") == 0 && !right.empty())
+				metricsListen = right;
+			else if (Str::caseCompare(left, "MetricsPort") == 0 && !right.empty())
+				metricsPort = stoi(right);
+			else if (Str::caseCompare(left, "CaptureFrames") == 0 && !right.empty())
+				captureFrames = stoi(right);
+			else if (Str::caseCompare(left, "CaptureSample") == 0 && !right.empty())
+				captureSample = stoi(right);
+			else if (Str::caseCompare(left, "CaptureDir") == 0 && !right.empty())
+				captureDir = right;
+			else if (Str::caseCompare(left, "AllocLogInterval") == 0 && !right.empty())
+				allocLogInterval = stoi(right);
+			else if (Str::caseCompare(left, "WebSocketBinary") == 0 && !right.empty())
+			{
+				string b = right;
+
+				if (b.compare("1") == 0 || Str::caseCompare(b, "TRUE") == 0 ||
+					Str::caseCompare(b, "YES") == 0 || Str::caseCompare(b, "ON") == 0)
+					webSocketBinary = true;
+			}
+			else if (Str::caseCompare(left, "WebSocketThreads") == 0 && !right.empty())
+				webSocketThreads = stoi(right);
+			else if (Str::caseCompare(left, "WebSocketDeflate") == 0 && !right.empty())
+			{
+				string b = right;
+
+				if (b.compare("0") == 0 || Str::caseCompare(b, "FALSE") == 0 ||
+					Str::caseCompare(b, "NO") == 0 || Str::caseCompare(b, "OFF") == 0)
+					webSocketDeflate = false;
+			}
+			else if (Str::caseCompare(left, "DeflateWindowBits") == 0 && !right.empty())
+			{
+				// zlib accepts window sizes of 2^9 up to 2^15 bytes.
+				deflateWindowBits = stoi(right);
+
+				if (deflateWindowBits < 9)
+					deflateWindowBits = 9;
+				else if (deflateWindowBits > 15)
+					deflateWindowBits = 15;
+			}
+			else if (Str::caseCompare(left, "DeflateThreshold") == 0 && !right.empty())
+				deflateThreshold = stoul(right);
+			else if (Str::caseCompare(left, "WebSocketHighWater") == 0 && !right.empty())
+				webSocketHighWater = stoul(right);
+			else if (Str::caseCompare(left, "WebSocketSlowTimeout") == 0 && !right.empty())
+				webSocketSlowTimeout = stoi(right);
+			else if (Str::caseCompare(left, "WebSocketBatchTime") == 0 && !right.empty())
+				webSocketBatchTime = stoi(right);
+			else if (Str::caseCompare(left, "LevelRate") == 0 && !right.empty())
+				levelRate = stoi(right);
+			else if (Str::caseCompare(left, "LevelSendInterval") == 0 && !right.empty())
+				levelSendInterval = stoi(right);
+			else if (Str::caseCompare(left, "LevelRatePort") == 0 && !right.empty())
+			{
+				// LevelRatePort=<port>,<updates per second>
+				size_t pos = right.find(',');
+
+				if (pos != string::npos)
+					levelRates[stoi(right.substr(0, pos))] = stoi(right.substr(pos + 1));
+			}
 			else if (Str::caseCompare(left, "FONTPATH") == 0 && !right.empty())
 				FontPath = right;
 			else if (Str::caseCompare(left, "WEBLOCATION") == 0 && !right.empty())
@@ -291,6 +392,20 @@ void Config::parseNets(string& nets)
 	}
 }
 
+/*
+ * Returns the maximum number of updates per second a browser gets for a
+ * level on the \a port. 0 means no limit.
+ */
+int Config::getLevelRate(int port)
+{
+	map<int, int>::iterator itr = levelRates.find(port);
+
+	if (itr != levelRates.end())
+		return itr->second;
+
+	return levelRate;
+}
+
 bool Config::isAllowedNet(string& net)
 {
 	DECL_TRACER("Config::isAllowedNet(string& net)");
@@ -357,7 +472,7 @@ bool Config::isAllowedNet(string& net)
 
 Config::~Config()
 {
-//	sysl->TRACE(Syslog::EXIT, string("Config::Config()"));
+//	TRACER(Syslog::EXIT, string("Config::Config()"));
 
 	if (this->fflag)
 	{
@@ -25,6 +25,7 @@ extern "C" {
 }
 #include <string>
 #include <vector>
+#include <map>
 
 class Config
 {
@@ -58,6 +59,28 @@ class Config
 		bool isAllowedNet(std::string& net);
 		bool getWSStatus() { return wsStatus; }
 		std::string getClientLog() { return ClientLog; }
+		bool getLogAsync() { return logAsync; }
+		size_t getLogQueueSize() { return logQueueSize; }
+		size_t getLogRotateSize() { return logRotateSize; }
+		int getLogRotateCount() { return logRotateCount; }
+		std::string getTraceDir() { return traceDir; }
+		int getTracePanel() { return tracePanel; }
+		std::string getMetricsListen() { return metricsListen; }
+		int getMetricsPort() { return metricsPort; }
+		int getCaptureFrames() { return captureFrames; }
+		int getCaptureSample() { return captureSample; }
+		std::string getCaptureDir() { return captureDir; }
+		int getAllocLogInterval() { return allocLogInterval; }
+		bool getWebSocketBinary() { return webSocketBinary; }
+		int getWebSocketThreads() { return webSocketThreads; }
+		bool getWebSocketDeflate() { return webSocketDeflate; }
+		int getDeflateWindowBits() { return deflateWindowBits; }
+		size_t getDeflateThreshold() { return deflateThreshold; }
+		size_t getWebSocketHighWater() { return webSocketHighWater; }
+		int getWebSocketSlowTimeout() { return webSocketSlowTimeout; }
+		int getWebSocketBatchTime() { return webSocketBatchTime; }
+		int getLevelRate(int port);
+		int getLevelSendInterval() { return levelSendInterval; }
 
 		void setHOME(const std::string& hm) { HOME = hm.data(); }
 
@@ -77,6 +100,29 @@ class Config
 		bool Debug;
 		std::string LogFile;
 		std::string ClientLog;
+		bool logAsync;
+		size_t logQueueSize;
+		size_t logRotateSize;
+		int logRotateCount;
+		std::string traceDir;
+		int tracePanel;
+		std::string metricsListen;
+		int metricsPort;
+		int captureFrames;
+		int captureSample;
+		std::string captureDir;
+		int allocLogInterval;
+		bool webSocketBinary;
+		int webSocketThreads;
+		bool webSocketDeflate;
+		int deflateWindowBits;
+		size_t deflateThreshold;
+		size_t webSocketHighWater;
+		int webSocketSlowTimeout;
+		int webSocketBatchTime;
+		int levelRate;						// Level updates per second to a browser
+		std::map<int, int> levelRates;		// Port --> level updates per second
+		int levelSendInterval;
 		std::string FontPath;
 		std::string web_location;
 		std::string AMXPanelType;
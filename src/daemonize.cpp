@@ -35,6 +35,7 @@
 #include "daemonize.h"
 #include "config.h"
 #include "trace.h"
+#include "capture.h"
 
 using namespace std;
 
@@ -52,7 +53,7 @@ void sig_handler(int sig);
 
 Daemonize::Daemonize()
 {
-	sysl->TRACE(Syslog::ENTRY, std::string("Daemonize::Daemonize()"));
+	TRACER(Syslog::ENTRY, std::string("Daemonize::Daemonize()"));
 }
 
 /*
@@ -76,17 +77,17 @@ void Daemonize::daemon_start (bool ignsigcld)
 #ifdef SIGTSTP
 	signal (SIGTSTP, SIG_IGN);
 #endif
-	sysl->TRACE("Daemonize::daemon_start: forking ...");
+	TRACER("Daemonize::daemon_start: forking ...");
 
 	if ((childpid = fork ()) < 0)
 		sysl->errlog(string("Can't fork this child"));
 	else if (childpid > 0)
 	{
-		sysl->TRACE("Daemonize::daemon_start: Parent exit!");
+		TRACER("Daemonize::daemon_start: Parent exit!");
 		exit (0);            /* Parent */
 	}
 
-	sysl->TRACE("Daemonize::daemon_start: Child goes on ...");
+	TRACER("Daemonize::daemon_start: Child goes on ...");
 
 	if (setpgrp () == -1)
         sysl->errlog(string("Can't change process group"));
@@ -97,7 +98,7 @@ void Daemonize::daemon_start (bool ignsigcld)
 		sysl->errlog (string("Can't fork second child"));
 	else if (childpid > 0)
 	{
-		sysl->TRACE("Daemonize::daemon_start: First child exit!");
+		TRACER("Daemonize::daemon_start: First child exit!");
 		exit (0);            // first child
 	}
 */
@@ -121,6 +122,10 @@ out:
 	if (signal(SIGTERM, sig_handler) == SIG_ERR)
 		sysl->warnlog(string("Can't catch signal SIGTERM!"));
 
+	// SIGUSR1 writes the packet capture into a file
+	if (signal(SIGUSR1, sig_handler) == SIG_ERR)
+		sysl->warnlog(string("Can't catch signal SIGUSR1!"));
+
 	ofstream of;
 	/* Create PID file */
 	of.open(Configuration->getPidFile().data(), ofstream::out | ofstream::binary | ofstream::trunc);
@@ -162,7 +167,7 @@ void Daemonize::changeToUser(const std::string &usr, const std::string &grp)
 		else
 			gr_gid = userpwd->pw_gid;
 
-		sysl->TRACE("Daemonize::changeToUser: GID="+to_string(gr_gid));
+		TRACER("Daemonize::changeToUser: GID="+to_string(gr_gid));
 
 		if (setegid(gr_gid) == -1)
 		{
@@ -171,7 +176,7 @@ void Daemonize::changeToUser(const std::string &usr, const std::string &grp)
 //			exit(EXIT_FAILURE);
 		}
 
-		sysl->TRACE("Daemonize::changeToUser: Group changed.");
+		TRACER("Daemonize::changeToUser: Group changed.");
 
 #ifdef _BSD_SOURCE
 		/* init suplementary groups
@@ -181,7 +186,7 @@ void Daemonize::changeToUser(const std::string &usr, const std::string &grp)
 			sysl->errlog("cannot init suplementary groups of user "+usr+": "+std::string(strerror(errno)));
 #endif
 
-		sysl->TRACE("Daemonize::changeToUser: UID="+to_string(userpwd->pw_uid));
+		TRACER("Daemonize::changeToUser: UID="+to_string(userpwd->pw_uid));
 		/* set uid */
 		if (setuid(userpwd->pw_uid) == -1)
 		{
@@ -189,21 +194,21 @@ void Daemonize::changeToUser(const std::string &usr, const std::string &grp)
 			return;
 		}
 
-		sysl->TRACE("Daemonize::changeToUser: User changed.");
+		TRACER("Daemonize::changeToUser: User changed.");
 
 		if (userpwd->pw_dir)
 		{
 			setenv("HOME", userpwd->pw_dir, 1);
 			Configuration->setHOME(userpwd->pw_dir);
 			Configuration->Initialize();
-			sysl->TRACE("Daemonize::changeToUser: HOME="+string(userpwd->pw_dir));
+			TRACER("Daemonize::changeToUser: HOME="+string(userpwd->pw_dir));
 		}
 	}
 }
 
 Daemonize::~Daemonize()
 {
-	sysl->TRACE(Syslog::EXIT, std::string("Daemonize::Daemonize()"));
+	TRACER(Syslog::EXIT, std::string("Daemonize::Daemonize()"));
 }
 
 void sig_child (int /* x */)
@@ -225,6 +230,13 @@ void sig_child (int /* x */)
  */
 void sig_handler(int sig)
 {
+	// Only set a flag here. The file is written by the capture thread.
+	if (sig == SIGUSR1)
+	{
+		amx::PacketCapture::requestDump();
+		return;
+	}
+
 	DECL_TRACER("sig_handler(int sig) [sig="+std::to_string(sig)+"]");
 
 	if (sig == SIGTERM || sig == SIGKILL)
@@ -156,12 +156,12 @@ int Directory::readDir()
 					snprintf(buf, sizeof(buf), "%c%c%c %8zu %4d-%02d-%02d %02d:%02d:%02d %s", d, g, l, dr.size, t->tm_year + 1900, t->tm_mon+1, t->tm_mday,
                          t->tm_hour, t->tm_min, t->tm_sec, dr.name.c_str());
 
-				sysl->TRACE(string("Directory::readDir: ")+buf);
+				TRACER(string("Directory::readDir: ")+buf);
 			}
 		}
 
 		done = true;
-		sysl->TRACE("Directory::readDir: Read "+to_string(count)+" entries.");
+		TRACER("Directory::readDir: Read "+to_string(count)+" entries.");
 	}
 	catch(exception& e)
 	{
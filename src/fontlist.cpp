@@ -32,6 +32,7 @@
 #include "syslog.h"
 #include "nameformat.h"
 #include "fontlist.h"
+#include "xmltags.h"
 #include "str.h"
 #include "trace.h"
 
@@ -43,7 +44,7 @@ using namespace amx;
 
 amx::FontList::FontList(const string& file)
 {
-	sysl->TRACE(Syslog::ENTRY, std::string("FontList::FontList(const string& file)"));
+	TRACER(Syslog::ENTRY, std::string("FontList::FontList(const string& file)"));
 	// Clear the empty font
 	emptyFont.number = 0;
 	emptyFont.fileSize = 0;
@@ -52,13 +53,13 @@ amx::FontList::FontList(const string& file)
 	emptyFont.usageCount = 0;
 	fillSysFonts();
 	FONT_T font;
-	string lastName;
+	XMLTAG lastTag = 0;
 	int fi = 0;
 	string uri = "file://";
 	uri.append(Configuration->getHTTProot());
 	uri.append("/");
 	uri.append(file);
-	sysl->TRACE("FontList::FontList: Parsing file "+uri);
+	TRACER("FontList::FontList: Parsing file "+uri);
 
 	try
 	{
@@ -66,50 +67,53 @@ amx::FontList::FontList(const string& file)
 
 		while(reader.read())
 		{
-			Str name(reader.get_name().raw());
-
-			if (name.get().at(0) == '#')
-				name.set(lastName);
+			string name = reader.get_name().raw();
+			XMLTAG tag = (!name.empty() && name[0] == '#') ? lastTag : tagHash(name);
+			lastTag = tag;
 
 			if (reader.has_attributes())
 				fi = atoi(reader.get_attribute(0).c_str());
 
-			if (name.caseCompare("font") == 0 && reader.has_attributes() && fi != font.number)
+			if (tag == "font"_tag)
+			{
+				if (reader.has_attributes() && fi != font.number)
+				{
+					font.number = fi;
+					font.file.clear();
+					font.fileSize = 0;
+					font.faceIndex = 0;
+					font.name.clear();
+					font.subfamilyName.clear();
+					font.fullName.clear();
+					font.size = 0;
+					font.usageCount = 0;
+					fontList.push_back(font);
+					TRACER("FontList::FontList: Added font number: "+to_string(font.number));
+				}
+
+				continue;
+			}
+
+			if (!reader.has_value())
+				continue;
+
+			string value = reader.get_value().raw();
+
+			switch (tag)
 			{
-				font.number = fi;
-				font.file.clear();
-				font.fileSize = 0;
-				font.faceIndex = 0;
-				font.name.clear();
-				font.subfamilyName.clear();
-				font.fullName.clear();
-				font.size = 0;
-				font.usageCount = 0;
-				fontList.push_back(font);
-				sysl->TRACE("FontList::FontList: Added font number: "+to_string(font.number));
+				case "file"_tag:			fontList.back().file = value; break;
+				case "fileSize"_tag:		fontList.back().fileSize = atoi(value.c_str()); break;
+				case "faceIndex"_tag:		fontList.back().faceIndex = atoi(value.c_str()); break;
+				case "name"_tag:			fontList.back().name = value; break;
+				case "subfamilyName"_tag:	fontList.back().subfamilyName = value; break;
+				case "fullName"_tag:		fontList.back().fullName = value; break;
+				case "size"_tag:			fontList.back().size = atoi(value.c_str()); break;
+				case "usageCount"_tag:		fontList.back().usageCount = atoi(value.c_str()); break;
 			}
-			else if (name.caseCompare("file") == 0 && reader.has_value())
-				fontList.back().file = reader.get_value().raw();
-			else if (name.caseCompare("fileSize") == 0 && reader.has_value())
-				fontList.back().fileSize = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("faceIndex") == 0 && reader.has_value())
-				fontList.back().faceIndex = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("name") == 0 && reader.has_value())
-				fontList.back().name = reader.get_value().raw();
-			else if (name.caseCompare("subfamilyName") == 0 && reader.has_value())
-				fontList.back().subfamilyName = reader.get_value().raw();
-			else if (name.caseCompare("fullName") == 0 && reader.has_value())
-				fontList.back().fullName = reader.get_value().raw();
-			else if (name.caseCompare("size") == 0 && reader.has_value())
-				fontList.back().size = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("usageCount") == 0 && reader.has_value())
-				fontList.back().usageCount = atoi(reader.get_value().c_str());
-
-			lastName = name.get();
 		}
 
 		reader.close();
-		sysl->TRACE("FontList::FontList: Found "+to_string(fontList.size())+" fonts.");
+		TRACER("FontList::FontList: Found "+to_string(fontList.size())+" fonts.");
 	}
 	catch (xmlpp::internal_error& e)
 	{
@@ -123,7 +127,7 @@ amx::FontList::FontList(const string& file)
 
 amx::FontList::~FontList()
 {
-	sysl->TRACE(Syslog::EXIT, std::string("FontList::FontList(...)"));
+	TRACER(Syslog::EXIT, std::string("FontList::FontList(...)"));
 }
 
 string amx::FontList::getFontStyles()
@@ -229,7 +233,7 @@ FONT_T& FontList::findFont(int idx)
 			return fontList[i];
 	}
 
-	sysl->TRACE("FontList::findFont: Font ID "+to_string(idx)+" not found. Have "+to_string(fontList.size())+" fonts in cache.");
+	TRACER("FontList::findFont: Font ID "+to_string(idx)+" not found. Have "+to_string(fontList.size())+" fonts in cache.");
 	return emptyFont;
 }
 
@@ -43,14 +43,14 @@ using namespace amx;
 
 Icon::Icon(const string& file)
 {
-	sysl->TRACE(Syslog::ENTRY, "Icon::Icon(const string& file)");
+	TRACER(Syslog::ENTRY, "Icon::Icon(const string& file)");
 	int index = 0;
 	string lastName;
 	string uri = "file://";
 	uri.append(Configuration->getHTTProot());
 	uri.append("/");
 	uri.append(file);
-	sysl->TRACE("Icon::Icon: Parsing file "+uri);
+	TRACER("Icon::Icon: Parsing file "+uri);
 
 	try
 	{
@@ -85,7 +85,7 @@ Icon::Icon(const string& file)
 
 				icons.push_back(ico);
 				index = -1;
-				sysl->TRACE("Icon::Icon: index="+to_string(ico.index)+", file="+ico.file);
+				TRACER("Icon::Icon: index="+to_string(ico.index)+", file="+ico.file);
 			}
 
 			lastName = name.get();
@@ -105,7 +105,7 @@ Icon::Icon(const string& file)
 
 Icon::~Icon()
 {
-    sysl->TRACE(Syslog::EXIT, "Icon::~Icon(const string& file)");
+    TRACER(Syslog::EXIT, "Icon::~Icon(const string& file)");
 }
 
 string Icon::getFileName(size_t idx)
@@ -156,11 +156,11 @@ string Icon::getFileFromID(int id)
 	{
 		if (icons[i].index == id)
 		{
-			sysl->TRACE("Icon::getFileFromID: ID "+to_string(id)+" with file "+icons[i].file+" found.");
+			TRACER("Icon::getFileFromID: ID "+to_string(id)+" with file "+icons[i].file+" found.");
 			return icons[i].file;
 		}
 	}
 
-	sysl->TRACE("Icon::getFileFromID: No icon for ID "+to_string(id)+" found!");
+	TRACER("Icon::getFileFromID: No icon for ID "+to_string(id)+" found!");
 	return "";
 }
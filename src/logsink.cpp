@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <syslog.h>
+#include "logsink.h"
+#include "allocstats.h"
+
+#define LS_BATCH		256		// Maximum number of records written at once
+#define LS_WAIT			50		// Milliseconds to wait if the buffer is empty
+
+using namespace std;
+
+LogSink::LogSink(const string& pn, int opt, int fac, const string& lf,
+				 size_t queueSize, size_t rs, int rc)
+			: pname(pn),
+			  option(opt),
+			  facility(fac),
+			  LogFile(lf),
+			  rotateSize(rs),
+			  rotateCount(rc)
+{
+	size_t size = 16;
+
+	while (size < queueSize)
+		size <<= 1;
+
+	ring.reset(new LOG_RECORD[size]);
+	mask = size - 1;
+
+	for (size_t i = 0; i < size; i++)
+		ring[i].seq.store(i, memory_order_relaxed);
+}
+
+LogSink::~LogSink()
+{
+	stop();
+}
+
+bool LogSink::start()
+{
+	if (running)
+		return true;
+
+	if (!LogFile.empty())
+		openFile();
+
+	openlog(pname.c_str(), option, facility);
+	syslogOpen = true;
+
+	try
+	{
+		running = true;
+		worker = thread([this] { run(); });
+	}
+	catch (exception& e)
+	{
+		running = false;
+		syslog(LOG_ERR, "LogSink::start: Error starting the log thread: %s", e.what());
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Stops the background thread. All messages still in the buffer are
+ * written before the thread ends.
+ */
+void LogSink::stop()
+{
+	if (!running)
+		return;
+
+	running = false;
+	waitCond.notify_one();
+
+	if (worker.joinable())
+		worker.join();
+
+	if (file.is_open())
+		file.close();
+
+	if (syslogOpen)
+	{
+		closelog();
+		syslogOpen = false;
+	}
+}
+
+/*
+ * Puts a message into the ring buffer. This is called by any thread and
+ * never blocks. If the buffer is full, the message is dropped and false is
+ * returned.
+ */
+bool LogSink::push(int level, int flags, const string& msg)
+{
+	size_t pos = head.load(memory_order_relaxed);
+	LOG_RECORD *rec;
+
+	for (;;)
+	{
+		rec = &ring[pos & mask];
+		size_t seq = rec->seq.load(memory_order_acquire);
+		intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+		if (dif == 0)
+		{
+			if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+				break;
+		}
+		else if (dif < 0)
+		{
+			dropped++;
+			return false;
+		}
+		else
+			pos = head.load(memory_order_relaxed);
+	}
+
+	rec->stamp = time(nullptr);
+	rec->level = level;
+	rec->flags = flags;
+	rec->text = msg;
+	rec->seq.store(pos + 1, memory_order_release);
+	return true;
+}
+
+void LogSink::run()
+{
+	ALLOC_TAG(amx::AT_LOGGING);
+	while (running)
+	{
+		if (drain() == 0)
+		{
+			unique_lock<mutex> lock(waitMutex);
+			waitCond.wait_for(lock, chrono::milliseconds(LS_WAIT));
+		}
+	}
+
+	// Write everything left before the thread ends
+	while (drain() > 0)
+		;
+}
+
+/*
+ * Takes up to LS_BATCH records out of the buffer and writes them. The file
+ * is flushed once per batch and not once per line.
+ */
+size_t LogSink::drain()
+{
+	size_t count = 0;
+	string text;
+
+	while (count < LS_BATCH)
+	{
+		LOG_RECORD& rec = ring[tail & mask];
+
+		if (rec.seq.load(memory_order_acquire) != tail + 1)
+			break;
+
+		text.swap(rec.text);
+		time_t stamp = rec.stamp;
+		int level = rec.level;
+		int flags = rec.flags;
+		rec.seq.store(tail + mask + 1, memory_order_release);
+		tail++;
+		count++;
+
+		write(stamp, level, flags, text);
+	}
+
+	uint64_t drops = dropped.load(memory_order_relaxed);
+
+	if (drops != reportedDrops)
+	{
+		string msg = "LogSink: "+to_string(drops - reportedDrops)+" messages were dropped because the log buffer was full!";
+		reportedDrops = drops;
+		write(time(nullptr), LOG_WARNING, LS_FILE | LS_LEVEL | LS_SYSLOG, msg);
+	}
+
+	if (count > 0 && file.is_open())
+	{
+		file.flush();
+
+		if (rotateSize > 0 && fileSize >= rotateSize)
+			rotate();
+	}
+
+	return count;
+}
+
+void LogSink::write(time_t stamp, int level, int flags, const string& text)
+{
+	if ((flags & LS_FILE) && file.is_open() && !text.empty())
+	{
+		char ts[64];
+		struct tm lt;
+		localtime_r(&stamp, &lt);
+		strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S%z", &lt);
+		string line = string(ts)+": ";
+
+		if (flags & LS_LEVEL)
+			line += string(levelName(level))+": ";
+
+		line += text+"\n";
+		file << line;
+		fileSize += line.length();
+
+		if (!file.good())
+		{
+			syslog(LOG_ERR, "LogSink::write: Error writing to file %s", LogFile.c_str());
+			file.close();
+			fileError = true;
+		}
+	}
+
+	if (flags & LS_SYSLOG)
+		syslog(level, "%s", text.c_str());
+}
+
+bool LogSink::openFile()
+{
+	if (fileError)
+		return false;
+
+	file.open(LogFile, ios::out | ios::app);
+
+	if (!file.is_open())
+	{
+		syslog(LOG_ERR, "LogSink::openFile: Error opening file %s: %s", LogFile.c_str(), strerror(errno));
+		fileError = true;
+		return false;
+	}
+
+	file.seekp(0, ios::end);
+	fileSize = (size_t)file.tellp();
+	return true;
+}
+
+/*
+ * Renames the log file to <file>.1. Existing older files are moved up by one
+ * and the oldest one is removed.
+ */
+void LogSink::rotate()
+{
+	file.close();
+
+	if (rotateCount > 0)
+	{
+		remove((LogFile+"."+to_string(rotateCount)).c_str());
+
+		for (int i = rotateCount - 1; i > 0; i--)
+			rename((LogFile+"."+to_string(i)).c_str(), (LogFile+"."+to_string(i+1)).c_str());
+
+		rename(LogFile.c_str(), (LogFile+".1").c_str());
+	}
+	else
+		remove(LogFile.c_str());
+
+	openFile();
+}
+
+const char *LogSink::levelName(int level)
+{
+	switch (level)
+	{
+		case LOG_EMERG:		return "Emergency";
+		case LOG_ALERT:		return "Alert";
+		case LOG_CRIT:		return "Critical";
+		case LOG_ERR:		return "Error";
+		case LOG_WARNING:	return "Warning";
+		case LOG_NOTICE:	return "Notice";
+		case LOG_INFO:		return "Info";
+		case LOG_DEBUG:		return "Debug";
+	}
+
+	return "";
+}
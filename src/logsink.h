@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __LOGSINK_H__
+#define __LOGSINK_H__
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <ctime>
+
+/*
+ * Asynchronous backend for the class Syslog.
+ *
+ * The threads producing messages put them into a fixed size ring buffer
+ * without taking a lock. A background thread takes the messages out of the
+ * buffer and writes them in batches to the log file and to the syslog. The
+ * log file and the syslog stay open as long as the sink is running.
+ *
+ * If the buffer is full, a message is dropped and counted. The number of
+ * dropped messages is written to the log as soon as there is room again.
+ *
+ * If a maximum size is set, the log file is rotated when it grows beyond
+ * it. The old files get the extensions .1, .2, ... up to the given count.
+ */
+class LogSink
+{
+	public:
+		enum
+		{
+			LS_FILE = 0x01,		// Write the message to the log file
+			LS_LEVEL = 0x02,	// Prefix the message in the file with the level
+			LS_SYSLOG = 0x04	// Send the message to the syslog
+		};
+
+		LogSink(const std::string& pname, int option, int facility, const std::string& file,
+				size_t queueSize, size_t rotateSize, int rotateCount);
+		~LogSink();
+
+		bool start();
+		void stop();
+		bool isRunning() { return running; }
+		bool push(int level, int flags, const std::string& msg);
+		uint64_t getDropped() { return dropped; }
+
+	private:
+		typedef struct LOG_RECORD
+		{
+			std::atomic<size_t> seq;
+			time_t stamp;
+			int level;
+			int flags;
+			std::string text;
+		}LOG_RECORD;
+
+		void run();
+		size_t drain();
+		void write(time_t stamp, int level, int flags, const std::string& text);
+		bool openFile();
+		void rotate();
+		static const char *levelName(int level);
+
+		std::string pname;
+		int option;
+		int facility;
+		std::string LogFile;
+		size_t rotateSize;
+		int rotateCount;
+
+		std::unique_ptr<LOG_RECORD[]> ring;
+		size_t mask{0};
+		std::atomic<size_t> head{0};			// Next position to write to (producers)
+		size_t tail{0};							// Next position to read from (background thread)
+		std::atomic<uint64_t> dropped{0};
+		uint64_t reportedDrops{0};
+
+		std::ofstream file;
+		size_t fileSize{0};
+		bool fileError{false};
+		bool syslogOpen{false};
+
+		std::atomic<bool> running{false};
+		std::thread worker;
+		std::mutex waitMutex;
+		std::condition_variable waitCond;
+};
+
+#endif
@@ -23,9 +23,13 @@
 #include <exception>
 #include "config.h"
 #include "syslog.h"
+#include "trace.h"
 #include "daemonize.h"
 #include "touchpanel.h"
 #include "websocket.h"
+#include "metrics.h"
+#include "capture.h"
+#include "allocstats.h"
 
 Config *Configuration;
 std::string pName;
@@ -50,7 +54,9 @@ int main(int /* argc */, const char **argv)
 	Configuration = new Config();
 	sysl->setDebug(Configuration->getDebug());
 	sysl->setLogFile(Configuration->getLogFile());
-	sysl->TRACE(Syslog::ENTRY, "main(int /* argc */, const char **argv)");
+	TraceContext::setPanelFilter(Configuration->getTracePanel());
+	TraceContext::setTraceDir(Configuration->getTraceDir());
+	TRACER(Syslog::ENTRY, "main(int /* argc */, const char **argv)");
 	sysl->log(Syslog::INFO, pName + " v" + VERSION);
 	sysl->log(Syslog::INFO, "(C) Copyright by Andreas Theofilu <andreas@theosys.at>. All rights reserved!");
 	sysl->log(Syslog::INFO, "Daemon is starting ...");
@@ -58,6 +64,19 @@ int main(int /* argc */, const char **argv)
 	Daemonize daemon;
 	daemon.daemon_start(true);
 	daemon.changeToUser(Configuration->getUser(), Configuration->getGroup());
+
+	// The log thread must be started after the fork.
+	if (Configuration->getLogAsync())
+		sysl->startAsync(Configuration->getLogQueueSize(), Configuration->getLogRotateSize(), Configuration->getLogRotateCount());
+
+	if (Configuration->getMetricsPort() > 0)
+		amx::Metrics::get().start(Configuration->getMetricsListen(), Configuration->getMetricsPort());
+
+	amx::AllocStats::start(Configuration->getAllocLogInterval());
+
+	if (Configuration->getCaptureFrames() > 0)
+		amx::PacketCapture::get().init((size_t)Configuration->getCaptureFrames(), Configuration->getCaptureSample(), Configuration->getCaptureDir());
+
 	sysl->log(Syslog::INFO, pName + " v" + VERSION + ": Startup finished. All components should run now.");
 	// Create the panel
 	pTouchPanel = new amx::TouchPanel();
@@ -69,7 +88,7 @@ int main(int /* argc */, const char **argv)
 	}
 
 	// Upon the previous function exits, clean up end exit.
-	sysl->TRACE(Syslog::EXIT, "main(int /* argc */, const char **argv)");
+	TRACER(Syslog::EXIT, "main(int /* argc */, const char **argv)");
 	delete pTouchPanel;
 	delete sysl;
 	delete Configuration;
@@ -31,6 +31,8 @@
 #include "config.h"
 #include "syslog.h"
 #include "nameformat.h"
+#include "xmlinput.h"
+#include "xmltags.h"
 #include "trace.h"
 #include "str.h"
 #include "map.h"
@@ -44,14 +46,14 @@ using namespace amx;
 Map::Map(const std::string& rFile)
 	: fname(rFile)
 {
-	sysl->TRACE(Syslog::ENTRY, std::string("Map::Map()"));
+	TRACER(Syslog::ENTRY, std::string("Map::Map()"));
 	done = false;
 	parse();
 }
 
 Map::~Map()
 {
-	sysl->TRACE(Syslog::EXIT, std::string("Map::~Map()"));
+	TRACER(Syslog::EXIT, std::string("Map::~Map()"));
 }
 
 void Map::parse()
@@ -65,43 +67,13 @@ void Map::parse()
 	uri.append(Configuration->getHTTProot());
 	uri.append("/");
 	uri.append(fname);
-	sysl->TRACE("Map::parse: Reading file: "+uri);
+	TRACER("Map::parse: Reading file: "+uri);
 
 	try
 	{
-		ifstream xml(uri.c_str(), ifstream::binary);
-
-		if (!xml)
-		{
-			sysl->errlog("Map::parse: Error opening the file "+uri);
-			return;
-		}
-
-		string buffer;
-
-		try
-		{
-			xml.seekg(0, xml.end);
-			size_t length = xml.tellg();
-			xml.seekg(0, xml.beg);
-			buffer.resize(length, ' ');
-			char *begin = &*buffer.begin();
-			xml.read(begin, length);
-		}
-		catch (exception& e)
-		{
-			sysl->errlog(string("Map::parse: Error reading a file: ")+e.what());
-			xml.close();
-			return;
-		}
-
-		xml.close();
-		sysl->TRACE("Map::parse: length of file: "+to_string(buffer.length()));
-		// Convert from CP1250 (Windblows) to UTF-8.
-		string cbuf = NameFormat::cp1250ToUTF8(buffer);
-		buffer.clear();
-
-		xmlpp::TextReader reader((const unsigned char *)cbuf.c_str(), cbuf.length());
+		// The file is mapped into memory and converted to UTF-8 while
+		// the parser reads it.
+		xmlpp::TextReader reader(XmlInput::getUri(uri));
 		bool cm = false;
 		bool am = false;
 		bool lm = false;
@@ -111,208 +83,134 @@ void Map::parse()
 		bool strm = false;
 		bool pm = false;
 		bool me = false;
-		std::string lastName;
+		XMLTAG lastTag = 0;
 
 		while (reader.read())
 		{
-			Str name(reader.get_name().raw());
+			string name = reader.get_name().raw();
+			XMLTAG tag = tagHash(name);
 
-			if (name.caseCompare("cm") == 0 && !cm)
-				cm = true;
-			else if (name.caseCompare("cm") == 0 && cm)
-				cm = false;
-
-			if (name.caseCompare("am") == 0 && !am)
-				am = true;
-			else if (name.caseCompare("am") == 0 && am)
-				am = false;
-
-			if (name.caseCompare("lm") == 0 && !lm)
-				lm = true;
-			else if (name.caseCompare("lm") == 0 && lm)
-				lm = false;
-
-			if (name.caseCompare("bm") == 0 && !bm)
-				bm = true;
-			else if (name.caseCompare("bm") == 0 && bm)
-				bm = false;
+			switch (tag)
+			{
+				case "cm"_tag:		cm = !cm; break;
+				case "am"_tag:		am = !am; break;
+				case "lm"_tag:		lm = !lm; break;
+				case "bm"_tag:		bm = !bm; break;
+				case "im"_tag:		im = !im; break;
+				case "sm"_tag:		sm = !sm; break;
+				case "strm"_tag:	strm = !strm; break;
+				case "pm"_tag:		pm = !pm; break;
+
+				case "me"_tag:
+					me = !me;
+
+					if (!me)
+						break;
+
+					if (cm || am || lm || strm)
+					{
+						MAP_T map;
+						map.ax = 0;
+						map.bt = 0;
+						map.c = 0;
+						map.p = 0;
+						map.pg = 0;
+
+						if (cm)
+							maps.map_cm.push_back(map);
+						else if (am)
+							maps.map_am.push_back(map);
+						else if (lm)
+							maps.map_lm.push_back(map);
+						else if (strm)
+							maps.map_strm.push_back(map);
+					}
+					else if (bm && im)
+					{
+						MAP_BM_T map;
+						map.id = 0;
+						map.bt = 0;
+						map.pg = 0;
+						map.rt = 0;
+						map.sl = 0;
+						map.st = 0;
+						maps.map_bm.push_back(map);
+					}
+					else if (pm)
+					{
+						MAP_PM_T map;
+						map.a = 0;
+						map.pg = 0;
+						map.bt = 0;
+						maps.map_pm.push_back(map);
+					}
+				break;
+
+				case "#text"_tag:
+					tag = lastTag;
+				break;
+			}
 
-			if (name.caseCompare("im") == 0 && !im)
-				im = true;
-			else if (name.caseCompare("im") == 0 && im)
-				im = false;
+			lastTag = tag;
 
-			if (name.caseCompare("sm") == 0 && !sm)
-				sm = true;
-			else if (name.caseCompare("sm") == 0 && sm)
-				sm = false;
+			if (!me || !reader.has_value())
+				continue;
 
-			if (name.caseCompare("strm") == 0 && !strm)
-				strm = true;
-			else if (name.caseCompare("strm") == 0 && strm)
-				strm = false;
+			string value = reader.get_value().raw();
 
-			if (name.caseCompare("pm") == 0 && !pm)
-				pm = true;
-			else if (name.caseCompare("pm") == 0 && pm)
-				pm = false;
+			if (value.find("\n") != string::npos)
+				continue;
 
-			if (name.caseCompare("me") == 0 && !me)
+			if (cm || am || lm || strm)
 			{
-				me = true;
+				MAP_T& map = cm ? maps.map_cm.back() : am ? maps.map_am.back() : lm ? maps.map_lm.back() : maps.map_strm.back();
 
-				if (cm || am || lm || strm)
-				{
-					MAP_T map;
-					map.ax = 0;
-					map.bt = 0;
-					map.c = 0;
-					map.p = 0;
-					map.pg = 0;
-
-					if (cm)
-						maps.map_cm.push_back(map);
-					else if (am)
-						maps.map_am.push_back(map);
-					else if (lm)
-						maps.map_lm.push_back(map);
-					else if (strm)
-						maps.map_strm.push_back(map);
-				}
-				else if (bm && im)
+				switch (tag)
 				{
-					MAP_BM_T map;
-					map.id = 0;
-					map.bt = 0;
-					map.id = 0;
-					map.pg = 0;
-					map.rt = 0;
-					map.sl = 0;
-					map.st = 0;
-					maps.map_bm.push_back(map);
-				}
-				else if (pm)
-				{
-					MAP_PM_T map;
-					map.a = 0;
-					map.pg = 0;
-					map.bt = 0;
-					maps.map_pm.push_back(map);
+					case "p"_tag:	map.p = atoi(value.c_str()); break;
+					case "c"_tag:	map.c = atoi(value.c_str()); break;
+					case "ax"_tag:	if (lm && !cm && !am) map.ax = atoi(value.c_str()); break;
+					case "pg"_tag:	map.pg = atoi(value.c_str()); break;
+					case "bt"_tag:	map.bt = atoi(value.c_str()); break;
+					case "pn"_tag:	map.pn = value; break;
+					case "bn"_tag:	map.bn = value; break;
 				}
 			}
-			else if (name.caseCompare("me") == 0 && me)
-				me = false;
-
-			if (name.get().compare("#text") == 0)
-				name.set(lastName);
-
-			if (reader.has_value() && reader.get_value().raw().find("\n") != string::npos)
-				continue;
-
-			if (cm && me && reader.has_value())
+			else if (bm && im)
 			{
-				if (name.caseCompare("p") == 0)
-					maps.map_cm.back().p = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("c") == 0)
-					maps.map_cm.back().c = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pg") == 0)
-					maps.map_cm.back().pg = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("bt") == 0)
-					maps.map_cm.back().bt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pn") == 0)
-					maps.map_cm.back().pn = reader.get_value().raw();
-				else if (name.caseCompare("bn") == 0)
-					maps.map_cm.back().bn = reader.get_value().raw();
-			}
-			else if (am && me && reader.has_value())
-			{
-				if (name.caseCompare("p") == 0)
-					maps.map_am.back().p = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("c") == 0)
-					maps.map_am.back().c = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pg") == 0)
-					maps.map_am.back().pg = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("bt") == 0)
-					maps.map_am.back().bt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pn") == 0)
-					maps.map_am.back().pn = reader.get_value().raw();
-				else if (name.caseCompare("bn") == 0)
-					maps.map_am.back().bn = reader.get_value().raw();
-			}
-			else if (lm && me && reader.has_value())
-			{
-				if (name.caseCompare("p") == 0)
-					maps.map_lm.back().p = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("c") == 0)
-					maps.map_lm.back().c = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ax") == 0)
-					maps.map_lm.back().ax = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pg") == 0)
-					maps.map_lm.back().pg = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("bt") == 0)
-					maps.map_lm.back().bt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pn") == 0)
-					maps.map_lm.back().pn = reader.get_value().raw();
-				else if (name.caseCompare("bn") == 0)
-					maps.map_lm.back().bn = reader.get_value().raw();
-			}
-			else if (bm && im && me && reader.has_value())
-			{
-				if (name.caseCompare("i") == 0)
-					maps.map_bm.back().i = reader.get_value().raw();
-				else if (name.caseCompare("rt") == 0)
-					maps.map_bm.back().rt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pg") == 0)
-					maps.map_bm.back().pg = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("bt") == 0)
-					maps.map_bm.back().bt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("st") == 0)
-					maps.map_bm.back().st = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("sl") == 0)
-					maps.map_bm.back().sl = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pn") == 0)
-					maps.map_bm.back().pn = reader.get_value().raw();
-				else if (name.caseCompare("bn") == 0)
-					maps.map_bm.back().bn = reader.get_value().raw();
-			}
-			else if (sm && me && reader.has_value())
-			{
-				if (name.caseCompare("i") == 0)
-					maps.map_sm.push_back(reader.get_value().raw());
+				MAP_BM_T& map = maps.map_bm.back();
+
+				switch (tag)
+				{
+					case "i"_tag:	map.i = value; break;
+					case "rt"_tag:	map.rt = atoi(value.c_str()); break;
+					case "pg"_tag:	map.pg = atoi(value.c_str()); break;
+					case "bt"_tag:	map.bt = atoi(value.c_str()); break;
+					case "st"_tag:	map.st = atoi(value.c_str()); break;
+					case "sl"_tag:	map.sl = atoi(value.c_str()); break;
+					case "pn"_tag:	map.pn = value; break;
+					case "bn"_tag:	map.bn = value; break;
+				}
 			}
-			else if (strm && me)
+			else if (sm)
 			{
-				if (name.caseCompare("p") == 0)
-					maps.map_strm.back().p = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("c") == 0)
-					maps.map_strm.back().c = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pg") == 0)
-					maps.map_strm.back().pg = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("bt") == 0)
-					maps.map_strm.back().bt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pn") == 0)
-					maps.map_strm.back().pn = reader.get_value().raw();
-				else if (name.caseCompare("bn") == 0)
-					maps.map_strm.back().bn = reader.get_value().raw();
+				if (tag == "i"_tag)
+					maps.map_sm.push_back(value);
 			}
-			else if (pm && me && reader.has_value())
+			else if (pm)
 			{
-				if (name.caseCompare("a") == 0)
-					maps.map_pm.back().a = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("t") == 0)
-					maps.map_pm.back().t = reader.get_value().raw();
-				else if (name.caseCompare("pg") == 0)
-					maps.map_pm.back().pg = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("bt") == 0)
-					maps.map_pm.back().bt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("pn") == 0)
-					maps.map_pm.back().pn = reader.get_value().raw();
-				else if (name.caseCompare("bn") == 0)
-					maps.map_pm.back().bn = reader.get_value().raw();
-			}
+				MAP_PM_T& map = maps.map_pm.back();
 
-			if (reader.get_value().raw().compare("#text") != 0)
-				lastName = name.get();
+				switch (tag)
+				{
+					case "a"_tag:	map.a = atoi(value.c_str()); break;
+					case "t"_tag:	map.t = value; break;
+					case "pg"_tag:	map.pg = atoi(value.c_str()); break;
+					case "bt"_tag:	map.bt = atoi(value.c_str()); break;
+					case "pn"_tag:	map.pn = value; break;
+					case "bn"_tag:	map.bn = value; break;
+				}
+			}
 		}
 
 		reader.close();
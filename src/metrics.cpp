@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <istream>
+#include <sys/socket.h>
+#include <sys/time.h>
+#ifdef __APPLE__
+   #include <boost/asio.hpp>
+#else
+   #include <asio.hpp>
+#endif
+#include "syslog.h"
+#include "metrics.h"
+#include "trace.h"
+
+#ifdef __APPLE__
+using namespace boost;
+#endif
+
+extern Syslog *sysl;
+
+using namespace std;
+using namespace amx;
+
+/*
+ * Histogram
+ */
+int amx::Histogram::index(uint64_t v)
+{
+	if (v < HIST_SUB)
+		return (int)v;
+
+	int msb = 63 - __builtin_clzll(v);
+	int shift = msb - HIST_SUB_BITS;
+	int sub = (int)((v >> shift) & (HIST_SUB - 1));
+	return (shift + 1) * HIST_SUB + sub;
+}
+
+uint64_t amx::Histogram::upperBound(int idx)
+{
+	if (idx < HIST_SUB)
+		return (uint64_t)idx;
+
+	int shift = idx / HIST_SUB - 1;
+	uint64_t lower = (uint64_t)(HIST_SUB + idx % HIST_SUB) << shift;
+	return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void amx::Histogram::record(uint64_t v)
+{
+	buckets[index(v)].fetch_add(1, memory_order_relaxed);
+	sum.fetch_add(v, memory_order_relaxed);
+	count.fetch_add(1, memory_order_relaxed);
+}
+
+/*
+ * Returns the upper bound of the bucket containing the given quantile
+ * (0.0 ... 1.0). Because the buckets are read while other threads may
+ * still record values, the result is an approximation.
+ */
+uint64_t amx::Histogram::quantile(double q)
+{
+	uint64_t total = 0;
+
+	for (int i = 0; i < HIST_BUCKETS; i++)
+		total += buckets[i].load(memory_order_relaxed);
+
+	if (total == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)(q * (double)total);
+
+	if (rank >= total)
+		rank = total - 1;
+
+	uint64_t seen = 0;
+
+	for (int i = 0; i < HIST_BUCKETS; i++)
+	{
+		seen += buckets[i].load(memory_order_relaxed);
+
+		if (seen > rank)
+			return upperBound(i);
+	}
+
+	return upperBound(HIST_BUCKETS - 1);
+}
+
+/*
+ * Metrics
+ */
+Metrics& amx::Metrics::get()
+{
+	static Metrics metrics;
+	return metrics;
+}
+
+string amx::Metrics::panelLabel(int panel)
+{
+	if (panel <= 0)
+		return "panel=\"all\"";
+
+	return "panel=\""+to_string(panel)+"\"";
+}
+
+/*
+ * Returns a monotonic time stamp in microseconds. It is used to measure the
+ * time a message needs between two points.
+ */
+uint64_t amx::Metrics::now()
+{
+	return (uint64_t)chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Records the time passed since the time stamp "since" in the histogram of
+ * the stage. A time stamp of 0 means the message was not stamped (e.g.
+ * created internally) and is ignored.
+ */
+void amx::Metrics::latency(LATENCY_STAGE stage, uint64_t since)
+{
+	static Histogram *hist[LAT_STAGES] = {
+		get().histogram("amxpanel_latency_us", "stage=\"ctl_queue\"", "Time in microseconds a message needs for a stage"),
+		get().histogram("amxpanel_latency_us", "stage=\"ctl_send\""),
+		get().histogram("amxpanel_latency_us", "stage=\"ctl_total\""),
+		get().histogram("amxpanel_latency_us", "stage=\"web_dispatch\""),
+		get().histogram("amxpanel_latency_us", "stage=\"web_write\""),
+		get().histogram("amxpanel_latency_us", "stage=\"web_total\"")
+	};
+
+	if (since == 0 || stage >= LAT_STAGES)
+		return;
+
+	uint64_t t = now();
+	hist[stage]->record((t > since) ? t - since : 0);
+}
+
+Metrics::FAMILY& amx::Metrics::getFamily(const string& name, MTYPE type, const string& help)
+{
+	auto itr = families.find(name);
+
+	if (itr != families.end())
+		return itr->second;
+
+	FAMILY& fam = families[name];
+	fam.type = type;
+	fam.help = help;
+	return fam;
+}
+
+Counter *amx::Metrics::counter(const string& name, const string& labels, const string& help)
+{
+	lock_guard<mutex> lock(mut);
+	FAMILY& fam = getFamily(name, M_COUNTER, help);
+	unique_ptr<Counter>& c = fam.counters[labels];
+
+	if (!c)
+		c.reset(new Counter);
+
+	return c.get();
+}
+
+Gauge *amx::Metrics::gauge(const string& name, const string& labels, const string& help)
+{
+	lock_guard<mutex> lock(mut);
+	FAMILY& fam = getFamily(name, M_GAUGE, help);
+	unique_ptr<Gauge>& g = fam.gauges[labels];
+
+	if (!g)
+		g.reset(new Gauge);
+
+	return g.get();
+}
+
+Histogram *amx::Metrics::histogram(const string& name, const string& labels, const string& help)
+{
+	lock_guard<mutex> lock(mut);
+	FAMILY& fam = getFamily(name, M_HISTOGRAM, help);
+	unique_ptr<Histogram>& h = fam.histograms[labels];
+
+	if (!h)
+		h.reset(new Histogram);
+
+	return h.get();
+}
+
+/*
+ * Registers a function which is called every time before the metrics are
+ * exported. It can update metrics whose values are kept elsewhere.
+ */
+void amx::Metrics::addCollector(function<void()> func)
+{
+	lock_guard<mutex> lock(mut);
+	collectors.push_back(func);
+}
+
+/*
+ * Returns all metrics in the text format of Prometheus. Histograms are
+ * exported as summaries with precalculated quantiles.
+ */
+string amx::Metrics::getText()
+{
+	static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	string text;
+	vector<function<void()> > funcs;
+
+	{
+		lock_guard<mutex> lock(mut);
+		funcs = collectors;
+	}
+
+	for (auto& f : funcs)
+		f();
+
+	lock_guard<mutex> lock(mut);
+
+	for (auto& f : families)
+	{
+		const string& name = f.first;
+		FAMILY& fam = f.second;
+
+		if (!fam.help.empty())
+			text += "# HELP "+name+" "+fam.help+"\n";
+
+		switch (fam.type)
+		{
+			case M_COUNTER:
+				text += "# TYPE "+name+" counter\n";
+
+				for (auto& c : fam.counters)
+					text += name+(c.first.empty() ? "" : "{"+c.first+"}")+" "+to_string(c.second->get())+"\n";
+			break;
+
+			case M_GAUGE:
+				text += "# TYPE "+name+" gauge\n";
+
+				for (auto& g : fam.gauges)
+					text += name+(g.first.empty() ? "" : "{"+g.first+"}")+" "+to_string(g.second->get())+"\n";
+			break;
+
+			case M_HISTOGRAM:
+				text += "# TYPE "+name+" summary\n";
+
+				for (auto& h : fam.histograms)
+				{
+					string sep = h.first.empty() ? "" : h.first+",";
+					char q[32];
+
+					for (double qu : quantiles)
+					{
+						snprintf(q, sizeof(q), "%g", qu);
+						text += name+"{"+sep+"quantile=\""+q+"\"} "+to_string(h.second->quantile(qu))+"\n";
+					}
+
+					string lbl = h.first.empty() ? "" : "{"+h.first+"}";
+					text += name+"_sum"+lbl+" "+to_string(h.second->getSum())+"\n";
+					text += name+"_count"+lbl+" "+to_string(h.second->getCount())+"\n";
+				}
+			break;
+		}
+	}
+
+	return text;
+}
+
+/*
+ * Starts the HTTP server for the metrics. It runs in its own thread and
+ * answers every request with the current metrics.
+ */
+bool amx::Metrics::start(const string& listen, int port)
+{
+	DECL_TRACER("Metrics::start(const string& listen, int port)");
+
+	if (port <= 0 || running)
+		return false;
+
+	try
+	{
+		running = true;
+		thread thr = thread([=] { run(listen, port); });
+		thr.detach();
+	}
+	catch (std::exception& e)
+	{
+		running = false;
+		sysl->errlog(string("Metrics::start: Error starting the metrics thread: ")+e.what());
+		return false;
+	}
+
+	return true;
+}
+
+void amx::Metrics::run(const string& listen, int port)
+{
+	DECL_TRACTHR("Metrics::run(const string& listen, int port)");
+
+	try
+	{
+		asio::io_service io;
+		asio::ip::tcp::endpoint ep(asio::ip::address::from_string(listen), (unsigned short)port);
+		asio::ip::tcp::acceptor acceptor(io, ep);
+		sysl->log(Syslog::INFO, "Metrics are available at http://"+listen+":"+to_string(port)+"/metrics");
+
+		while (running)
+		{
+			asio::ip::tcp::socket sock(io);
+#ifdef __APPLE__
+			system::error_code ec;
+#else
+			error_code ec;
+#endif
+			acceptor.accept(sock, ec);
+
+			if (ec)
+				continue;
+
+			// Don't let a client which sends nothing block the server
+			struct timeval tv = { 2, 0 };
+			setsockopt(sock.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+			asio::streambuf request;
+			asio::read_until(sock, request, "\r\n\r\n", ec);
+
+			if (ec)
+				continue;
+
+			// Request line: <method> <path>[?<query>] <version>
+			istream reqStream(&request);
+			string method, path;
+			reqStream >> method >> path;
+			path = path.substr(0, path.find('?'));
+			string response;
+
+			if (path.compare("/metrics") == 0)
+			{
+				string body = getText();
+				response = "HTTP/1.0 200 OK\r\n"
+						   "Content-Type: text/plain; version=0.0.4\r\n"
+						   "Content-Length: "+to_string(body.length())+"\r\n"
+						   "Connection: close\r\n\r\n"+body;
+			}
+			else
+			{
+				response = "HTTP/1.0 404 Not Found\r\n"
+						   "Content-Type: text/plain\r\n"
+						   "Content-Length: 10\r\n"
+						   "Connection: close\r\n\r\nNot found\n";
+			}
+
+			asio::write(sock, asio::buffer(response), ec);
+			sock.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+		}
+	}
+	catch (std::exception& e)
+	{
+		sysl->errlog(string("Metrics::run: ")+e.what());
+	}
+
+	running = false;
+}
+
+/*
+ * McMetrics
+ */
+void amx::McMetrics::init(const string& d, int pan)
+{
+	dir = d;
+	panel = Metrics::panelLabel(pan);
+}
+
+void amx::McMetrics::count(uint16_t mc)
+{
+	int slot = (mc < MC_SLOTS) ? mc : MC_SLOTS;
+	Counter *c = perPanel[slot].load(memory_order_acquire);
+
+	if (!c)
+	{
+		char hex[16];
+
+		if (slot < MC_SLOTS)
+			snprintf(hex, sizeof(hex), "0x%04x", mc);
+		else
+			strcpy(hex, "other");
+
+		string lbl = "dir=\""+dir+"\",mc=\""+hex+"\"";
+		total[slot].store(Metrics::get().counter("amxpanel_icsp_messages_all_total", lbl, "ICSP messages of all panels by message command"), memory_order_release);
+		c = Metrics::get().counter("amxpanel_icsp_messages_total", panel+","+lbl, "ICSP messages by panel and message command");
+		perPanel[slot].store(c, memory_order_release);
+	}
+
+	c->inc();
+	total[slot].load(memory_order_acquire)->inc();
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <string>
+#include <map>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace amx
+{
+	/*
+	 * A value which only grows, like the number of messages received.
+	 */
+	class Counter
+	{
+		public:
+			void inc(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+			uint64_t get() { return value.load(std::memory_order_relaxed); }
+
+		private:
+			std::atomic<uint64_t> value{0};
+	};
+
+	/*
+	 * A value which can go up and down, like the length of a queue.
+	 */
+	class Gauge
+	{
+		public:
+			void set(int64_t v) { value.store(v, std::memory_order_relaxed); }
+			void add(int64_t v) { value.fetch_add(v, std::memory_order_relaxed); }
+			int64_t get() { return value.load(std::memory_order_relaxed); }
+
+		private:
+			std::atomic<int64_t> value{0};
+	};
+
+	/*
+	 * A histogram with logarithmic buckets. Every power of two is divided
+	 * into HIST_SUB linear sub buckets. This keeps the relative error below
+	 * 1/HIST_SUB for any value from 0 up to 2^63, while recording a value is
+	 * only an index calculation and an atomic increment.
+	 */
+	#define HIST_SUB_BITS	3
+	#define HIST_SUB		(1 << HIST_SUB_BITS)
+	#define HIST_BUCKETS	((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+	class Histogram
+	{
+		public:
+			void record(uint64_t v);
+			uint64_t getCount() { return count.load(std::memory_order_relaxed); }
+			uint64_t getSum() { return sum.load(std::memory_order_relaxed); }
+			uint64_t quantile(double q);
+
+		private:
+			static int index(uint64_t v);
+			static uint64_t upperBound(int idx);
+
+			std::atomic<uint64_t> buckets[HIST_BUCKETS] = {};
+			std::atomic<uint64_t> count{0};
+			std::atomic<uint64_t> sum{0};
+	};
+
+	/*
+	 * The stages a message passes on its way between the controller and the
+	 * browser. Each stage has its own latency histogram.
+	 */
+	enum LATENCY_STAGE
+	{
+		LAT_CTL_QUEUE,		// Decoded in AMXNet::handle_read -> dispatched in TouchPanel::setCommand
+		LAT_CTL_SEND,		// Dispatched -> written in WebSocket::send
+		LAT_CTL_TOTAL,		// Decoded -> written to the browser
+		LAT_WEB_DISPATCH,	// Received in TouchPanel::webMsg -> queued in AMXNet::sendCommand
+		LAT_WEB_WRITE,		// Queued -> written in AMXNet::writeCommand
+		LAT_WEB_TOTAL,		// Received from the browser -> written to the controller
+		LAT_STAGES
+	};
+
+	/*
+	 * The registry of all metrics. A metric is identified by its name and
+	 * its labels (e.g. panel="10001"). Looking up or creating a metric
+	 * takes a lock, so the callers keep the returned pointer and update the
+	 * metric without any lock afterwards. The metrics are never deleted.
+	 *
+	 * If a port is configured (MetricsPort), the metrics are served in the
+	 * text format of Prometheus by a small HTTP server on this port.
+	 */
+	class Metrics
+	{
+		public:
+			static Metrics& get();
+
+			Counter *counter(const std::string& name, const std::string& labels = "", const std::string& help = "");
+			Gauge *gauge(const std::string& name, const std::string& labels = "", const std::string& help = "");
+			Histogram *histogram(const std::string& name, const std::string& labels = "", const std::string& help = "");
+
+			void addCollector(std::function<void()> func);
+			std::string getText();
+			bool start(const std::string& listen, int port);
+
+			static std::string panelLabel(int panel);
+			static uint64_t now();
+			static void latency(LATENCY_STAGE stage, uint64_t since);
+
+		private:
+			enum MTYPE
+			{
+				M_COUNTER,
+				M_GAUGE,
+				M_HISTOGRAM
+			};
+
+			typedef struct FAMILY
+			{
+				MTYPE type;
+				std::string help;
+				std::map<std::string, std::unique_ptr<Counter> > counters;
+				std::map<std::string, std::unique_ptr<Gauge> > gauges;
+				std::map<std::string, std::unique_ptr<Histogram> > histograms;
+			}FAMILY;
+
+			Metrics() = default;
+			FAMILY& getFamily(const std::string& name, MTYPE type, const std::string& help);
+			void run(const std::string& listen, int port);
+
+			std::map<std::string, FAMILY> families;
+			std::vector<std::function<void()> > collectors;
+			std::mutex mut;
+			std::atomic<bool> running{false};
+	};
+
+	/*
+	 * Counts ICSP messages by their message command (MC) for one panel and
+	 * for all panels together. The sum of all panels has its own name
+	 * (amxpanel_icsp_messages_all_total), so it is not counted twice when
+	 * the series are summed up. The counters are created on first use and
+	 * then updated without a lock.
+	 */
+	#define MC_SLOTS	0x0300		// All known message commands are below
+
+	class McMetrics
+	{
+		public:
+			void init(const std::string& dir, int panel);
+			void count(uint16_t mc);
+
+		private:
+			std::string dir;
+			std::string panel;
+			std::atomic<Counter *> perPanel[MC_SLOTS + 1] = {};
+			std::atomic<Counter *> total[MC_SLOTS + 1] = {};
+	};
+}
+
+#endif
@@ -32,12 +32,12 @@ using namespace std;
 
 NameFormat::NameFormat()
 {
-	sysl->TRACE(Syslog::ENTRY, string("NameFormat::NameFormat()"));
+	TRACER(Syslog::ENTRY, string("NameFormat::NameFormat()"));
 }
 
 NameFormat::~NameFormat()
 {
-	sysl->TRACE(Syslog::EXIT, string("NameFormat::NameFormat()"));
+	TRACER(Syslog::EXIT, string("NameFormat::NameFormat()"));
 }
 
 string NameFormat::toValidName(string& str)
@@ -328,48 +328,44 @@ string NameFormat::cp1250ToUTF8(const string& str)
 	DECL_TRACER("NameFormat::cp1250ToUTF8(const string& str)");
 
 	string out;
+	char buf[4];
+	out.reserve(str.length() + str.length() / 4);
 
 	for (size_t j = 0; j < str.length(); j++)
 	{
-		int i = -1;
-		unsigned char ch = str.at(j);
-		short utf = -1;
+		int len = cp1250ToUTF8((unsigned char)str[j], buf);
+		out.append(buf, len);
+	}
 
-		if (ch < 0x80)
-		{
-			do
-			{
-				i++;
-
-				if (__cht[i].ch == ch)
-				{
-					utf = __cht[i].byte;
-					break;
-				}
-			}
-			while (__cht[i].ch != 0xff);
-
-			if (utf < 0)
-				utf = ch;
-		}
-		else
-			utf = ch;
+	return out;
+}
 
-		if (utf > 0x00ff)
-		{
-			out.push_back((utf >> 8) & 0x00ff);
-			out.push_back(utf & 0x00ff);
-		}
-		else if (ch > 0x7f)
-		{
-			out.push_back(0xc0 | ch >> 6);
-			out.push_back(0x80 | (ch & 0x3f));
-		}
-		else
-			out.push_back(ch);
+/*
+ * Converts one character of the Windows code page into UTF-8. The result
+ * is written to "out", which must have room for at least 3 bytes. Returns
+ * the number of bytes written.
+ */
+int NameFormat::cp1250ToUTF8(unsigned char ch, char *out)
+{
+	if (ch < 0x80)
+	{
+		out[0] = ch;
+		return 1;
 	}
 
-	return out;
+	unsigned short utf = __cht[ch - 0x80].byte;
+
+	if (utf < 0x0800)
+	{
+		out[0] = 0xc0 | (utf >> 6);
+		out[1] = 0x80 | (utf & 0x3f);
+		return 2;
+	}
+
+	out[0] = 0xe0 | (utf >> 12);
+	out[1] = 0x80 | ((utf >> 6) & 0x3f);
+	out[2] = 0x80 | (utf & 0x3f);
+	return 3;
 }
 
 string NameFormat::UTF8ToCp1250(const string& str)
@@ -173,6 +173,7 @@ class NameFormat
 		static std::string strToHex(std::string str, int width, bool format = false, int indent = 0);
 		static std::string latin1ToUTF8(const std::string& str);
 		static std::string cp1250ToUTF8(const std::string& str);
+		static int cp1250ToUTF8(unsigned char ch, char *out);
 		static std::string UTF8ToCp1250(const std::string& str);
 };
 
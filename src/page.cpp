@@ -33,6 +33,8 @@
 #include "syslog.h"
 #include "palette.h"
 #include "nameformat.h"
+#include "xmlinput.h"
+#include "xmltags.h"
 #include "page.h"
 #include "trace.h"
 #include "str.h"
@@ -45,30 +47,30 @@ using namespace amx;
 
 Page::Page()
 {
-	sysl->TRACE(Syslog::ENTRY, std::string("Page::Page()"));
+	TRACER(Syslog::ENTRY, std::string("Page::Page()"));
 	status = false;
 	paletteFile = "pal_001.xma";
 	fontClass = 0;
 	paletteClass = 0;
 	iconClass = 0;
+	styleSheet = 0;
 	buttonsDone = false;
 	styleDone = false;
-	webDone = false;
 	Project = 0;
 }
 
 Page::Page(const string& file)
 {
-	sysl->TRACE(Syslog::ENTRY, std::string("Page::Page(const string& file)"));
+	TRACER(Syslog::ENTRY, std::string("Page::Page(const string& file)"));
 	status = false;
 	pageFile = file;
 	paletteFile = "pal_001.xma";
 	fontClass = 0;
 	paletteClass = 0;
 	iconClass = 0;
+	styleSheet = 0;
 	buttonsDone = false;
 	styleDone = false;
-	webDone = false;
 	Project = 0;
 }
 
@@ -81,6 +83,7 @@ bool amx::Page::parsePage()
 
 	bool inButton = false;
 	string lastName;
+	XMLTAG lastTag = 0;
 	int depth, oldDepth = -1;
 
 	if (paletteFile.empty())
@@ -91,256 +94,185 @@ bool amx::Page::parsePage()
 	uri.append(Configuration->getHTTProot());
 	uri.append("/");
 	uri.append(pageFile);
-	sysl->TRACE("Page::parsePage: Reading file: "+uri);
+	TRACER("Page::parsePage: Reading file: "+uri);
 
 	try
 	{
-		ifstream xml(uri.c_str(), ifstream::binary);
-
-		if (!xml)
-		{
-			sysl->errlog("Page::parsePage: Error opening the file "+uri);
-			return false;
-		}
-
-		std::string buffer;
-
-		try
-		{
-			xml.seekg(0, xml.end);
-			size_t length = xml.tellg();
-			xml.seekg(0, xml.beg);
-			buffer.resize(length, ' ');
-			char *begin = &*buffer.begin();
-			xml.read(begin, length);
-		}
-		catch (exception& e)
-		{
-			sysl->errlog(string("Page::parsePage: Error reading a file: ")+e.what());
-			xml.close();
-			return false;
-		}
-
-		xml.close();
-		sysl->TRACE("Page::parsePage: length="+to_string(buffer.length()));
-		// Convert from CP1250 (Windblows) to UTF-8.
-		string cbuf = NameFormat::cp1250ToUTF8(buffer);
-		buffer.clear();
-
-		xmlpp::TextReader reader((const unsigned char *)cbuf.c_str(), cbuf.length());
+		// The file is mapped into memory and converted to UTF-8 while
+		// the parser reads it.
+		xmlpp::TextReader reader(XmlInput::getUri(uri));
 
 		while (reader.read())
 		{
-			Str name(reader.get_name().raw());
+			string name = reader.get_name().raw();
+			XMLTAG tag = tagHash(name);
 			depth = reader.get_depth();
 
 			if (depth < oldDepth)
 			{
 				oldDepth = depth;
 
-				if (name.caseCompare("button") == 0)
+				if (tag == "button"_tag)
 					inButton = false;
 
 				continue;
 			}
 
-			if (name.get().compare("#text") == 0)
-				name.set(lastName);
+			if (tag == "#text"_tag)
+			{
+				name = lastName;
+				tag = lastTag;
+			}
+
+			bool hasValue = reader.has_value();
+			bool hasAttributes = reader.has_attributes();
+			string value;
 
-			if (reader.has_attributes())
+			if (hasValue)
+				value = reader.get_value().raw();
+
+			if (hasAttributes)
 			{
 				for (int i = 0; i < reader.get_attribute_count(); i++)
-					sysl->TRACE("Page::parsePage: name="+name.get()+", depth="+to_string(reader.get_depth())+", attr="+reader.get_attribute(i).raw());
+					TRACER("Page::parsePage: name="+name+", depth="+to_string(depth)+", attr="+reader.get_attribute(i).raw());
 			}
-			else if (reader.has_value())
-				sysl->TRACE("Page::parsePage: name="+name.get()+", depth="+to_string(reader.get_depth())+", value="+reader.get_value().raw());
+			else if (hasValue)
+				TRACER("Page::parsePage: name="+name+", depth="+to_string(depth)+", value="+value);
 			else
-				sysl->TRACE("Page::parsePage: name="+name.get()+", depth="+to_string(reader.get_depth()));
+				TRACER("Page::parsePage: name="+name+", depth="+to_string(depth));
 
-			if (name.caseCompare("page") == 0 && reader.has_attributes())
+			switch (tag)
 			{
-				Str attr(reader.get_attribute(0).raw());
+				case "page"_tag:
+					if (hasAttributes)
+					{
+						switch (tagHash(reader.get_attribute(0).raw()))
+						{
+							case "page"_tag:	page.type = PAGE; break;
+							case "subpage"_tag:	page.type = SUBPAGE; break;
+							default:			page.type = PNONE;
+						}
 
-				if (attr.caseCompare("page") == 0)
-					page.type = PAGE;
-				else if (attr.caseCompare("subpage") == 0)
-					page.type = SUBPAGE;
-				else
-					page.type = PNONE;
+						TRACER("Page::parsePage: page:"+to_string(page.type));
+					}
+				break;
 
-				sysl->TRACE("Page::parsePage: page:"+to_string(page.type));
-			}
-			else if (name.caseCompare("pageID") == 0 && reader.has_value())
-				page.pageID = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("name") == 0 && reader.has_value())
-				page.name = reader.get_value().raw();
-			else if (name.caseCompare("left") == 0 && reader.has_value())
-				page.left = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("top") == 0 && reader.has_value())
-				page.top = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("width") == 0 && reader.has_value())
-				page.width = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("height") == 0 && reader.has_value())
-				page.height = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("group") == 0 && reader.has_value())
-				page.group = reader.get_value().raw();
-			else if (name.caseCompare("modal") == 0 && reader.has_value())
-				page.modal = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("timeout") == 0 && reader.has_value())
-				page.timeout = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("showEffect") == 0 && reader.has_value())
-				page.showEffect = (SHOWEFFECT)atoi(reader.get_value().c_str());
-			else if (name.caseCompare("showTime") == 0 && reader.has_value())
-				page.showTime = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("hideEffect") == 0 && reader.has_value())
-				page.hideEffect = (SHOWEFFECT)atoi(reader.get_value().c_str());
-			else if (name.caseCompare("hideTime") == 0 && reader.has_value())
-				page.hideTime = atoi(reader.get_value().c_str());
-			else if (name.caseCompare("button") == 0 && reader.has_attributes())
-			{
-				BUTTON_T button;
-				button.clear();
-				Str attr(reader.get_attribute(0).raw());
-
-				if (attr.caseCompare("general") == 0)
-					button.type = GENERAL;
-				else if (attr.caseCompare("multi-state general") == 0)
-					button.type = MULTISTATE_GENERAL;
-				else if (attr.caseCompare("bargraph") == 0)
-					button.type = BARGRAPH;
-				else if (attr.caseCompare("multi-state bargraph") == 0)
-					button.type = MULTISTATE_BARGRAPH;
-				else if (attr.caseCompare("joistick") == 0)
-					button.type = JOISTICK;
-				else if (attr.caseCompare("text input") == 0)
-					button.type = TEXT_INPUT;
-				else if (attr.caseCompare("computer control") == 0)
-					button.type = COMPUTER_CONTROL;
-				else if (attr.caseCompare("take note") == 0)
-					button.type = TAKE_NOTE;
-				else if (attr.caseCompare("sub-page view") == 0)
-					button.type = SUBPAGE_VIEW;
-
-				button.fb = FB_NONE;
-				page.buttons.push_back(button);
-				inButton = true;
-				sysl->TRACE("Page::parsePage: Added for page "+page.name+" button of type "+to_string(button.type));
+				case "pageID"_tag:		if (hasValue) page.pageID = atoi(value.c_str()); break;
+				case "name"_tag:		if (hasValue) page.name = value; break;
+				case "left"_tag:		if (hasValue) page.left = atoi(value.c_str()); break;
+				case "top"_tag:			if (hasValue) page.top = atoi(value.c_str()); break;
+				case "width"_tag:		if (hasValue) page.width = atoi(value.c_str()); break;
+				case "height"_tag:		if (hasValue) page.height = atoi(value.c_str()); break;
+				case "group"_tag:		if (hasValue) page.group = value; break;
+				case "modal"_tag:		if (hasValue) page.modal = atoi(value.c_str()); break;
+				case "timeout"_tag:		if (hasValue) page.timeout = atoi(value.c_str()); break;
+				case "showEffect"_tag:	if (hasValue) page.showEffect = (SHOWEFFECT)atoi(value.c_str()); break;
+				case "showTime"_tag:	if (hasValue) page.showTime = atoi(value.c_str()); break;
+				case "hideEffect"_tag:	if (hasValue) page.hideEffect = (SHOWEFFECT)atoi(value.c_str()); break;
+				case "hideTime"_tag:	if (hasValue) page.hideTime = atoi(value.c_str()); break;
+
+				case "button"_tag:
+					if (hasAttributes)
+					{
+						BUTTON_T button;
+						button.clear();
+
+						switch (tagHash(reader.get_attribute(0).raw()))
+						{
+							case "general"_tag:					button.type = GENERAL; break;
+							case "multi-state general"_tag:		button.type = MULTISTATE_GENERAL; break;
+							case "bargraph"_tag:				button.type = BARGRAPH; break;
+							case "multi-state bargraph"_tag:	button.type = MULTISTATE_BARGRAPH; break;
+							case "joistick"_tag:				button.type = JOISTICK; break;
+							case "text input"_tag:				button.type = TEXT_INPUT; break;
+							case "computer control"_tag:		button.type = COMPUTER_CONTROL; break;
+							case "take note"_tag:				button.type = TAKE_NOTE; break;
+							case "sub-page view"_tag:			button.type = SUBPAGE_VIEW; break;
+						}
+
+						button.fb = FB_NONE;
+						page.buttons.push_back(button);
+						inButton = true;
+						TRACER("Page::parsePage: Added for page "+page.name+" button of type "+to_string(button.type));
+					}
+					else
+						inButton = false;
+				break;
 			}
-			else if (name.caseCompare("button") == 0)
-				inButton = false;
 
-			if (reader.get_depth() == 4 && inButton)
+			if (depth == 4 && inButton && hasValue)
 			{
-				if (name.caseCompare("bi") == 0 && reader.has_value())
-					page.buttons.back().bi = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("bd") == 0 && reader.has_value())
-					page.buttons.back().bd = reader.get_value().raw();
-				else if (name.caseCompare("na") == 0 && reader.has_value())
-					page.buttons.back().na = reader.get_value().raw();
-				else if (name.caseCompare("lt") == 0 && reader.has_value())
-					page.buttons.back().lt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("tp") == 0 && reader.has_value())
-					page.buttons.back().tp = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("wt") == 0 && reader.has_value())
-					page.buttons.back().wt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ht") == 0 && reader.has_value())
-					page.buttons.back().ht = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("zo") == 0 && reader.has_value())
-					page.buttons.back().zo = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("hs") == 0 && reader.has_value())
-					page.buttons.back().hs = reader.get_value().raw();
-				else if (name.caseCompare("bs") == 0 && reader.has_value())
-					page.buttons.back().bs = reader.get_value().raw();
-				else if (name.caseCompare("mt") == 0 && reader.has_value())
-					page.buttons.back().mt = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("dt") == 0 && reader.has_value())
-					page.buttons.back().dt = reader.get_value().raw();
-				else if (name.caseCompare("im") == 0 && reader.has_value())
-					page.buttons.back().im = reader.get_value().raw();
-				else if (name.caseCompare("fb") == 0 && reader.has_value())
-				{
-					Str value(reader.get_value().raw());
-					value.trim();
-
-					if (value.caseCompare("channel") == 0)
-						page.buttons.back().fb = FB_CHANNEL;
-					else if (value.caseCompare("inverted channel") == 0)
-						page.buttons.back().fb = FB_INV_CHANNEL;
-					else if (value.caseCompare("always on") == 0)
-						page.buttons.back().fb = FB_ALWAYS_ON;
-					else if (value.caseCompare("momentary") == 0)
-						page.buttons.back().fb = FB_MOMENTARY;
-					else if (value.caseCompare("blink") == 0)
-						page.buttons.back().fb = FB_BLINK;
-					else
-						page.buttons.back().fb = FB_NONE;
-				}
-				else if (name.caseCompare("ap") == 0 && reader.has_value())
-					page.buttons.back().ap = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ad") == 0 && reader.has_value())
-					page.buttons.back().ad = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("cp") == 0 && reader.has_value())
-					page.buttons.back().cp = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ch") == 0 && reader.has_value())
-					page.buttons.back().ch = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("lp") == 0 && reader.has_value())
-					page.buttons.back().lp = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("lv") == 0 && reader.has_value())
-					page.buttons.back().lv = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("va") == 0 && reader.has_value())
-					page.buttons.back().va = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("rm") == 0 && reader.has_value())
-					page.buttons.back().rm = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("nu") == 0 && reader.has_value())
-					page.buttons.back().nu = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("nd") == 0 && reader.has_value())
-					page.buttons.back().nd = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ar") == 0 && reader.has_value())
-					page.buttons.back().ar = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ru") == 0 && reader.has_value())
-					page.buttons.back().ru = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("rd") == 0 && reader.has_value())
-					page.buttons.back().rd = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("lu") == 0 && reader.has_value())
-					page.buttons.back().lu = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ld") == 0 && reader.has_value())
-					page.buttons.back().ld = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("rv") == 0 && reader.has_value())
-					page.buttons.back().rv = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("rl") == 0 && reader.has_value())
-					page.buttons.back().rl = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("rh") == 0 && reader.has_value())
-					page.buttons.back().rh = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("rn") == 0 && reader.has_value())
-					page.buttons.back().rn = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ri") == 0 && reader.has_value())
-					page.buttons.back().ri = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("if") == 0 && reader.has_value())
-					page.buttons.back()._if = reader.get_value().raw();
-				else if (name.caseCompare("sd") == 0 && reader.has_value())
-					page.buttons.back().sd = reader.get_value().raw();
-				else if (name.caseCompare("sc") == 0 && reader.has_value())
-					page.buttons.back().sc = reader.get_value().raw();
-				else if (name.caseCompare("op") == 0 && reader.has_value())
-					page.buttons.back().op = reader.get_value().raw();
-				else if (name.caseCompare("stateCount") == 0 && reader.has_value())
-					page.buttons.back().stateCount = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("dr") == 0 && reader.has_value())
-					page.buttons.back().dr = reader.get_value().c_str();
-				else if (name.caseCompare("pf") == 0 && reader.has_value())
+				BUTTON_T& bt = page.buttons.back();
+
+				switch (tag)
 				{
-					page.buttons.back().pushFunc.back().pfName = reader.get_value().c_str();
-					sysl->TRACE("Page::parsePage: found push page: "+page.buttons.back().pushFunc.back().pfType+": "+page.buttons.back().pushFunc.back().pfName);
+					case "bi"_tag:	bt.bi = atoi(value.c_str()); break;
+					case "bd"_tag:	bt.bd = value; break;
+					case "na"_tag:	bt.na = value; break;
+					case "lt"_tag:	bt.lt = atoi(value.c_str()); break;
+					case "tp"_tag:	bt.tp = atoi(value.c_str()); break;
+					case "wt"_tag:	bt.wt = atoi(value.c_str()); break;
+					case "ht"_tag:	bt.ht = atoi(value.c_str()); break;
+					case "zo"_tag:	bt.zo = atoi(value.c_str()); break;
+					case "hs"_tag:	bt.hs = value; break;
+					case "bs"_tag:	bt.bs = value; break;
+					case "mt"_tag:	bt.mt = atoi(value.c_str()); break;
+					case "dt"_tag:	bt.dt = value; break;
+					case "im"_tag:	bt.im = value; break;
+
+					case "fb"_tag:
+						switch (tagHash(Str::trim(value)))
+						{
+							case "channel"_tag:				bt.fb = FB_CHANNEL; break;
+							case "inverted channel"_tag:	bt.fb = FB_INV_CHANNEL; break;
+							case "always on"_tag:			bt.fb = FB_ALWAYS_ON; break;
+							case "momentary"_tag:			bt.fb = FB_MOMENTARY; break;
+							case "blink"_tag:				bt.fb = FB_BLINK; break;
+							default:						bt.fb = FB_NONE;
+						}
+					break;
+
+					case "ap"_tag:	bt.ap = atoi(value.c_str()); break;
+					case "ad"_tag:	bt.ad = atoi(value.c_str()); break;
+					case "cp"_tag:	bt.cp = atoi(value.c_str()); break;
+					case "ch"_tag:	bt.ch = atoi(value.c_str()); break;
+					case "lp"_tag:	bt.lp = atoi(value.c_str()); break;
+					case "lv"_tag:	bt.lv = atoi(value.c_str()); break;
+					case "va"_tag:	bt.va = atoi(value.c_str()); break;
+					case "rm"_tag:	bt.rm = atoi(value.c_str()); break;
+					case "nu"_tag:	bt.nu = atoi(value.c_str()); break;
+					case "nd"_tag:	bt.nd = atoi(value.c_str()); break;
+					case "ar"_tag:	bt.ar = atoi(value.c_str()); break;
+					case "ru"_tag:	bt.ru = atoi(value.c_str()); break;
+					case "rd"_tag:	bt.rd = atoi(value.c_str()); break;
+					case "lu"_tag:	bt.lu = atoi(value.c_str()); break;
+					case "ld"_tag:	bt.ld = atoi(value.c_str()); break;
+					case "rv"_tag:	bt.rv = atoi(value.c_str()); break;
+					case "rl"_tag:	bt.rl = atoi(value.c_str()); break;
+					case "rh"_tag:	bt.rh = atoi(value.c_str()); break;
+					case "rn"_tag:	bt.rn = atoi(value.c_str()); break;
+					case "ri"_tag:	bt.ri = atoi(value.c_str()); break;
+					case "if"_tag:	bt._if = value; break;
+					case "sd"_tag:	bt.sd = value; break;
+					case "sc"_tag:	bt.sc = value; break;
+					case "op"_tag:	bt.op = value; break;
+					case "stateCount"_tag:	bt.stateCount = atoi(value.c_str()); break;
+					case "dr"_tag:	bt.dr = value; break;
+
+					case "pf"_tag:
+						bt.pushFunc.back().pfName = value;
+						TRACER("Page::parsePage: found push page: "+bt.pushFunc.back().pfType+": "+bt.pushFunc.back().pfName);
+					break;
 				}
 			}
-			else if (inButton && reader.get_depth() == 3)	// Attributes
+			else if (inButton && depth == 3)	// Attributes
 			{
-				if (name.caseCompare("pf") == 0 && reader.has_attributes())
+				if (tag == "pf"_tag && hasAttributes)
 				{
 					PUSH_FUNC_T pf;
 					pf.pfType = reader.get_attribute(0).c_str();	// FIXME: Find all commands and make an enum.
 					page.buttons.back().pushFunc.push_back(pf);
-					sysl->TRACE("Page::parsePage: found push command: "+pf.pfType);
+					TRACER("Page::parsePage: found push command: "+pf.pfType);
 					// Known commands:
 					// sShow      show popup
 					// sHide      hide popup
@@ -348,221 +280,151 @@ bool amx::Page::parsePage()
 				}
 			}
 
-			if (inButton && name.caseCompare("sr") == 0 && reader.has_attributes())
+			if (inButton && tag == "sr"_tag && hasAttributes)
 			{
 				SR_T sr;
 				sr.clear();
 				sr.number = atoi(reader.get_attribute(0).c_str());
 				page.buttons.back().sr.push_back(sr);
-				sysl->TRACE("Page::Page: Added for button "+page.buttons.back().na+" sr with ID "+to_string(sr.number));
+				TRACER("Page::Page: Added for button "+page.buttons.back().na+" sr with ID "+to_string(sr.number));
 			}
 
-			if (reader.get_depth() == 5 && inButton)
+			if (depth == 5 && inButton && hasValue)
 			{
-				if (name.caseCompare("do") == 0 && reader.has_value())
-					page.buttons.back().sr.back()._do = reader.get_value().raw();
-				else if (name.caseCompare("bs") == 0 && reader.has_value())
-					page.buttons.back().sr.back().bs = reader.get_value().raw();
-				else if (name.caseCompare("mi") == 0 && reader.has_value())
+				SR_T& sr = page.buttons.back().sr.back();
+
+				switch (tag)
 				{
-					string mi = reader.get_value().raw();
-					page.buttons.back().sr.back().mi = mi;
+					case "do"_tag:	sr._do = value; break;
+					case "bs"_tag:	sr.bs = value; break;
 
-					if (!mi.empty())
-					{
-						int width, height;
+					case "mi"_tag:
+						sr.mi = value;
+						sr.mi_width = sr.mi_height = 0;
 
-						if (PushButton::getImageDimensions(Configuration->getHTTProot()+"/images/"+mi, &width, &height))
-						{
-							page.buttons.back().sr.back().mi_width = width;
-							page.buttons.back().sr.back().mi_height = height;
-						}
-						else
+						if (!value.empty())
 						{
-							page.buttons.back().sr.back().mi_width = 0;
-							page.buttons.back().sr.back().mi_height = 0;
+							int width, height;
+
+							if (PushButton::getImageDimensions(Configuration->getHTTProot()+"/images/"+value, &width, &height))
+							{
+								sr.mi_width = width;
+								sr.mi_height = height;
+							}
 						}
-					}
-					else
-					{
-						page.buttons.back().sr.back().mi_width = 0;
-						page.buttons.back().sr.back().mi_height = 0;
-					}
-				}
-				else if (name.caseCompare("cb") == 0 && reader.has_value())
-					page.buttons.back().sr.back().cb = reader.get_value().raw();
-				else if (name.caseCompare("cf") == 0 && reader.has_value())
-					page.buttons.back().sr.back().cf = reader.get_value().raw();
-				else if (name.caseCompare("ct") == 0 && reader.has_value())
-					page.buttons.back().sr.back().ct = reader.get_value().raw();
-				else if (name.caseCompare("ec") == 0 && reader.has_value())
-					page.buttons.back().sr.back().ec = reader.get_value().raw();
-				else if (name.caseCompare("bm") == 0 && reader.has_value())
-				{
-					string bm = reader.get_value().raw();
-					page.buttons.back().sr.back().bm = bm;
+					break;
 
-					if (reader.has_attributes())
-					{
-						if (reader.get_attribute(0).compare("0") == 0)
-							page.buttons.back().sr.back().dynamic = false;
-						else
-							page.buttons.back().sr.back().dynamic = true;
-					}
+					case "cb"_tag:	sr.cb = value; break;
+					case "cf"_tag:	sr.cf = value; break;
+					case "ct"_tag:	sr.ct = value; break;
+					case "ec"_tag:	sr.ec = value; break;
 
-					if (!bm.empty() && !page.buttons.back().sr.back().dynamic)
-					{
-						int width, height;
+					case "bm"_tag:
+						sr.bm = value;
+						sr.bm_width = sr.bm_height = 0;
 
-						if (PushButton::getImageDimensions(Configuration->getHTTProot()+"/images/"+bm, &width, &height))
-						{
-							page.buttons.back().sr.back().bm_width = width;
-							page.buttons.back().sr.back().bm_height = height;
-						}
-						else
+						if (hasAttributes)
+							sr.dynamic = (reader.get_attribute(0).compare("0") != 0);
+
+						if (!value.empty() && !sr.dynamic)
 						{
-							page.buttons.back().sr.back().bm_width = 0;
-							page.buttons.back().sr.back().bm_height = 0;
+							int width, height;
+
+							if (PushButton::getImageDimensions(Configuration->getHTTProot()+"/images/"+value, &width, &height))
+							{
+								sr.bm_width = width;
+								sr.bm_height = height;
+							}
 						}
-					}
-					else
-					{
-						page.buttons.back().sr.back().bm_width = 0;
-						page.buttons.back().sr.back().bm_height = 0;
-					}
+					break;
+
+					case "ii"_tag:	sr.ii = atoi(value.c_str()); break;
+					case "sb"_tag:	sr.sb = atoi(value.c_str()); break;
+					case "ji"_tag:	sr.ji = atoi(value.c_str()); break;
+					case "jb"_tag:	sr.jb = atoi(value.c_str()); break;
+					case "ix"_tag:	sr.ix = atoi(value.c_str()); break;
+					case "iy"_tag:	sr.iy = atoi(value.c_str()); break;
+					case "jt"_tag:	sr.jt = iToTo(atoi(value.c_str())); break;
+					case "tx"_tag:	sr.tx = atoi(value.c_str()); break;
+					case "ty"_tag:	sr.ty = atoi(value.c_str()); break;
+					case "fi"_tag:	sr.fi = atoi(value.c_str()); break;
+					case "te"_tag:	sr.te = value; break;
+					case "et"_tag:	sr.et = atoi(value.c_str()); break;
+					case "ww"_tag:	sr.ww = atoi(value.c_str()); break;
+					case "oo"_tag:	sr.oo = atoi(value.c_str()); break;
+					case "sd"_tag:	sr.sd = value; break;
 				}
-				else if (name.caseCompare("ii") == 0 && reader.has_value())
-					page.buttons.back().sr.back().ii = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("sb") == 0 && reader.has_value())
-					page.buttons.back().sr.back().sb = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ji") == 0 && reader.has_value())
-					page.buttons.back().sr.back().ji = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("jb") == 0 && reader.has_value())
-					page.buttons.back().sr.back().jb = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ix") == 0 && reader.has_value())
-					page.buttons.back().sr.back().ix = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("iy") == 0 && reader.has_value())
-					page.buttons.back().sr.back().iy = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("jt") == 0 && reader.has_value())
-					page.buttons.back().sr.back().jt = iToTo(atoi(reader.get_value().c_str()));
-				else if (name.caseCompare("tx") == 0 && reader.has_value())
-					page.buttons.back().sr.back().tx = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ty") == 0 && reader.has_value())
-					page.buttons.back().sr.back().ty = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("fi") == 0 && reader.has_value())
-					page.buttons.back().sr.back().fi = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("te") == 0 && reader.has_value())
-					page.buttons.back().sr.back().te = reader.get_value().raw();
-				else if (name.caseCompare("et") == 0 && reader.has_value())
-					page.buttons.back().sr.back().et = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ww") == 0 && reader.has_value())
-					page.buttons.back().sr.back().ww = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("oo") == 0 && reader.has_value())
-					page.buttons.back().sr.back().oo = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("sd") == 0 && reader.has_value())
-					page.buttons.back().sr.back().sd = reader.get_value().raw();
 			}
 
-			if (!inButton && name.caseCompare("sr") == 0 && reader.has_attributes())
+			if (!inButton && tag == "sr"_tag && hasAttributes)
 			{
 				SR_T sr;
-                sr.clear();
+				sr.clear();
 				sr.number = atoi(reader.get_attribute(0).c_str());
 				page.sr.push_back(sr);
-				sysl->TRACE("Page::Page: Added for page "+page.name+" sr with ID "+to_string(sr.number));
+				TRACER("Page::Page: Added for page "+page.name+" sr with ID "+to_string(sr.number));
 			}
 
-			if (reader.get_depth() == 4 && !inButton)
+			if (depth == 4 && !inButton && hasValue)
 			{
-				if (name.caseCompare("bs") == 0 && reader.has_value())
-					page.sr.back().bs = reader.get_value().raw();
-				else if (name.caseCompare("cb") == 0 && reader.has_value())
-					page.sr.back().cb = reader.get_value().raw();
-				else if (name.caseCompare("cf") == 0 && reader.has_value())
-					page.sr.back().cf = reader.get_value().raw();
-				else if (name.caseCompare("ct") == 0 && reader.has_value())
-					page.sr.back().ct = reader.get_value().raw();
-				else if (name.caseCompare("ec") == 0 && reader.has_value())
-					page.sr.back().ec = reader.get_value().raw();
-				else if (name.caseCompare("mi") == 0 && reader.has_value())
-                {
-					string mi = reader.get_value().raw();
-					page.sr.back().mi = mi;
-
-					if (!mi.empty())
-					{
-						int width, height;
+				SR_T& sr = page.sr.back();
 
-						if (PushButton::getImageDimensions(Configuration->getHTTProot()+"/images/"+mi, &width, &height))
-						{
-							page.sr.back().mi_width = width;
-							page.sr.back().mi_height = height;
-						}
-						else
-						{
-							page.sr.back().mi_width = 0;
-							page.sr.back().mi_height = 0;
-						}
-					}
-					else
-					{
-						page.sr.back().mi_width = 0;
-						page.sr.back().mi_height = 0;
-					}
-                }
-				else if (name.caseCompare("bm") == 0 && reader.has_value())
+				switch (tag)
 				{
-					string bm = reader.get_value().raw();
-					page.sr.back().bm = bm;
+					case "bs"_tag:	sr.bs = value; break;
+					case "cb"_tag:	sr.cb = value; break;
+					case "cf"_tag:	sr.cf = value; break;
+					case "ct"_tag:	sr.ct = value; break;
+					case "ec"_tag:	sr.ec = value; break;
 
-					if (reader.has_attributes())
-					{
-						if (reader.get_attribute(0).compare("0") == 0)
-							page.sr.back().dynamic = false;
-						else
-							page.sr.back().dynamic = true;
-					}
-
-					if (!bm.empty() && !page.sr.back().dynamic)
-					{
-						int width, height;
+					case "mi"_tag:
+						sr.mi = value;
+						sr.mi_width = sr.mi_height = 0;
 
-						if (PushButton::getImageDimensions(Configuration->getHTTProot()+"/images/"+bm, &width, &height))
+						if (!value.empty())
 						{
-							page.sr.back().bm_width = width;
-							page.sr.back().bm_height = height;
+							int width, height;
+
+							if (PushButton::getImageDimensions(Configuration->getHTTProot()+"/images/"+value, &width, &height))
+							{
+								sr.mi_width = width;
+								sr.mi_height = height;
+							}
 						}
-						else
+					break;
+
+					case "bm"_tag:
+						sr.bm = value;
+						sr.bm_width = sr.bm_height = 0;
+
+						if (hasAttributes)
+							sr.dynamic = (reader.get_attribute(0).compare("0") != 0);
+
+						if (!value.empty() && !sr.dynamic)
 						{
-							page.sr.back().bm_width = 0;
-							page.sr.back().bm_height = 0;
+							int width, height;
+
+							if (PushButton::getImageDimensions(Configuration->getHTTProot()+"/images/"+value, &width, &height))
+							{
+								sr.bm_width = width;
+								sr.bm_height = height;
+							}
 						}
-					}
-					else
-					{
-						page.sr.back().bm_width = 0;
-						page.sr.back().bm_height = 0;
-					}
+					break;
+
+					case "ii"_tag:	sr.ii = atoi(value.c_str()); break;
+					case "ji"_tag:	sr.ji = atoi(value.c_str()); break;
+					case "ix"_tag:	sr.ix = atoi(value.c_str()); break;
+					case "iy"_tag:	sr.iy = atoi(value.c_str()); break;
+					case "jt"_tag:	sr.jt = iToTo(atoi(value.c_str())); break;
+					case "tx"_tag:	sr.tx = atoi(value.c_str()); break;
+					case "ty"_tag:	sr.ty = atoi(value.c_str()); break;
+					case "fi"_tag:	sr.fi = atoi(value.c_str()); break;
 				}
-				else if (name.caseCompare("ii") == 0 && reader.has_value())
-					page.sr.back().ii = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ji") == 0 && reader.has_value())
-					page.sr.back().ji = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ix") == 0 && reader.has_value())
-					page.sr.back().ix = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("iy") == 0 && reader.has_value())
-					page.sr.back().iy = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("jt") == 0 && reader.has_value())
-					page.sr.back().jt = iToTo(atoi(reader.get_value().c_str()));
-				else if (name.caseCompare("tx") == 0 && reader.has_value())
-					page.sr.back().tx = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("ty") == 0 && reader.has_value())
-					page.sr.back().ty = atoi(reader.get_value().c_str());
-				else if (name.caseCompare("fi") == 0 && reader.has_value())
-					page.sr.back().fi = atoi(reader.get_value().c_str());
 			}
 
-			lastName = name.get();
+			lastName = name;
+			lastTag = tag;
 			oldDepth = depth;
 		}
 
@@ -587,7 +449,7 @@ bool amx::Page::parsePage()
 
 amx::Page::~Page()
 {
-	sysl->TRACE(Syslog::EXIT, std::string("Page::Page(...)"));
+	TRACER(Syslog::EXIT, std::string("Page::Page(...)"));
 
 //	if (paletteClass)
 //		delete paletteClass;
@@ -620,7 +482,7 @@ void Page::serializeToFile()
 	pgFile << "\t\"name\":\"" << page.name << "\",\"ID\":" << page.pageID << ",\"type\":" << page.type << "," << endl;
 	pgFile << "\t\"left\":" << page.left << ",\"top\":" << page.top << ",\"width\":" << page.width << ",\"height\":" << page.height << "," << endl;
 	pgFile << "\t\"group\":\"" << page.group << "\",\"modal\":" << page.modal << ",\"showEffect\":" << page.showEffect << ",\"showTime\":" << page.showTime << "," << endl;
-	pgFile << "\t\"hideEffect\":" << page.hideEffect << ",\"hideTime\":" << page.hideTime << ",\"timeout\":" << page.timeout << ",\"buttons\":[";
+	pgFile << "\t\"hideEffect\":" << page.hideEffect << ",\"hideTime\":" << page.hideTime << ",\"timeout\":" << page.timeout << ",\"cls\":\"" << styleBuffer << "\",\"buttons\":[";
 
 	for (size_t i = 0; i < page.buttons.size(); i++)
 	{
@@ -637,7 +499,8 @@ void Page::serializeToFile()
 		pgFile << "\t\t \"ru\":" << page.buttons[i].ru << ",\"rd\":" << page.buttons[i].rd << ",\"op\":\"" << page.buttons[i].op << "\",\"mt\":" << page.buttons[i].mt << "," << endl;
 		pgFile << "\t\t \"rn\":" << page.buttons[i].rn << ",\"sd\":\"" << page.buttons[i].sd << "\",\"sc\":\"" << page.buttons[i].sc << "\",\"if\":\"" << page.buttons[i]._if << "\",";
 		pgFile << "\"lu\":" << page.buttons[i].lu << ",\"ld\":" << page.buttons[i].ld << ",\"ri\":" << (page.buttons[i].ri ? "true" : "false") << "," << endl;
-		pgFile << "\t\t \"dt\":\"" << page.buttons[i].dt << "\",\"im\":\"" << page.buttons[i].im << "\",\"stateCount\":" << page.buttons[i].stateCount << "," << endl;
+		pgFile << "\t\t \"dt\":\"" << page.buttons[i].dt << "\",\"im\":\"" << page.buttons[i].im << "\",\"stateCount\":" << page.buttons[i].stateCount << ",";
+		pgFile << "\"cls\":\"" << ((i < btStyles.size()) ? btStyles[i].frame : string()) << "\"," << endl;
 
 		if (page.buttons[i].pushFunc.size() > 0)
 		{
@@ -670,7 +533,12 @@ void Page::serializeToFile()
 			pgFile << "\t\t\t \"ji\":" << page.buttons[i].sr[j].ji << ",\"jb\":" << page.buttons[i].sr[j].jb << ",\"ix\":" << page.buttons[i].sr[j].ix << "," << endl;
 			pgFile << "\t\t\t \"iy\":" << page.buttons[i].sr[j].iy << ",\"fi\":" << page.buttons[i].sr[j].fi << ",\"te\":\"" << NameFormat::textToWeb(page.buttons[i].sr[j].te) << "\"," << endl;
 			pgFile << "\t\t\t \"jt\":" << page.buttons[i].sr[j].jt << ",\"tx\":" << page.buttons[i].sr[j].tx << ",\"ty\":" << page.buttons[i].sr[j].ty << "," << endl;
-			pgFile << "\t\t\t \"ww\":" << page.buttons[i].sr[j].ww << ",\"et\":" << page.buttons[i].sr[j].et << ",\"oo\":" << page.buttons[i].sr[j].oo << ",\"sd\":\"" << page.buttons[i].sr[j].sd << "\"}";
+			pgFile << "\t\t\t \"ww\":" << page.buttons[i].sr[j].ww << ",\"et\":" << page.buttons[i].sr[j].et << ",\"oo\":" << page.buttons[i].sr[j].oo << ",\"sd\":\"" << page.buttons[i].sr[j].sd << "\",";
+
+			if (i < btStyles.size() && j < btStyles[i].state.size())
+				pgFile << "\"cls\":\"" << btStyles[i].state[j] << "\",\"fcls\":\"" << btStyles[i].text[j] << "\"}";
+			else
+				pgFile << "\"cls\":\"\",\"fcls\":\"\"}";
 		}
 
 		pgFile << "]\n\t\t}";
@@ -719,8 +587,7 @@ void amx::Page::generateButtons()
 	if (buttonsDone)
 		return;
 
-	string buf;
-	sysl->TRACE("Page::generateButtons: for page: "+page.name);
+	TRACER("Page::generateButtons: for page: "+page.name);
 
 	try
 	{
@@ -749,6 +616,8 @@ void amx::Page::generateButtons()
 				btArray += "\"ap\":"+to_string(page.buttons[i].ap)+",\"ac\":"+to_string(page.buttons[i].ad);
 				btArray += ",\"cp\":"+to_string(page.buttons[i].cp)+",\"ch\":"+to_string(page.buttons[i].ch)+",";
 				btArray += "\"ion\":"+to_string(on)+",\"visible\":1,\"enabled\":1}";
+
+				btAddr.push_back(getAddress(page.buttons[i]));
 			}
 
 			PushButton pbt(page.buttons[i], paletteClass->getPalette());
@@ -756,8 +625,17 @@ void amx::Page::generateButtons()
 			pbt.setPageList(pgList);
 			pbt.setIconClass(iconClass);
 			pbt.setPageID(page.pageID);
-			buf.assign(pbt.getWebCode());
-			btWebBuffer.push_back(buf);
+			pbt.getWebCode();		// Creates the bargraphs
+			BT_STYLE_T bst;
+			bst.frame = pbt.getStyle(styleSheet);
+
+			for (size_t j = 0; j < page.buttons[i].sr.size(); j++)
+			{
+				bst.state.push_back(pbt.getStateStyle(styleSheet, j));
+				bst.text.push_back(pbt.getTextStyle(styleSheet, j));
+			}
+
+			btStyles.push_back(bst);
 			scriptCode.append(pbt.getScriptCode());
 			scrStart.append(pbt.getScriptCodeStart());
 
@@ -765,7 +643,10 @@ void amx::Page::generateButtons()
 				sBargraphs.append(",\n");
 
 			if (pbt.haveBargraph())
+			{
 				sBargraphs.append(pbt.getBargraphs());
+				bgAddr.push_back(getAddress(page.buttons[i]));
+			}
 		}
 	}
 	catch (exception& e)
@@ -776,103 +657,54 @@ void amx::Page::generateButtons()
 	buttonsDone = true;
 }
 
+/*
+ * Creates the CSS of the page. The declarations are not written into a page
+ * specific rule but are interned in the global style sheet. What we get back
+ * are the names of the shared classes, which are stored in "styleBuffer".
+ * Visibility (display) and the show/hide animations are handled by the
+ * browser (page.js) and are therefore not part of the style.
+ */
 string& Page::getStyleCode()
 {
 	DECL_TRACER("Page::getStyleCode()");
 
-	if (!status || styleDone || !paletteClass)
+	if (!status || styleDone || !paletteClass || !styleSheet)
 		return styleBuffer;
 
-	string pgName = "Page_"+to_string(page.pageID);
-	styleBuffer = "."+pgName+" {\n";
-	styleBuffer += "  left: "+to_string(page.left)+"px;\n";
-	styleBuffer += "  top: "+to_string(page.top)+"px;\n";
-	styleBuffer += "  width: "+to_string(page.width)+"px;\n";
-	styleBuffer += "  height: "+to_string(page.height)+"px;\n";
+	CSS_DECL_T box, skin;
+	box.push_back("position: absolute");		// Fixed position, don't move
+	box.push_back("left: "+to_string(page.left)+"px");
+	box.push_back("top: "+to_string(page.top)+"px");
+	box.push_back("width: "+to_string(page.width)+"px");
+	box.push_back("height: "+to_string(page.height)+"px");
 
-	bool hasChameleon = (!page.sr[0].mi.empty() && !page.sr[0].bm.empty() && page.sr[0].bs.empty());
-	sysl->TRACE("Page::getStyleCode: hasChameleon="+to_string(hasChameleon)+", mi="+page.sr[0].mi+", bm="+page.sr[0].bm+", bs="+page.sr[0].bs);
+	if (page.type == PAGE)
+		box.push_back("overflow: hidden");		// Enable scroll if needed
 
-	if (page.sr.size() > 0 && page.sr[0].bm.length() > 0)
-	{
-		if (!hasChameleon)
-		{
-			styleBuffer += "  background-color: "+paletteClass->colorToString(paletteClass->getColor(page.sr[0].cf))+";\n";
-			styleBuffer += "  background-image: url(images/"+page.sr[0].bm+");\n";
-		}
+	styleBuffer = styleSheet->intern(box);
 
-		styleBuffer += "  color: "+paletteClass->colorToString(paletteClass->getColor(page.sr[0].ct))+";\n";
-		styleBuffer += "  background-repeat: no-repeat;\n";
-	}
-
-	if (page.type == SUBPAGE)
+	// The skin is the same page.js applies. A chameleon image (mi) is drawn
+	// on a canvas, so neither the fill color nor the bitmap (the mask) may
+	// be visible below it.
+	if (page.sr.size() > 0)
 	{
-		if (Project)
-		{
-			bool have = false;
-
-			for (size_t x = 0; x < Project->panelSetup.powerUpPopup.size(); x++)
-			{
-				if (page.name.compare(Project->panelSetup.powerUpPopup[x]) == 0)
-				{
-					styleBuffer += "  display: inline-block;\n";	// Show the popup
-					have = true;
-					break;
-				}
-			}
-		}
+		bool hasChameleon = !page.sr[0].mi.empty();
+		TRACER("Page::getStyleCode: hasChameleon="+to_string(hasChameleon)+", mi="+page.sr[0].mi+", bm="+page.sr[0].bm+", bs="+page.sr[0].bs);
 
-		styleBuffer += "  position: absolute;\n";		// Fixed position, don't move
+		if (!hasChameleon && !page.sr[0].cf.empty())
+			skin.push_back("background-color: "+paletteClass->colorToString(paletteClass->getColor(page.sr[0].cf)));
 
-		if (page.showEffect && page.showTime)
-		{
-			styleBuffer += "  animation-name: ani_"+pgName+";\n";
-			styleBuffer += "  animation-duration: "+to_string((double)page.showTime / 10.0)+"s;\n";
-			styleBuffer += "}\n";
-			styleBuffer += "@keyframes ani_"+pgName+" {\n";
-
-			switch (page.showEffect)
-			{
-				case SE_SLIDE_TOP:			// top
-				case SE_SLIDE_TOP_FADE:
-					styleBuffer += "  from { top: -"+to_string(page.top)+"px; opacity: 0; }\n";
-					styleBuffer += "  to { top: 0; opacity: 1; }\n";
-				break;
-				case SE_SLIDE_LEFT:			// left
-				case SE_SLIDE_LEFT_FADE:
-					styleBuffer += "  from { left: -"+to_string(page.left)+"px; opacity: 0; }\n";
-					styleBuffer += "  to { left: 0; opacity: 1; }\n";
-				break;
-				case SE_SLIDE_RIGHT:		// rght
-				case SE_SLIDE_RIGHT_FADE:
-					styleBuffer += "  from { right: -"+to_string(page.left+page.width)+"px; opacity: 0; }\n";
-					styleBuffer += "  to { right: 0; opacity: 1; }\n";
-				break;
-				case SE_SLIDE_BOTTOM:		// bottom
-				case SE_SLIDE_BOTTOM_FADE:
-					styleBuffer += "  from { top: "+to_string(totalHeight)+"px; opacity: 0; }\n";
-					styleBuffer += "  to { top: "+to_string(totalHeight-page.height)+"; opacity: 1; }\n";
-				break;
-				case SE_FADE:
-					styleBuffer += "  from { bottom: "+to_string(totalHeight)+"px; opacity: 0; }\n";
-					styleBuffer += "  to { bottom: "+to_string(totalHeight-page.height)+"; opacity: 1; }\n";
-				break;
-			}
-		}
+		if (!page.sr[0].ct.empty())
+			skin.push_back("color: "+paletteClass->colorToString(paletteClass->getColor(page.sr[0].ct)));
 
-		styleBuffer += "}\n";
-	}
-	else if (page.type == PAGE)
-	{
-		if (Project)
+		if (!hasChameleon && !page.sr[0].bm.empty())
 		{
-			if (page.name.compare(Project->panelSetup.powerUpPage) == 0)
-				styleBuffer += "  display: block;\n";		// Show the page
+			skin.push_back("background-image: url('images/"+page.sr[0].bm+"')");
+			skin.push_back("background-repeat: no-repeat");
 		}
 
-		styleBuffer += "  position: absolute;\n";			// Fixed position, don't move
-		styleBuffer += "  overflow: hidden;\n";				// Enable scroll if needed
-		styleBuffer += "}\n";
+		if (!skin.empty())
+			styleBuffer += " "+styleSheet->intern(skin);
 	}
 
 	generateButtons();
@@ -880,33 +712,9 @@ string& Page::getStyleCode()
 	return styleBuffer;
 }
 
-string& Page::getWebCode()
-{
-	DECL_TRACER(std::string("Page::getWebCode()"));
-
-	if (!status || webDone)
-		return webBuffer;
-
-	// Here we know, that we've never build the code to draw this page.
-	// Therefore we'll do it now.
-	// First we scan for all buttons and create them.
-	generateButtons();
-
-	string pgName = "Page_"+to_string(page.pageID);
-	webBuffer += "<div id=\""+pgName+"\" class=\""+pgName+"\">\n";
-
-	for (size_t i = 0; i < btWebBuffer.size(); i++)
-		webBuffer += btWebBuffer[i];
-
-	webBuffer += "</div>\n";
-
-	webDone = true;
-	return webBuffer;
-}
-
 void amx::Page::clear()
 {
-	sysl->TRACE("Page::clear()");
+	TRACER("Page::clear()");
 
 	page.buttons.clear();
 	page.group.clear();
@@ -927,6 +735,20 @@ void amx::Page::clear()
 	status = false;
 }
 
+BT_ADDR_T amx::Page::getAddress(const BUTTON_T& bt)
+{
+	BT_ADDR_T addr;
+	addr.pnum = page.pageID;
+	addr.bi = bt.bi;
+	addr.ap = bt.ap;
+	addr.ad = bt.ad;
+	addr.cp = bt.cp;
+	addr.ch = bt.ch;
+	addr.lp = bt.lp;
+	addr.lv = bt.lv;
+	return addr;
+}
+
 TEXT_ORIENTATION amx::Page::iToTo(int t)
 {
 	switch(t)
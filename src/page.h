@@ -23,9 +23,34 @@
 #include "panelstruct.h"
 #include "pushbutton.h"
 #include "icon.h"
+#include "stylesheet.h"
 
 namespace amx
 {
+	/*
+	 * The addresses of a button or bargraph. They are collected while the
+	 * buttons are generated and written as lookup tables to the browser, so
+	 * it can find a button by port and channel without scanning all buttons.
+	 */
+	typedef struct BT_ADDR
+	{
+		int pnum{0};			// Page number
+		int bi{0};				// Button ID
+		int ap{0};				// Address port
+		int ad{0};				// Address channel
+		int cp{0};				// Channel port
+		int ch{0};				// Channel number
+		int lp{0};				// Level port
+		int lv{0};				// Level number
+	}BT_ADDR_T;
+
+	typedef struct BT_STYLE_T
+	{
+		std::string frame;				// CSS classes of the button frame
+		std::vector<std::string> state;	// CSS class of the skin per state
+		std::vector<std::string> text;	// CSS class of the text per state
+	}BT_STYLE_T;
+
 	class Page
 	{
 		public:
@@ -38,7 +63,6 @@ namespace amx
 			bool parsePage();
 			bool isOk() { return status; }
 			std::string& getStyleCode();
-			std::string& getWebCode();
 			int getPageID() { return page.pageID; }
 			std::string& getPageName() { return page.name; }
 			PAGETYPE getType() { return page.type; }
@@ -50,6 +74,8 @@ namespace amx
 			bool haveBtArray() { return !btArray.empty(); }
 			std::string& getBargraphs() { return sBargraphs; }
 			bool haveBargraphs() { return !sBargraphs.empty(); }
+			std::vector<BT_ADDR_T>& getBtAddresses() { return btAddr; }
+			std::vector<BT_ADDR_T>& getBgAddresses() { return bgAddr; }
 			PAGE_T& getPageData() { return page; }
 
 			void setPalette(Palette *pal) { paletteClass = pal; }
@@ -58,6 +84,7 @@ namespace amx
 			void setIconClass(Icon *ic) { iconClass = ic; }
 			void setPageList(const std::vector<PAGE_T>& p) { pgList = p; }
 			void setProject(PROJECT_T *prj) { Project = prj; }
+			void setStyleSheet(StyleSheet *ss) { styleSheet = ss; }
 
 			void serializeToFile();
 
@@ -65,15 +92,14 @@ namespace amx
 			void clear();
 			void generateButtons();
 			TEXT_ORIENTATION iToTo(int t);
+			BT_ADDR_T getAddress(const BUTTON_T& bt);
 
 			PAGE_T page;
 			std::vector<PAGE_T> pgList;
 			bool status;
 			bool buttonsDone;
 			bool styleDone;
-			bool webDone;
-			std::string webBuffer;
-			std::vector<std::string> btWebBuffer;
+			std::vector<BT_STYLE_T> btStyles;		// CSS class names of the buttons
 			std::string styleBuffer;
 			std::string scriptCode;
 			std::string scrStart;
@@ -81,11 +107,14 @@ namespace amx
 			std::string pageFile;
 			std::string btArray;
 			std::string sBargraphs;
+			std::vector<BT_ADDR_T> btAddr;		// Addresses of entries in btArray
+			std::vector<BT_ADDR_T> bgAddr;		// Addresses of entries in sBargraphs
 			int totalWidth;
 			int totalHeight;
 			FontList *fontClass;
 			Palette *paletteClass;
 			Icon *iconClass;
+			StyleSheet *styleSheet;
 			PROJECT_T *Project;
 	};
 }
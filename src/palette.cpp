@@ -43,12 +43,12 @@ using namespace amx;
 
 Palette::Palette()
 {
-	sysl->TRACE(Syslog::ENTRY, "Palette::Palette()");
+	TRACER(Syslog::ENTRY, "Palette::Palette()");
 }
 
 Palette::Palette(const string& file)
 {
-	sysl->TRACE(Syslog::ENTRY, "Palette::Palette(const string& file)");
+	TRACER(Syslog::ENTRY, "Palette::Palette(const string& file)");
 	bool hasFile = false;
 
 	for (size_t i = 0; i < paletteFiles.size(); i++)
@@ -69,7 +69,7 @@ Palette::Palette(const string& file)
 
 amx::Palette::Palette(const std::vector<PALETTE_T>& pal)
 {
-	sysl->TRACE(Syslog::ENTRY, "Palette::Palette(const std::vector<PALETTE_T>& pal)");
+	TRACER(Syslog::ENTRY, "Palette::Palette(const std::vector<PALETTE_T>& pal)");
 	paletteFiles.clear();
 
 	for (size_t i = 0; i < pal.size(); i++)
@@ -81,10 +81,10 @@ amx::Palette::Palette(const std::vector<PALETTE_T>& pal)
 
 Palette::Palette(const std::vector<PALETTE_T>& pal, const string& main)
 {
-	sysl->TRACE(Syslog::ENTRY, "Palette::Palette(const std::vector<PALETTE_T>& pal, const string& main)");
+	TRACER(Syslog::ENTRY, "Palette::Palette(const std::vector<PALETTE_T>& pal, const string& main)");
 	paletteFiles.clear();
 
-	sysl->TRACE("Palette::Palette: Have "+to_string(pal.size())+" palettes.");
+	TRACER("Palette::Palette: Have "+to_string(pal.size())+" palettes.");
 
 	for (size_t i = 0; i < pal.size(); i++)
 		paletteFiles.push_back(pal[i].file);
@@ -139,7 +139,7 @@ bool amx::Palette::parsePalette(const string& f)
 	uri.append(Configuration->getHTTProot());
 	uri.append("/");
 	uri.append(f);
-	sysl->TRACE("Palette file: "+uri);
+	TRACER("Palette file: "+uri);
 
 	try
 	{
@@ -168,7 +168,7 @@ bool amx::Palette::parsePalette(const string& f)
 
 			if (name.caseCompare("color") == 0 && !value.empty() && !at_index.empty())
 			{
-				sysl->TRACE("Palette::parsePalette: Node: "+name+", Value: "+reader.get_value()+", Attr[0].: "+at_name+", Attr[1].: "+at_index);
+				TRACER("Palette::parsePalette: Node: "+name+", Value: "+reader.get_value()+", Attr[0].: "+at_name+", Attr[1].: "+at_index);
 				PDATA_T color;
 				color.clear();
 				string sCol;
@@ -215,14 +215,14 @@ bool amx::Palette::parsePalette(const string& f)
 		return status;
 	}
 
-	sysl->TRACE("Palette::parsePalette: Found "+to_string(palette.size())+" colors.");
+	TRACER("Palette::parsePalette: Found "+to_string(palette.size())+" colors.");
 	status = true;
 	return status;
 }
 
 Palette::~Palette()
 {
-    sysl->TRACE(Syslog::EXIT, "Palette::~Palette(...)");
+    TRACER(Syslog::EXIT, "Palette::~Palette(...)");
 }
 
 unsigned long Palette::getColor(size_t idx)
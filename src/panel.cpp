@@ -44,7 +44,7 @@ using namespace amx;
 Panel::Panel(PROJECT_T& prj, Palette *pPalet, Icon *pIco, FontList *pFL)
             : Project{prj}
 {
-	sysl->TRACE(Syslog::ENTRY, "Panel::Panel(const PROJECT& prj, Palette *pPalet, Icon *pIco, FontList *pFL)");
+	TRACER(Syslog::ENTRY, "Panel::Panel(const PROJECT& prj, Palette *pPalet, Icon *pIco, FontList *pFL)");
 	pPalettes = pPalet;
 	pIcons = pIco;
 	pFontLists = pFL;
@@ -57,7 +57,7 @@ Panel::Panel(PROJECT_T& prj, Palette *pPalet, Icon *pIco, FontList *pFL)
 
 Panel::~Panel()
 {
-	sysl->TRACE(Syslog::EXIT, "Panel::Panel(const PROJECT& prj, Palette *pPalet, Icon *pIco, FontList *pFL)");
+	TRACER(Syslog::EXIT, "Panel::Panel(const PROJECT& prj, Palette *pPalet, Icon *pIco, FontList *pFL)");
 
 	if (pPalettes && localPalette)
 		delete pPalettes;
@@ -74,6 +74,7 @@ void Panel::readProject()
 	DECL_TRACER("Panel::readProject()");
 
 	string name, lastName, attr;
+	XMLTAG lastTag = 0;
 	int depth = 0;
 	bool endElement = false;		// end of XML element detected
 	status = true;
@@ -95,7 +96,7 @@ void Panel::readProject()
 	string uri; // = "file://";
 	uri.append(Configuration->getHTTProot());
 	uri.append("/prj.xma");
-	sysl->TRACE("Panel::readProject: Reading from file: "+uri);
+	TRACER("Panel::readProject: Reading from file: "+uri);
 
 	if (Project.fwFeatureList.size() > 0 || Project.pageLists.size() > 0 ||
 		Project.paletteList.size() > 0 || Project.resourceLists.size() > 0)
@@ -109,93 +110,106 @@ void Panel::readProject()
 	try
 	{
 		TextReader reader(uri);
-		sysl->TRACE("Panel::readProject: XML file was parsed ...");
+		TRACER("Panel::readProject: XML file was parsed ...");
 
 		while(reader.read())
 		{
 			name = reader.get_name().raw();
+			XMLTAG tag = tagHash(name);
 
-			if (name.compare("#text") == 0)
+			if (tag == "#text"_tag)
+			{
 				name = lastName;
+				tag = lastTag;
+			}
 
-			endElement = (reader.get_depth() < depth);
-			sysl->TRACE("Panel::readProject: name="+name+", endElement="+to_string(endElement)+", Part="+to_string(Part)+", depth="+to_string(reader.get_depth())+" ("+to_string(depth)+")");
+			int rdepth = reader.get_depth();
+			endElement = (rdepth < depth);
+			TRACER("Panel::readProject: name="+name+", endElement="+to_string(endElement)+", Part="+to_string(Part)+", depth="+to_string(rdepth)+" ("+to_string(depth)+")");
 
-			if (reader.get_depth() <= 1 && depth > 1)
+			if (rdepth <= 1 && depth > 1)
 				Part = eNone;
 
-			if (!endElement && Str::caseCompare(name, "pageList") == 0 && depth == 1)
-			{
-				Part = ePageList;
-
-				if (reader.has_attributes())
-					attr = reader.get_attribute(0).raw();
-				else
-					attr.clear();
-
-				if (!attr.empty())
-				{
-					PAGE_LIST_T pageList;
-					pageList.type = attr;
-					Project.pageLists.push_back(pageList);
-					attr.clear();
-					sysl->TRACE("Panel::readProject: Added a PAGE_LIST_T entry!");
-				}
-			}
-			else if (!endElement && Part == ePageList && Str::caseCompare(name, "pageEntry") == 0 && reader.get_depth() >= depth)
+			if (!endElement)
 			{
-				if (Project.pageLists.size() > 0)
+				switch (tag)
 				{
-					PAGE_LIST_T& pageList = Project.pageLists.back();
-					PAGE_ENTRY_T pageEntry;
-					pageEntry.clear();
-					pageList.pageList.push_back(pageEntry);
-					sysl->TRACE("Panel::readProject: Added a PAGE_ENTRY_T entry to "+pageList.type+"!");
+					case "pageList"_tag:
+					case "resourceList"_tag:
+						if (depth != 1)
+							break;
+
+						Part = (tag == "pageList"_tag) ? ePageList : eResourceList;
+
+						if (reader.has_attributes())
+							attr = reader.get_attribute(0).raw();
+						else
+							attr.clear();
+
+						if (!attr.empty())
+						{
+							if (Part == ePageList)
+							{
+								PAGE_LIST_T pageList;
+								pageList.type = attr;
+								Project.pageLists.push_back(pageList);
+								TRACER("Panel::readProject: Added a PAGE_LIST_T entry!");
+							}
+							else
+							{
+								RESOURCE_LIST_T rl;
+								rl.type = attr;
+								Project.resourceLists.push_back(rl);
+								TRACER("Panel::readProject: Added a RESOURCE_LIST_T entry!");
+							}
+
+							attr.clear();
+						}
+					break;
+
+					case "pageEntry"_tag:
+						if (Part == ePageList && rdepth >= depth && Project.pageLists.size() > 0)
+						{
+							PAGE_LIST_T& pageList = Project.pageLists.back();
+							PAGE_ENTRY_T pageEntry;
+							pageEntry.clear();
+							pageList.pageList.push_back(pageEntry);
+							TRACER("Panel::readProject: Added a PAGE_ENTRY_T entry to "+pageList.type+"!");
+						}
+					break;
+
+					case "resource"_tag:
+						if (Part == eResourceList && rdepth >= depth && Project.resourceLists.size() > 0)
+						{
+							RESOURCE_LIST_T& rl = Project.resourceLists.back();
+							RESOURCE_T res;
+							res.clear();
+							rl.ressource.push_back(res);
+							TRACER("Panel::readProject: Added a RESOURCE_T entry to "+rl.type+"!");
+						}
+					break;
+
+					case "feature"_tag:
+						if (Part == eFwFeatureList && rdepth > depth)
+						{
+							FEATURE_T fwl;
+							Project.fwFeatureList.push_back(fwl);
+							TRACER("Panel::readProject: Added a FEATURE_T entry!");
+						}
+					break;
+
+					case "palette"_tag:
+						if (Part == ePaletteList && rdepth >= depth)
+						{
+							PALETTE_T pal;
+							Project.paletteList.push_back(pal);
+							TRACER("Panel::readProject: Added a PALETTE_T entry!");
+						}
+					break;
 				}
 			}
-			else if (!endElement && Str::caseCompare(name, "resourceList") == 0 && depth == 1)
-			{
-				Part = eResourceList;
 
-				if (reader.has_attributes())
-					attr = reader.get_attribute(0).raw();
-				else
-					attr.clear();
-
-				if (!attr.empty())
-				{
-					RESOURCE_LIST_T rl;
-					rl.type = attr;
-					Project.resourceLists.push_back(rl);
-					attr.clear();
-					sysl->TRACE("Panel::readProject: Added a RESOURCE_LIST_T entry!");
-				}
-			}
-			else if (!endElement && Part == eResourceList && Str::caseCompare(name, "resource") == 0 && reader.get_depth() >= depth)
-			{
-				if (Project.resourceLists.size() > 0)
-				{
-					RESOURCE_LIST_T& rl = Project.resourceLists.back();
-					RESOURCE_T res;
-					res.clear();
-					rl.ressource.push_back(res);
-					sysl->TRACE("Panel::readProject: Added a RESOURCE_T entry to "+rl.type+"!");
-				}
-			}
-			else if (!endElement && Part == eFwFeatureList && Str::caseCompare(name, "feature") == 0 && reader.get_depth() > depth)
-			{
-				FEATURE_T fwl;
-				Project.fwFeatureList.push_back(fwl);
-				sysl->TRACE("Panel::readProject: Added a FEATURE_T entry!");
-			}
-			else if (!endElement && Part == ePaletteList && Str::caseCompare(name, "palette") == 0 && reader.get_depth() >= depth)
-			{
-				PALETTE_T pal;
-				Project.paletteList.push_back(pal);
-				sysl->TRACE("Panel::readProject: Added a PALETTE_T entry!");
-			}
-
-			depth = reader.get_depth();
+			depth = rdepth;
 
 			if(!endElement && (reader.has_value() || reader.has_attributes()))
 			{
@@ -213,42 +227,41 @@ void Panel::readProject()
 					attr = Str::trim(att);
 				}
 
-				sysl->TRACE("Panel::readProject: name="+name+", value="+value+", attr="+attr+", Part="+to_string(Part)+", endElement="+to_string(endElement));
+				TRACER("Panel::readProject: name="+name+", value="+value+", attr="+attr+", Part="+to_string(Part)+", endElement="+to_string(endElement));
 
 				if (!value.empty() || !attr.empty())
 				{
 					switch(Part)
 					{
-						case eVersionInfo:      setVersionInfo(name, value); attr.clear(); break;
-						case eProjectInfo:      setProjectInfo(name, value, attr); attr.clear(); break;
-						case eSupportFileList:  setSupportFileList(name, value); attr.clear(); break;
-						case ePanelSetup:       setPanelSetup(name, value); attr.clear(); break;
-						case ePageList:			setPageList(name, value); break;
-						case eResourceList:		setResourceList(name, value, attr); break;
-						case eFwFeatureList:	setFwFeatureList(name, value); break;
-						case ePaletteList:		setPaletteList(name, value); break;
+						case eVersionInfo:      setVersionInfo(tag, value); attr.clear(); break;
+						case eProjectInfo:      setProjectInfo(tag, value, attr); attr.clear(); break;
+						case eSupportFileList:  setSupportFileList(tag, value); attr.clear(); break;
+						case ePanelSetup:       setPanelSetup(tag, value); attr.clear(); break;
+						case ePageList:			setPageList(tag, value); break;
+						case eResourceList:		setResourceList(tag, value, attr); break;
+						case eFwFeatureList:	setFwFeatureList(tag, value); break;
+						case ePaletteList:		setPaletteList(tag, value); break;
+						default:				break;
 					}
 				}
 			}
 			else if (!endElement)
 			{
-				if (Str::caseCompare(name, "versionInfo") == 0)
-					Part = eVersionInfo;
-				else if (Str::caseCompare(name, "projectInfo") == 0)
-					Part = eProjectInfo;
-				else if (Str::caseCompare(name, "supportFileList") == 0)
-					Part = eSupportFileList;
-				else if (Str::caseCompare(name, "panelSetup") == 0)
-					Part = ePanelSetup;
-				else if (Str::caseCompare(name, "fwFeatureList") == 0)
-					Part = eFwFeatureList;
-				else if (Str::caseCompare(name, "paletteList") == 0)
-					Part = ePaletteList;
-
-				sysl->TRACE("Panel::readProject: *name="+name+", Part="+to_string(Part)+", endElement="+to_string(endElement));
+				switch (tag)
+				{
+					case "versionInfo"_tag:		Part = eVersionInfo; break;
+					case "projectInfo"_tag:		Part = eProjectInfo; break;
+					case "supportFileList"_tag:	Part = eSupportFileList; break;
+					case "panelSetup"_tag:		Part = ePanelSetup; break;
+					case "fwFeatureList"_tag:	Part = eFwFeatureList; break;
+					case "paletteList"_tag:		Part = ePaletteList; break;
+				}
+
+				TRACER("Panel::readProject: *name="+name+", Part="+to_string(Part)+", endElement="+to_string(endElement));
 			}
 
 			lastName = name;
+			lastTag = tag;
 		}
 
 		reader.close();
@@ -261,43 +274,43 @@ void Panel::readProject()
 
 	if (Configuration->getDebug())
 	{
-		sysl->TRACE("Panel::readProject: pageLists: "+to_string(Project.pageLists.size()));
+		TRACER("Panel::readProject: pageLists: "+to_string(Project.pageLists.size()));
 
 		for (size_t i = 0; i < Project.pageLists.size(); i++)
 		{
 			PAGE_LIST_T pl = Project.pageLists[i];
-			sysl->TRACE("Panel::readProject: pageList type: "+pl.type+" has "+to_string(pl.pageList.size())+" entries.");
+			TRACER("Panel::readProject: pageList type: "+pl.type+" has "+to_string(pl.pageList.size())+" entries.");
 
 			for (size_t j = 0; j < pl.pageList.size(); j++)
 			{
 				PAGE_ENTRY_T pe = pl.pageList[j];
-				sysl->TRACE("Panel::readProject: name="+pe.name+", ID="+to_string(pe.pageID));
+				TRACER("Panel::readProject: name="+pe.name+", ID="+to_string(pe.pageID));
 			}
 		}
 
-		sysl->TRACE("Panel::readProject: resourceLists: "+to_string(Project.resourceLists.size()));
+		TRACER("Panel::readProject: resourceLists: "+to_string(Project.resourceLists.size()));
 
 		for (size_t i = 0; i < Project.resourceLists.size(); i++)
 		{
 			RESOURCE_LIST_T rl = Project.resourceLists[i];
-			sysl->TRACE("Panel::readProject: resourceLists type: "+rl.type+" has "+to_string(rl.ressource.size())+" entries.");
+			TRACER("Panel::readProject: resourceLists type: "+rl.type+" has "+to_string(rl.ressource.size())+" entries.");
 
 			for (size_t j = 0; j < rl.ressource.size(); j++)
 			{
 				RESOURCE_T res = rl.ressource[j];
-				sysl->TRACE("Panel::readProject: name="+res.name+", File="+res.file);
+				TRACER("Panel::readProject: name="+res.name+", File="+res.file);
 			}
 		}
 
-		sysl->TRACE("Panel::readProject: fwFeatureList: "+to_string(Project.fwFeatureList.size()));
+		TRACER("Panel::readProject: fwFeatureList: "+to_string(Project.fwFeatureList.size()));
 
 		for (size_t i = 0; i < Project.fwFeatureList.size(); i++)
-			sysl->TRACE("Panel::readProject: ID="+Project.fwFeatureList[i].featureID+", count="+to_string(Project.fwFeatureList[i].usageCount));
+			TRACER("Panel::readProject: ID="+Project.fwFeatureList[i].featureID+", count="+to_string(Project.fwFeatureList[i].usageCount));
 
-		sysl->TRACE("Panel::readProject: paletteList: "+to_string(Project.paletteList.size()));
+		TRACER("Panel::readProject: paletteList: "+to_string(Project.paletteList.size()));
 
 		for (size_t i = 0; i < Project.paletteList.size(); i++)
-			sysl->TRACE("Panel::readProject: ID="+to_string(Project.paletteList[i].paletteID)+", name="+Project.paletteList[i].name+", file="+Project.paletteList[i].file);
+			TRACER("Panel::readProject: ID="+to_string(Project.paletteList[i].paletteID)+", name="+Project.paletteList[i].name+", file="+Project.paletteList[i].file);
 	}
 
 	try
@@ -341,12 +354,12 @@ vector<string> Panel::getPageFileNames()
 	DECL_TRACER("Panel::getPageFileNames()");
 	vector<string> pgFnLst;
 
-	sysl->TRACE("Panel::getPageFileNames: Number of pages: "+to_string(Project.pageLists.size()));
+	TRACER("Panel::getPageFileNames: Number of pages: "+to_string(Project.pageLists.size()));
 
 	for (size_t i = 0; i < Project.pageLists.size(); i++)
 	{
 		PAGE_LIST_T pl = Project.pageLists[i];
-		sysl->TRACE("Panel::getPageFileNames: Number of pages in pages: "+to_string(pl.pageList.size()));
+		TRACER("Panel::getPageFileNames: Number of pages in pages: "+to_string(pl.pageList.size()));
 
 		for (size_t j = 0; j < pl.pageList.size(); j++)
 		{
@@ -360,213 +373,131 @@ vector<string> Panel::getPageFileNames()
 	return pgFnLst;
 }
 
-void Panel::setVersionInfo(const string& name, const string& value)
+void Panel::setVersionInfo(XMLTAG tag, const string& value)
 {
-	DECL_TRACER("Panel::setVersionInfo(const string& name, const string& value)");
+	DECL_TRACER("Panel::setVersionInfo(XMLTAG tag, const string& value)");
 
-    if (Str::caseCompare(name, "formatVersion") == 0)
-        Project.version.formatVersion = atoi(value.c_str());
-
-    if (Str::caseCompare(name, "graphicsVersion") == 0)
-        Project.version.graphicsVersion = atoi(value.c_str());
-
-    if (Str::caseCompare(name, "fileVersion") == 0)
-        Project.version.fileVersion = atoi(value.c_str());
-
-    if (Str::caseCompare(name, "designVersion") == 0)
-        Project.version.designVersion = atoi(value.c_str());
+	switch (tag)
+	{
+		case "formatVersion"_tag:	Project.version.formatVersion = atoi(value.c_str()); break;
+		case "graphicsVersion"_tag:	Project.version.graphicsVersion = atoi(value.c_str()); break;
+		case "fileVersion"_tag:		Project.version.fileVersion = atoi(value.c_str()); break;
+		case "designVersion"_tag:	Project.version.designVersion = atoi(value.c_str()); break;
+	}
 }
 
-void Panel::setProjectInfo(const string& name, const string& value, const string& attr)
+void Panel::setProjectInfo(XMLTAG tag, const string& value, const string& attr)
 {
-	DECL_TRACER("Panel::setProjectInfo(const string& name, const string& value, const string& attr)");
-
-    if (Str::caseCompare(name, "protection") == 0)
-        Project.projectInfo.protection = value;
-
-    if (Str::caseCompare(name, "password") == 0)
-    {
-        if (attr.compare("1") == 0)
-            Project.projectInfo.encrypted = true;
-        else
-            Project.projectInfo.encrypted = false;
-
-        Project.projectInfo.password = value;
-    }
+	DECL_TRACER("Panel::setProjectInfo(XMLTAG tag, const string& value, const string& attr)");
 
-    if (Str::caseCompare(name, "panelType") == 0)
-        Project.projectInfo.panelType = value;
-
-    if (Str::caseCompare(name, "fileRevision") == 0)
-        Project.projectInfo.fileRevision = value;
-
-    if (Str::caseCompare(name, "dealerId") == 0)
-        Project.projectInfo.dealerID = value;
-
-    if (Str::caseCompare(name, "jobName") == 0)
-        Project.projectInfo.jobName = value;
-
-    if (Str::caseCompare(name, "salesOrder") == 0)
-        Project.projectInfo.salesOrder = value;
-
-    if (Str::caseCompare(name, "purchaseOrder") == 0)
-        Project.projectInfo.purchaseOrder = value;
-
-    if (Str::caseCompare(name, "jobComment") == 0)
-        Project.projectInfo.jobComment = value;
-
-    if (Str::caseCompare(name, "designerId") == 0)
-        Project.projectInfo.designerID = value;
-
-    if (Str::caseCompare(name, "creationDate") == 0)
-        Project.projectInfo.creationDate = getDate(value, Project.projectInfo.creationDate);
-
-    if (Str::caseCompare(name, "revisionDate") == 0)
-        Project.projectInfo.revisionDate = getDate(value, Project.projectInfo.revisionDate);
-
-    if (Str::caseCompare(name, "lastSaveDate") == 0)
-        Project.projectInfo.lastSaveDate = getDate(value, Project.projectInfo.lastSaveDate);
-
-    if (Str::caseCompare(name, "fileName") == 0)
-        Project.projectInfo.fileName = value;
+	switch (tag)
+	{
+		case "protection"_tag:		Project.projectInfo.protection = value; break;
+
+		case "password"_tag:
+			Project.projectInfo.encrypted = (attr.compare("1") == 0);
+			Project.projectInfo.password = value;
+		break;
+
+		case "panelType"_tag:		Project.projectInfo.panelType = value; break;
+		case "fileRevision"_tag:	Project.projectInfo.fileRevision = value; break;
+		case "dealerId"_tag:		Project.projectInfo.dealerID = value; break;
+		case "jobName"_tag:			Project.projectInfo.jobName = value; break;
+		case "salesOrder"_tag:		Project.projectInfo.salesOrder = value; break;
+		case "purchaseOrder"_tag:	Project.projectInfo.purchaseOrder = value; break;
+		case "jobComment"_tag:		Project.projectInfo.jobComment = value; break;
+		case "designerId"_tag:		Project.projectInfo.designerID = value; break;
+		case "creationDate"_tag:	Project.projectInfo.creationDate = getDate(value, Project.projectInfo.creationDate); break;
+		case "revisionDate"_tag:	Project.projectInfo.revisionDate = getDate(value, Project.projectInfo.revisionDate); break;
+		case "lastSaveDate"_tag:	Project.projectInfo.lastSaveDate = getDate(value, Project.projectInfo.lastSaveDate); break;
+		case "fileName"_tag:		Project.projectInfo.fileName = value; break;
+		case "colorChoice"_tag:		Project.projectInfo.colorChoice = value; break;
+		case "specifyPortCount"_tag:	Project.projectInfo.specifyPortCount = atoi(value.c_str()); break;
+		case "specifyChanCount"_tag:	Project.projectInfo.specifyChanCount = atoi(value.c_str()); break;
+	}
+}
 
-    if (Str::caseCompare(name, "colorChoice") == 0)
-        Project.projectInfo.colorChoice = value;
+void Panel::setSupportFileList(XMLTAG tag, const string& value)
+{
+	DECL_TRACER("Panel::setSupportFileList(XMLTAG tag, const string& value)");
 
-    if (Str::caseCompare(name, "specifyPortCount") == 0)
-        Project.projectInfo.specifyPortCount = atoi(value.c_str());
+	if (value.empty())
+		return;
 
-    if (Str::caseCompare(name, "specifyChanCount") == 0)
-        Project.projectInfo.specifyChanCount = atoi(value.c_str());
+	switch (tag)
+	{
+		case "mapFile"_tag:				Project.supportFileList.mapFile = value; break;
+		case "colorFile"_tag:			Project.supportFileList.colorFile = value; break;
+		case "fontFile"_tag:			Project.supportFileList.fontFile = value; break;
+		case "themeFile"_tag:			Project.supportFileList.themeFile = value; break;
+		case "iconFile"_tag:			Project.supportFileList.iconFile = value; break;
+		case "externalButtonFile"_tag:	Project.supportFileList.externalButtonFile = value; break;
+	}
 }
 
-void Panel::setSupportFileList(const string& name, const string& value)
+void Panel::setPanelSetup(XMLTAG tag, const string& value)
 {
-	DECL_TRACER("Panel::setSupportFileList(const string& name, const string& value)");
-
-    if (Str::caseCompare(name, "mapFile") == 0 && !value.empty())
-        Project.supportFileList.mapFile = value;
-	else if (Str::caseCompare(name, "colorFile") == 0 && !value.empty())
-        Project.supportFileList.colorFile = value;
-	else if (Str::caseCompare(name, "fontFile") == 0 && !value.empty())
-        Project.supportFileList.fontFile = value;
-	else if (Str::caseCompare(name, "themeFile") == 0 && !value.empty())
-        Project.supportFileList.themeFile = value;
-	else if (Str::caseCompare(name, "iconFile") == 0 && !value.empty())
-        Project.supportFileList.iconFile = value;
-	else if (Str::caseCompare(name, "externalButtonFile") == 0 && !value.empty())
-        Project.supportFileList.externalButtonFile = value;
-}
+	DECL_TRACER("Panel::setPanelSetup(XMLTAG tag, const string& value)");
 
-void Panel::setPanelSetup(const string& name, const string& value)
-{
-	DECL_TRACER("Panel::setPanelSetup(const string& name, const string& value)");
-
-    if (Str::caseCompare(name, "portCount") == 0)
-        Project.panelSetup.portCount = atoi(value.c_str());
-    else if (Str::caseCompare(name, "setupPort") == 0)
-        Project.panelSetup.setupPort = atoi(value.c_str());
-    else if (Str::caseCompare(name, "addressCount") == 0)
-        Project.panelSetup.addressCount = atoi(value.c_str());
-    else if (Str::caseCompare(name, "channelCount") == 0)
-        Project.panelSetup.channelCount = atoi(value.c_str());
-    else if (Str::caseCompare(name, "levelCount") == 0)
-        Project.panelSetup.levelCount = atoi(value.c_str());
-    else if (Str::caseCompare(name, "powerUpPage") == 0)
-        Project.panelSetup.powerUpPage = value;
-    else if (Str::caseCompare(name, "powerUpPopup") == 0)
-        Project.panelSetup.powerUpPopup.push_back(value);
-    else if (Str::caseCompare(name, "feedbackBlinkRate") == 0)
-        Project.panelSetup.feedbackBlinkRate = atoi(value.c_str());
-    else if (Str::caseCompare(name, "startupString") == 0)
-        Project.panelSetup.startupString = value;
-    else if (Str::caseCompare(name, "wakeupString") == 0)
-        Project.panelSetup.wakeupString = value;
-    else if (Str::caseCompare(name, "sleepString") == 0)
-        Project.panelSetup.sleepString = value;
-    else if (Str::caseCompare(name, "standbyString") == 0)
-        Project.panelSetup.standbyString = value;
-    else if (Str::caseCompare(name, "shutdownString") == 0)
-        Project.panelSetup.shutdownString = value;
-    else if (Str::caseCompare(name, "idlePage") == 0)
-        Project.panelSetup.idlePage = value;
-    else if (Str::caseCompare(name, "idleTimeout") == 0)
-        Project.panelSetup.idleTimeout = atoi(value.c_str());
-    else if (Str::caseCompare(name, "extButtonsKey") == 0)
-        Project.panelSetup.extButtonsKey = atoi(value.c_str());
-    else if (Str::caseCompare(name, "screenWidth") == 0)
-        Project.panelSetup.screenWidth = atoi(value.c_str());
-    else if (Str::caseCompare(name, "screenHeight") == 0)
-        Project.panelSetup.screenHeight = atoi(value.c_str());
-    else if (Str::caseCompare(name, "screenRefresh") == 0)
-        Project.panelSetup.screenRefresh = atoi(value.c_str());
-    else if (Str::caseCompare(name, "screenRotate") == 0)
-        Project.panelSetup.screenRotate = atoi(value.c_str());
-    else if (Str::caseCompare(name, "screenDescription") == 0)
-        Project.panelSetup.screenDescription = value;
-    else if (Str::caseCompare(name, "pageTracking") == 0)
-        Project.panelSetup.pageTracking = atoi(value.c_str());
-    else if (Str::caseCompare(name, "brightness") == 0)
-        Project.panelSetup.brightness = atoi(value.c_str());
-    else if (Str::caseCompare(name, "lightSensorLevelPort") == 0)
-        Project.panelSetup.lightSensorLevelPort = atoi(value.c_str());
-    else if (Str::caseCompare(name, "lightSensorLevelCode") == 0)
-        Project.panelSetup.lightSensorLevelCode = atoi(value.c_str());
-    else if (Str::caseCompare(name, "lightSensorChannelPort") == 0)
-        Project.panelSetup.lightSensorChannelPort = atoi(value.c_str());
-    else if (Str::caseCompare(name, "lightSensorChannelCode") == 0)
-        Project.panelSetup.lightSensorChannelCode = atoi(value.c_str());
-    else if (Str::caseCompare(name, "motionSensorChannelPort") == 0)
-        Project.panelSetup.motionSensorChannelPort = atoi(value.c_str());
-    else if (Str::caseCompare(name, "motionSensorChannelCode") == 0)
-        Project.panelSetup.motionSensorChannelCode = atoi(value.c_str());
-    else if (Str::caseCompare(name, "batteryLevelPort") == 0)
-        Project.panelSetup.batteryLevelPort = atoi(value.c_str());
-    else if (Str::caseCompare(name, "batteryLevelCode") == 0)
-        Project.panelSetup.batteryLevelCode = atoi(value.c_str());
-    else if (Str::caseCompare(name, "irPortAMX38Emit") == 0)
-        Project.panelSetup.irPortAMX38Emit = atoi(value.c_str());
-    else if (Str::caseCompare(name, "irPortAMX455Emit") == 0)
-        Project.panelSetup.irPortAMX455Emit = atoi(value.c_str());
-    else if (Str::caseCompare(name, "irPortAMX38Recv") == 0)
-        Project.panelSetup.irPortAMX38Recv = atoi(value.c_str());
-    else if (Str::caseCompare(name, "irPortAMX455Recv") == 0)
-        Project.panelSetup.irPortAMX455Recv = atoi(value.c_str());
-    else if (Str::caseCompare(name, "irPortUser1") == 0)
-        Project.panelSetup.irPortUser1 = atoi(value.c_str());
-    else if (Str::caseCompare(name, "irPortUser2") == 0)
-        Project.panelSetup.irPortUser2 = atoi(value.c_str());
-    else if (Str::caseCompare(name, "cradleChannelPort") == 0)
-        Project.panelSetup.cradleChannelPort = atoi(value.c_str());
-    else if (Str::caseCompare(name, "cradleChannelCode") == 0)
-        Project.panelSetup.cradleChannelCode = atoi(value.c_str());
-    else if (Str::caseCompare(name, "uniqueID") == 0)
-        Project.panelSetup.uniqueID = value;
-    else if (Str::caseCompare(name, "appCreated") == 0)
-        Project.panelSetup.appCreated = value;
-    else if (Str::caseCompare(name, "buildNumber") == 0)
-        Project.panelSetup.buildNumber = atoi(value.c_str());
-    else if (Str::caseCompare(name, "appModified") == 0)
-        Project.panelSetup.appModified = value;
-    else if (Str::caseCompare(name, "buildNumberMod") == 0)
-        Project.panelSetup.buildNumberMod = atoi(value.c_str());
-    else if (Str::caseCompare(name, "buildStatusMod") == 0)
-        Project.panelSetup.buildStatusMod = value;
-    else if (Str::caseCompare(name, "activePalette") == 0)
-        Project.panelSetup.activePalette = atoi(value.c_str());
-    else if (Str::caseCompare(name, "marqueeSpeed") == 0)
-        Project.panelSetup.marqueeSpeed = atoi(value.c_str());
-    else if (Str::caseCompare(name, "setupPagesProject") == 0)
-        Project.panelSetup.setupPagesProject = atoi(value.c_str());
-    else if (Str::caseCompare(name, "voipCommandPort") == 0)
-        Project.panelSetup.voipCommandPort = atoi(value.c_str());
+	switch (tag)
+	{
+		case "portCount"_tag:			Project.panelSetup.portCount = atoi(value.c_str()); break;
+		case "setupPort"_tag:			Project.panelSetup.setupPort = atoi(value.c_str()); break;
+		case "addressCount"_tag:		Project.panelSetup.addressCount = atoi(value.c_str()); break;
+		case "channelCount"_tag:		Project.panelSetup.channelCount = atoi(value.c_str()); break;
+		case "levelCount"_tag:		Project.panelSetup.levelCount = atoi(value.c_str()); break;
+		case "powerUpPage"_tag:		Project.panelSetup.powerUpPage = value; break;
+		case "powerUpPopup"_tag:		Project.panelSetup.powerUpPopup.push_back(value); break;
+		case "feedbackBlinkRate"_tag:	Project.panelSetup.feedbackBlinkRate = atoi(value.c_str()); break;
+		case "startupString"_tag:		Project.panelSetup.startupString = value; break;
+		case "wakeupString"_tag:		Project.panelSetup.wakeupString = value; break;
+		case "sleepString"_tag:		Project.panelSetup.sleepString = value; break;
+		case "standbyString"_tag:		Project.panelSetup.standbyString = value; break;
+		case "shutdownString"_tag:	Project.panelSetup.shutdownString = value; break;
+		case "idlePage"_tag:			Project.panelSetup.idlePage = value; break;
+		case "idleTimeout"_tag:		Project.panelSetup.idleTimeout = atoi(value.c_str()); break;
+		case "extButtonsKey"_tag:		Project.panelSetup.extButtonsKey = atoi(value.c_str()); break;
+		case "screenWidth"_tag:		Project.panelSetup.screenWidth = atoi(value.c_str()); break;
+		case "screenHeight"_tag:		Project.panelSetup.screenHeight = atoi(value.c_str()); break;
+		case "screenRefresh"_tag:		Project.panelSetup.screenRefresh = atoi(value.c_str()); break;
+		case "screenRotate"_tag:		Project.panelSetup.screenRotate = atoi(value.c_str()); break;
+		case "screenDescription"_tag:	Project.panelSetup.screenDescription = value; break;
+		case "pageTracking"_tag:		Project.panelSetup.pageTracking = atoi(value.c_str()); break;
+		case "brightness"_tag:		Project.panelSetup.brightness = atoi(value.c_str()); break;
+		case "lightSensorLevelPort"_tag:	Project.panelSetup.lightSensorLevelPort = atoi(value.c_str()); break;
+		case "lightSensorLevelCode"_tag:	Project.panelSetup.lightSensorLevelCode = atoi(value.c_str()); break;
+		case "lightSensorChannelPort"_tag:	Project.panelSetup.lightSensorChannelPort = atoi(value.c_str()); break;
+		case "lightSensorChannelCode"_tag:	Project.panelSetup.lightSensorChannelCode = atoi(value.c_str()); break;
+		case "motionSensorChannelPort"_tag:	Project.panelSetup.motionSensorChannelPort = atoi(value.c_str()); break;
+		case "motionSensorChannelCode"_tag:	Project.panelSetup.motionSensorChannelCode = atoi(value.c_str()); break;
+		case "batteryLevelPort"_tag:	Project.panelSetup.batteryLevelPort = atoi(value.c_str()); break;
+		case "batteryLevelCode"_tag:	Project.panelSetup.batteryLevelCode = atoi(value.c_str()); break;
+		case "irPortAMX38Emit"_tag:	Project.panelSetup.irPortAMX38Emit = atoi(value.c_str()); break;
+		case "irPortAMX455Emit"_tag:	Project.panelSetup.irPortAMX455Emit = atoi(value.c_str()); break;
+		case "irPortAMX38Recv"_tag:	Project.panelSetup.irPortAMX38Recv = atoi(value.c_str()); break;
+		case "irPortAMX455Recv"_tag:	Project.panelSetup.irPortAMX455Recv = atoi(value.c_str()); break;
+		case "irPortUser1"_tag:		Project.panelSetup.irPortUser1 = atoi(value.c_str()); break;
+		case "irPortUser2"_tag:		Project.panelSetup.irPortUser2 = atoi(value.c_str()); break;
+		case "cradleChannelPort"_tag:	Project.panelSetup.cradleChannelPort = atoi(value.c_str()); break;
+		case "cradleChannelCode"_tag:	Project.panelSetup.cradleChannelCode = atoi(value.c_str()); break;
+		case "uniqueID"_tag:			Project.panelSetup.uniqueID = value; break;
+		case "appCreated"_tag:		Project.panelSetup.appCreated = value; break;
+		case "buildNumber"_tag:		Project.panelSetup.buildNumber = atoi(value.c_str()); break;
+		case "appModified"_tag:		Project.panelSetup.appModified = value; break;
+		case "buildNumberMod"_tag:	Project.panelSetup.buildNumberMod = atoi(value.c_str()); break;
+		case "buildStatusMod"_tag:	Project.panelSetup.buildStatusMod = value; break;
+		case "activePalette"_tag:		Project.panelSetup.activePalette = atoi(value.c_str()); break;
+		case "marqueeSpeed"_tag:		Project.panelSetup.marqueeSpeed = atoi(value.c_str()); break;
+		case "setupPagesProject"_tag:	Project.panelSetup.setupPagesProject = atoi(value.c_str()); break;
+		case "voipCommandPort"_tag:	Project.panelSetup.voipCommandPort = atoi(value.c_str()); break;
+	}
 }
 
-void Panel::setPageList(const string& name, const string& value)
+void Panel::setPageList(XMLTAG tag, const string& value)
 {
-	DECL_TRACER("Panel::setPageList(const string& name, const string& value)");
+	DECL_TRACER("Panel::setPageList(XMLTAG tag, const string& value)");
 
-	if (Project.pageLists.size() == 0)
+	if (Project.pageLists.size() == 0 || value.empty())
 		return;
 
 	PAGE_LIST_T& pl = Project.pageLists.back();
@@ -576,23 +507,20 @@ void Panel::setPageList(const string& name, const string& value)
 
 	PAGE_ENTRY_T& pe = pl.pageList.back();
 
-	if (Str::caseCompare(name, "name") == 0 && !value.empty())
-		pe.name = value;
-	else if (Str::caseCompare(name, "pageID") == 0 && !value.empty())
-		pe.pageID = atoi(value.c_str());
-	else if (Str::caseCompare(name, "file") == 0 && !value.empty())
-		pe.file = value;
-	else if (Str::caseCompare(name, "isValid") == 0 && !value.empty())
-		pe.isValid = atoi(value.c_str());
-	else if (Str::caseCompare(name, "group") == 0 && !value.empty())
-		pe.group = value;
-	else if (Str::caseCompare(name, "popupType") == 0 && !value.empty())
-		pe.popupType = atoi(value.c_str());
+	switch (tag)
+	{
+		case "name"_tag:		pe.name = value; break;
+		case "pageID"_tag:		pe.pageID = atoi(value.c_str()); break;
+		case "file"_tag:		pe.file = value; break;
+		case "isValid"_tag:		pe.isValid = atoi(value.c_str()); break;
+		case "group"_tag:		pe.group = value; break;
+		case "popupType"_tag:	pe.popupType = atoi(value.c_str()); break;
+	}
 }
 
-void Panel::setResourceList(const string& name, const string& value, const string& attr)
+void Panel::setResourceList(XMLTAG tag, const string& value, const string& attr)
 {
-	DECL_TRACER("Panel::setResourceList(const string& name, const string& value, const string& attr)");
+	DECL_TRACER("Panel::setResourceList(XMLTAG tag, const string& value, const string& attr)");
 
 	if (Project.resourceLists.size() == 0)
 		return;
@@ -604,7 +532,7 @@ void Panel::setResourceList(const string& name, const string& value, const strin
 
 	bool hasValue = false, hasAttr = false;
 	RESOURCE_T& rs = rl.ressource.back();
-	sysl->TRACE("Panel::setResourceList: name="+name+", value="+value+", attr="+attr);
+	TRACER("Panel::setResourceList: value="+value+", attr="+attr);
 
 	if (value.length() > 0)
 		hasValue = true;
@@ -612,60 +540,63 @@ void Panel::setResourceList(const string& name, const string& value, const strin
 	if (attr.length() > 0)
 		hasAttr = true;
 
-	if (Str::caseCompare(name, "name") == 0 && hasValue)
-		rs.name = value;
-	else if (Str::caseCompare(name, "protocol") == 0 && hasValue)
-		rs.protocol = value;
-	else if (Str::caseCompare(name, "user") == 0 && hasValue)
-		rs.user = value;
-	else if (Str::caseCompare(name, "password") == 0)
+	if (tag == "password"_tag)
 	{
 		if (hasValue)
 			rs.password = value;
 
 		if (hasAttr && Str::isNumeric(attr))
 			rs.encrypted = atoi(attr.c_str());
+
+		return;
+	}
+
+	if (!hasValue)
+		return;
+
+	switch (tag)
+	{
+		case "name"_tag:		rs.name = value; break;
+		case "protocol"_tag:	rs.protocol = value; break;
+		case "user"_tag:		rs.user = value; break;
+		case "host"_tag:		rs.host = value; break;
+		case "path"_tag:		rs.path = value; break;
+		case "file"_tag:		rs.file = value; break;
+		case "refresh"_tag:		rs.refresh = atoi(value.c_str()); break;
 	}
-	else if (Str::caseCompare(name, "host") == 0 && hasValue)
-		rs.host = value;
-	else if (Str::caseCompare(name, "path") == 0 && hasValue)
-		rs.path = value;
-	else if (Str::caseCompare(name, "file") == 0 && hasValue)
-		rs.file = value;
-	else if (Str::caseCompare(name, "refresh") == 0 && hasValue)
-		rs.refresh = atoi(value.c_str());
 }
 
-void Panel::setFwFeatureList(const string& name, const string& value)
+void Panel::setFwFeatureList(XMLTAG tag, const string& value)
 {
-	DECL_TRACER("Panel::setFwFeatureList(const string& name, const string& value)");
+	DECL_TRACER("Panel::setFwFeatureList(XMLTAG tag, const string& value)");
 
 	if (Project.fwFeatureList.size() == 0)
 		return;
 
 	FEATURE_T& fw = Project.fwFeatureList.back();
 
-	if (Str::caseCompare(name, "featureID") == 0)
-		fw.featureID = value;
-	else if (Str::caseCompare(name, "usageCount") == 0)
-		fw.usageCount = atoi(value.c_str());
+	switch (tag)
+	{
+		case "featureID"_tag:	fw.featureID = value; break;
+		case "usageCount"_tag:	fw.usageCount = atoi(value.c_str()); break;
+	}
 }
 
-void Panel::setPaletteList(const string& name, const string& value)
+void Panel::setPaletteList(XMLTAG tag, const string& value)
 {
-	DECL_TRACER("Panel::setPaletteList(const string& name, const string& value)");
+	DECL_TRACER("Panel::setPaletteList(XMLTAG tag, const string& value)");
 
 	if (Project.paletteList.size() == 0)
 		return;
 
-    PALETTE_T& pa = Project.paletteList.back();
+	PALETTE_T& pa = Project.paletteList.back();
 
-    if (Str::caseCompare(name, "name") == 0)
-        pa.name = value;
-    else if (Str::caseCompare(name, "file") == 0)
-        pa.file = value;
-    else if (Str::caseCompare(name, "paletteID") == 0)
-        pa.paletteID = atoi(value.c_str());
+	switch (tag)
+	{
+		case "name"_tag:		pa.name = value; break;
+		case "file"_tag:		pa.file = value; break;
+		case "paletteID"_tag:	pa.paletteID = atoi(value.c_str()); break;
+	}
 }
 
 /*
@@ -721,6 +652,6 @@ DateTime& Panel::getDate(const string& dat, DateTime& dt)
 	year = atoi(teile[4].c_str());
 
 	dt.setTimestamp(year, month, day, hour, min, sec);
-	sysl->TRACE("Panel::getDate: "+dt.toString());
+	TRACER("Panel::getDate: "+dt.toString());
 	return dt;
 }
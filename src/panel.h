@@ -23,6 +23,7 @@
 #include "palette.h"
 #include "icon.h"
 #include "fontlist.h"
+#include "xmltags.h"
 
 namespace amx
 {
@@ -53,14 +54,14 @@ namespace amx
 			Icon *getIconClass() { return pIcons; }
 
 		private:
-			void setVersionInfo(const std::string& name, const std::string& value);
-			void setProjectInfo(const std::string& name, const std::string& value, const std::string& attr);
-			void setSupportFileList(const std::string& name, const std::string& value);
-			void setPanelSetup(const std::string& name, const std::string& value);
-			void setPageList(const std::string& name, const std::string& value);
-			void setResourceList(const std::string& name, const std::string& value, const std::string& attr);
-			void setFwFeatureList(const std::string& name, const std::string& value);
-			void setPaletteList(const std::string& name, const std::string& value);
+			void setVersionInfo(XMLTAG tag, const std::string& value);
+			void setProjectInfo(XMLTAG tag, const std::string& value, const std::string& attr);
+			void setSupportFileList(XMLTAG tag, const std::string& value);
+			void setPanelSetup(XMLTAG tag, const std::string& value);
+			void setPageList(XMLTAG tag, const std::string& value);
+			void setResourceList(XMLTAG tag, const std::string& value, const std::string& attr);
+			void setFwFeatureList(XMLTAG tag, const std::string& value);
+			void setPaletteList(XMLTAG tag, const std::string& value);
 			DateTime& getDate(const std::string& dat, DateTime& dt);
 	};
 }
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __PROBES_H__
+#define __PROBES_H__
+
+/*
+ * Static trace points (USDT) of the provider "amxpanel".
+ *
+ * They are compiled in with the CMake option USDT (cmake -DUSDT=ON ...)
+ * and need the header <sys/sdt.h> (package systemtap-sdt-dev). A probe
+ * which is not attached costs a single NOP. The probes can be listed with
+ *
+ *     bpftrace -l 'usdt:/usr/sbin/amxpanel:*'
+ *
+ * and used with bpftrace or perf, e.g.
+ *
+ *     bpftrace -e 'usdt:/usr/sbin/amxpanel:amxpanel:frame_receive { @[arg1] = count(); }'
+ *
+ * Probes and arguments:
+ *
+ *     frame_receive(panel, mc, length)		ICSP frame read from the controller
+ *     frame_send(panel, mc, length)		ICSP frame written to the controller
+ *     dispatch_controller(panel, mc)		Command from the controller dispatched in TouchPanel::setCommand
+ *     dispatch_browser(pan, message)		Message from the browser dispatched in TouchPanel::webMsg
+ *     ws_send(pan, length, message)		Message written to a browser in WebSocket::send
+ *     ws_receive(pan, length, message)		Message received from a browser in WebSocket::on_message
+ *     page_start(file)						Start of generating a page or popup
+ *     page_end(file, id)					End of generating a page (id = -1 on error)
+ *
+ * Without the option all probes compile to nothing.
+ */
+#ifdef _USDT
+#include <sys/sdt.h>
+
+#define AMX_PROBE1(name, a)				DTRACE_PROBE1(amxpanel, name, a)
+#define AMX_PROBE2(name, a, b)			DTRACE_PROBE2(amxpanel, name, a, b)
+#define AMX_PROBE3(name, a, b, c)		DTRACE_PROBE3(amxpanel, name, a, b, c)
+#else
+#define AMX_PROBE1(name, a)				do {} while (0)
+#define AMX_PROBE2(name, a, b)			do {} while (0)
+#define AMX_PROBE3(name, a, b, c)		do {} while (0)
+#endif
+
+#endif
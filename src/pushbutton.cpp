@@ -31,22 +31,22 @@ using namespace amx;
 using namespace std;
 
 PushButton::PushButton(const BUTTON_T& bt, const std::vector<PDATA_T>& pal)
-		: button(bt),
-		  palette(pal)
-
+		: button(bt)
 {
-	sysl->TRACE(Syslog::ENTRY, "PushButton::PushButton(const BUTTON_T& bt, const std::vector<PDATA_T>& pal)");
-	sysl->TRACE("PushButton::PushButton: Button: "+bt.na+", ID: "+to_string(bt.bi));
+	TRACER(Syslog::ENTRY, "PushButton::PushButton(const BUTTON_T& bt, const std::vector<PDATA_T>& pal)");
+	TRACER("PushButton::PushButton: Button: "+bt.na+", ID: "+to_string(bt.bi));
 
 	if (button.ap == 0 && isSystemReserved(button.ad))
 		btName = getButtonName(button.ad);
 	else
 		btName = "Button_"+to_string(bt.bi);
+
+	colors.setPalette(pal);
 }
 
 PushButton::~PushButton()
 {
-	sysl->TRACE(Syslog::EXIT, "PushButton::~PushButton()");
+	TRACER(Syslog::EXIT, "PushButton::~PushButton()");
 }
 
 /*
@@ -59,7 +59,7 @@ string PushButton::getWebCode()
 	DECL_TRACER("PushButton::getWebCode()");
 	string code;	// This is a relict!
 
-	sysl->TRACE("PushButton::getWebCode: for page ID: "+to_string(pageID));
+	TRACER("PushButton::getWebCode: for page ID: "+to_string(pageID));
 
 	if (button.type == BARGRAPH)
 	{
@@ -118,279 +118,212 @@ string PushButton::getWebCode()
 	return code;
 }
 
-string PushButton::getScriptCode()
+/*
+ * Returns the CSS class(es) for the frame of the button. This is the
+ * geometry of the button, which is mostly unique. The skin of the states is
+ * in the classes returned by getStateStyle() and getTextStyle().
+ */
+string PushButton::getStyle(StyleSheet *sheet)
 {
-	DECL_TRACER("PushButton::getScriptCode()");
+	DECL_TRACER("PushButton::getStyle(StyleSheet *sheet)");
 
-	if (button.ap != 0)
+	if (!sheet)
 		return "";
 
-	string code;
+	CSS_DECL_T box;
+	box.push_back("position: absolute");
+	box.push_back("left: "+to_string(button.lt)+"px");
+	box.push_back("top: "+to_string(button.tp)+"px");
+	box.push_back("width: "+to_string(button.wt)+"px");
+	box.push_back("height: "+to_string(button.ht)+"px");
+	string cls = sheet->intern(box);
 
-	// This is for displaying the time
-	if (button.ad == 141)		// System time standard
+	if (button.hs.compare("bounding") == 0)
 	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar h = today.getHours();\n";
-		code += "\tvar m = today.getMinutes();\n";
-		code += "\tvar s = today.getSeconds();\n";
-		code += "\th = checkTime(h);\n";
-		code += "\tm = checkTime(m);\n";
-		code += "\ts = checkTime(s);\n";
-
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = h + \":\" + m + \":\" + s;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 500);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_TIME_STANDARD;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
+		CSS_DECL_T bound;
+		bound.push_back("overflow: hidden");
+		cls += " "+sheet->intern(bound);
 	}
 
-	if (button.ad == 142)		// System time AM/PM
-	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar h = today.getHours();\n";
-		code += "\tvar m = today.getMinutes();\n";
-		code += "\tvar s = \"AM\"\n";
-		code += "\tif (h > 12) {\n";
-		code += "\t\th = h - 12;\n";
-		code += "\t\ts = \"PM\";\n\t}\n";
-		code += "\th = checkTime(h);\n";
-		code += "\tm = checkTime(m);\n";
+	return cls;
+}
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = h + \":\" + m + \" \" + s;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 500);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_TIME_AMPM;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
-	}
+/*
+ * Returns the CSS class with the skin of the state \a idx: text and fill
+ * color, border and opacity. Buttons using the same skin share the class.
+ * The geometry and the images stay with the element in page.js.
+ */
+string PushButton::getStateStyle(StyleSheet *sheet, size_t idx)
+{
+	DECL_TRACER("PushButton::getStateStyle(StyleSheet *sheet, size_t idx)");
 
-	if (button.ad == 143)		// System time 24 hour
-	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar h = today.getHours();\n";
-		code += "\tvar m = today.getMinutes();\n";
-		code += "\th = checkTime(h);\n";
-		code += "\tm = checkTime(m);\n";
+	if (!sheet || idx >= button.sr.size())
+		return "";
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = h + \":\" + m;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 500);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_TIME_24;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
-	}
+	SR_T& sr = button.sr[idx];
+	CSS_DECL_T skin;
+	char opacity[32];
 
-	// This is for displaying the date
-	if (button.ad == 151)		// System date: weekday
-	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tswitch(today.getDay()) {\n";
-		code += "\t\tcase 0: return 'Sunday'; break;\n";
-		code += "\t\tcase 1: return 'Monday'; break;\n";
-		code += "\t\tcase 2: return 'Thuesday'; break;\n";
-		code += "\t\tcase 3: return 'Wednesday'; break;\n";
-		code += "\t\tcase 4: return 'Thursday'; break;\n";
-		code += "\t\tcase 5: return 'Friday'; break;\n";
-		code += "\t\tcase 6: return 'Saturday'; break;\n";
-		code += "\t}\n";
+	snprintf(opacity, sizeof(opacity), "%1.3f", 1.0 / 255.0 * (double)sr.oo);
+	skin.push_back(string("opacity: ")+opacity);
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = mon + '/' + day;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 1000);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_DATE_WEEKDAY;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
-	}
+	if (!sr.ct.empty())
+		skin.push_back("color: "+webColor(sr.ct));
 
-	if (button.ad == 152)		// System date: mm/dd
-	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar mon = today.getMonth() + 1;\n";
-		code += "\tvar day = today.getDate();\n";
-		code += "\tmon = checkTime(mon);\n";
-		code += "\tday = checkTime(day);\n";
+	// A chameleon image is drawn on a canvas and brings its own fill color.
+	if ((sr.mi.empty() || !sr.bs.empty()) && !sr.cf.empty())
+		skin.push_back("background-color: "+webColor(sr.cf));
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = mon + '/' + day;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 1000);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_DATE_M_D;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
+	if (!sr.bs.empty() && getBorderDecl(sr.bs, skin))
+	{
+		if (!sr.cb.empty())
+			skin.push_back("border-color: "+webColor(sr.cb));
 	}
+	else
+		skin.push_back("border: none");
 
-	if (button.ad == 153)		// System date: dd/mm
-	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar mon = today.getMonth() + 1;\n";
-		code += "\tvar day = today.getDate();\n";
-		code += "\tmon = checkTime(mon);\n";
-		code += "\tday = checkTime(day);\n";
+	return sheet->intern(skin);
+}
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = day + '/' + mon;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 1000);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_DATE_D_M;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
-	}
+/*
+ * Returns the CSS class for the text of the state \a idx: the font and the
+ * text effect. An empty string means that the font is unknown. In this case
+ * the state has no text.
+ */
+string PushButton::getTextStyle(StyleSheet *sheet, size_t idx)
+{
+	DECL_TRACER("PushButton::getTextStyle(StyleSheet *sheet, size_t idx)");
 
-	if (button.ad == 154)		// System date: mm/dd/yyyy
-	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar mon = today.getMonth() + 1;\n";
-		code += "\tvar day = today.getDate();\n";
-		code += "\tvar year = today.getFullYear();\n";
-		code += "\tmon = checkTime(mon);\n";
-		code += "\tday = checkTime(day);\n";
+	if (!sheet || !fontClass || idx >= button.sr.size())
+		return "";
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = mon + '/' + day + '/' + year;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 1000);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_DATE_M_D_Y;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
+	SR_T& sr = button.sr[idx];
+	FONT_T& font = fontClass->findFont(sr.fi);
+
+	if (font.name.empty())
+		return "";
+
+	CSS_DECL_T text;
+	text.push_back("position: absolute");
+	text.push_back("padding-left: 4px");
+	text.push_back("padding-right: 4px");
+	// Clipping
+	text.push_back("overflow: hidden");
+	text.push_back("text-overflow: clip");
+	// Prevent text from being selected.
+	text.push_back("-webkit-touch-callout: none");
+	text.push_back("-webkit-user-select: none");
+	text.push_back("-khtml-user-select: none");
+	text.push_back("-moz-user-select: none");
+	text.push_back("user-select: none");
+	// A text receives no pointer events
+	text.push_back("pointer-events: none");
+	text.push_back("font-family: \""+font.name+"\"");
+	text.push_back("font-size: "+to_string(font.size)+"pt");
+	text.push_back("font-style: "+fontClass->getFontStyle(font.subfamilyName));
+	text.push_back("font-weight: "+fontClass->getFontWeight(font.subfamilyName));
+
+	if (sr.ww != 0)		// line break
+	{
+		text.push_back("word-wrap: break-word");
+		text.push_back("word-break: break-all");
+	}
+	else
+	{
+		text.push_back("word-wrap: normal");
+		text.push_back("word-break: keep-all");
 	}
 
-	if (button.ad == 155)		// System date: dd/mm/yyyy
+	if (sr.et > 0 && !sr.ec.empty())
 	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar mon = today.getMonth() + 1;\n";
-		code += "\tvar day = today.getDate();\n";
-		code += "\tvar year = today.getFullYear();\n";
-		code += "\tmon = checkTime(mon);\n";
-		code += "\tday = checkTime(day);\n";
+		string tef = textEffect(sr.et, webColor(sr.ec));
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = day + '/' + mon + '/' + year;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 1000);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_DATE_D_M_Y;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
+		if (!tef.empty())
+			text.push_back("text-shadow: "+tef);
 	}
 
-	if (button.ad == 156)		// System date: month dd, yyyy
+	return sheet->intern(text);
+}
+
+string PushButton::webColor(const string& col)
+{
+	return colors.colorToString(colors.getColor(col));
+}
+
+/*
+ * Converts the text effect \a et into the value of "text-shadow". The
+ * numbers are the same as used by cbTEF() in amxpanel.js.
+ */
+string PushButton::textEffect(int et, const string& col)
+{
+	if (et >= 1 && et <= 4)				// Outline
 	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar mon = today.getMonth();\n";
-		code += "\tvar day = today.getDate();\n";
-		code += "\tvar year = today.getFullYear();\n";
-		code += "\tswitch(mon) {\n";
-		code += "\t\tcase 0: mon = 'Januray'; break;\n";
-		code += "\t\tcase 1: mon = 'February'; break;\n";
-		code += "\t\tcase 2: mon = 'March'; break;\n";
-		code += "\t\tcase 3: mon = 'April'; break;\n";
-		code += "\t\tcase 4: mon = 'May'; break;\n";
-		code += "\t\tcase 5: mon = 'June'; break;\n";
-		code += "\t\tcase 6: mon = 'July'; break;\n";
-		code += "\t\tcase 7: mon = 'August'; break;\n";
-		code += "\t\tcase 8: mon = 'September'; break;\n";
-		code += "\t\tcase 9: mon = 'October'; break;\n";
-		code += "\t\tcase 10: mon = 'November'; break;\n";
-		code += "\t\tcase 11: mon = 'December'; break;\n";
-		code += "\t}\n";
-		code += "\tday = checkTime(day);\n";
+		string n = to_string(et);
+		return "-"+n+"px -"+n+"px "+col+","+n+"px -"+n+"px "+col+","+n+"px -"+n+"px "+col+","+n+"px "+n+"px "+col;
+	}
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = mon + ' ' + day + ', ' + year;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 1000);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_DATE_MONTH_D_Y;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
+	if (et >= 5 && et <= 8)				// Glow
+		return "0px 0px "+to_string(et - 4)+"px "+col;
+
+	if (et >= 9 && et <= 32)			// Soft, medium and hard drop shadow
+	{
+		string off = to_string((et - 9) / 8 + 1)+"px ";
+		return off+off+to_string((et - 9) % 8 + 1)+"px "+col;
 	}
 
-	if (button.ad == 157)		// System date: dd month, yyyy
+	if (et >= 33 && et <= 56)			// Drop shadows with outline
 	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar mon = today.getMonth();\n";
-		code += "\tvar day = today.getDate();\n";
-		code += "\tvar year = today.getFullYear();\n";
-		code += "\tswitch(mon) {\n";
-		code += "\t\tcase 0: mon = 'Januray'; break;\n";
-		code += "\t\tcase 1: mon = 'February'; break;\n";
-		code += "\t\tcase 2: mon = 'March'; break;\n";
-		code += "\t\tcase 3: mon = 'April'; break;\n";
-		code += "\t\tcase 4: mon = 'May'; break;\n";
-		code += "\t\tcase 5: mon = 'June'; break;\n";
-		code += "\t\tcase 6: mon = 'July'; break;\n";
-		code += "\t\tcase 7: mon = 'August'; break;\n";
-		code += "\t\tcase 8: mon = 'September'; break;\n";
-		code += "\t\tcase 9: mon = 'October'; break;\n";
-		code += "\t\tcase 10: mon = 'November'; break;\n";
-		code += "\t\tcase 11: mon = 'December'; break;\n";
-		code += "\t}\n";
-		code += "\tday = checkTime(day);\n";
+		string off = to_string((et - 33) / 8 + 1)+"px ";
+		string blur = to_string((et - 33) % 8 + 1)+"px ";
+		return "-"+off+"-"+off+blur+col+","+off+off+blur+col;
+	}
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font').innerHTML = day + ' ' + mon + ', ' + year;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 1000);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_DATE_D_MONTH_Y;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
+	return "";
+}
+
+/*
+ * Time and date buttons (system reserved addresses 141 to 158) are updated
+ * by one central timer in the browser (registerClock() in amxpanel.js).
+ * Here we only create the call telling it which elements show which
+ * format. There is no code per button anymore.
+ */
+string PushButton::getScriptCode()
+{
+	DECL_TRACER("PushButton::getScriptCode()");
+
+	if (button.ap != 0)
+		return "";
+
+	switch (button.ad)
+	{
+		case 141: scriptType = SCR_TIME_STANDARD; break;	// System time standard
+		case 142: scriptType = SCR_TIME_AMPM; break;		// System time AM/PM
+		case 143: scriptType = SCR_TIME_24; break;			// System time 24 hour
+		case 151: scriptType = SCR_DATE_WEEKDAY; break;		// System date: weekday
+		case 152: scriptType = SCR_DATE_M_D; break;			// System date: mm/dd
+		case 153: scriptType = SCR_DATE_D_M; break;			// System date: dd/mm
+		case 154: scriptType = SCR_DATE_M_D_Y; break;		// System date: mm/dd/yyyy
+		case 155: scriptType = SCR_DATE_D_M_Y; break;		// System date: dd/mm/yyyy
+		case 156: scriptType = SCR_DATE_MONTH_D_Y; break;	// System date: month dd, yyyy
+		case 157: scriptType = SCR_DATE_D_MONTH_Y; break;	// System date: dd month, yyyy
+		case 158: scriptType = SCR_DATE_Y_M_D; break;		// System date: yyyy-mm-dd
+
+		default:
+			return "";
 	}
 
-	if (button.ad == 158)		// System date: yyyy-mm-dd
+	string ids;
+
+	for (size_t i = 0; i < button.sr.size(); i++)
 	{
-		code += "function "+getFuncName(button.ad)+"() {\n";
-		code += "\tvar today = new Date();\n";
-		code += "\tvar mon = today.getMonth() + 1;\n";
-		code += "\tvar day = today.getDate();\n";
-		code += "\tvar year = today.getFullYear();\n";
-		code += "\tmon = checkTime(mon);\n";
-		code += "\tday = checkTime(day);\n";
+		if (i > 0)
+			ids += ",";
 
-		for (size_t i = 0; i < button.sr.size(); i++)
-			code += "\tdocument.getElementById('"+getBorderStyle(to_string(button.ad))+to_string(button.sr[i].number)+"_font').innerHTML = year + '-' + mon + '-' + day;\n";
-
-		code += "\tvar t = setTimeout("+getFuncName(button.ad)+", 1000);\n";
-		code += "}\n";
-		hScript = true;
-		scriptType = SCR_DATE_Y_M_D;
-		scrStart = getFuncName(button.ad)+"();";
-		return code;
+		ids += "'"+getButtonName(button.ad)+to_string(button.sr[i].number)+"_font'";
 	}
 
+	hScript = true;
+	scrStart = "registerClock("+to_string(button.ad)+",["+ids+"]);";
 	return "";
 }
 
@@ -24,6 +24,7 @@
 #include "fontlist.h"
 #include "icon.h"
 #include "systemreserved.h"
+#include "stylesheet.h"
 
 namespace amx
 {
@@ -53,8 +54,10 @@ namespace amx
 			void setFontClass(FontList *fl) { fontClass = fl; }
 			void setIconClass(Icon *ic) { iconClass = ic; }
 			void setPageID(int id) { pageID = id; }
-			void setPalette(const std::vector<PDATA_T>& pal) { palette = pal; }
-//			std::string getStyle();
+			void setPalette(const std::vector<PDATA_T>& pal) { colors.setPalette(pal); }
+			std::string getStyle(StyleSheet *sheet);
+			std::string getStateStyle(StyleSheet *sheet, size_t idx);
+			std::string getTextStyle(StyleSheet *sheet, size_t idx);
 			std::string getWebCode();
 			std::string getScriptCode();
 			bool haveScript() { return hScript; }
@@ -67,6 +70,9 @@ namespace amx
 			static bool getImageDimensions(const std::string fname, int *width, int *height);
 
 		private:
+			std::string webColor(const std::string& col);
+			std::string textEffect(int et, const std::string& col);
+
 			BUTTON_T button;
 			FontList *fontClass{nullptr};
 			Icon *iconClass{nullptr};
@@ -77,7 +83,7 @@ namespace amx
 			bool hScript{false};
 			SCR_TYPE scriptType{SCR_NONE};
 			std::vector<PAGE_T> pageList;
-			std::vector<PDATA_T> palette;
+			Palette colors;				// The palette of the button
 	};
 }
 
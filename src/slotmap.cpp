@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include "slotmap.h"
+
+using namespace std;
+using namespace amx;
+
+/*
+ * Takes the channels in the order of the configuration. This is the order
+ * the free slots are given away. Channels out of range and duplicates are
+ * ignored.
+ */
+void amx::SlotMap::init(const vector<int>& channels)
+{
+	slots.clear();
+	pos.assign(SLOT_LAST - SLOT_FIRST + 1, -1);
+
+	for (size_t i = 0; i < channels.size(); i++)
+	{
+		int ch = channels[i];
+
+		if (ch < SLOT_FIRST || ch > SLOT_LAST || pos[ch - SLOT_FIRST] >= 0)
+			continue;
+
+		pos[ch - SLOT_FIRST] = (int)slots.size();
+		slots.push_back(ch);
+	}
+
+	bits.assign((slots.size() + 63) / 64, 0);
+	regIDs.assign(slots.size(), string());
+	index.clear();
+	used = 0;
+}
+
+int amx::SlotMap::position(int channel)
+{
+	if (channel < SLOT_FIRST || channel > SLOT_LAST || pos.empty())
+		return -1;
+
+	return pos[channel - SLOT_FIRST];
+}
+
+/*
+ * Removes the registration ID of the slot from the index, unless the ID
+ * belongs to another slot meanwhile.
+ */
+void amx::SlotMap::forget(int p, int channel)
+{
+	if (regIDs[p].empty())
+		return;
+
+	unordered_map<string, int>::iterator itr = index.find(regIDs[p]);
+
+	if (itr != index.end() && itr->second == channel)
+		index.erase(itr);
+}
+
+/*
+ * Marks the slot as used by the panel with the registration ID. If the slot
+ * was used by another panel before, the old registration ID is forgotten.
+ */
+bool amx::SlotMap::use(int channel, const string& regID)
+{
+	int p = position(channel);
+
+	if (p < 0)
+		return false;
+
+	uint64_t mask = (uint64_t)1 << (p % 64);
+
+	if (!(bits[p / 64] & mask))
+	{
+		bits[p / 64] |= mask;
+		used++;
+	}
+
+	if (regIDs[p] != regID)
+	{
+		forget(p, channel);
+		regIDs[p] = regID;
+
+		if (!regID.empty())
+			index[regID] = channel;
+	}
+
+	return true;
+}
+
+bool amx::SlotMap::release(int channel)
+{
+	int p = position(channel);
+
+	if (p < 0)
+		return false;
+
+	uint64_t mask = (uint64_t)1 << (p % 64);
+
+	if (bits[p / 64] & mask)
+	{
+		bits[p / 64] &= ~mask;
+		used--;
+	}
+
+	forget(p, channel);
+	regIDs[p].clear();
+	return true;
+}
+
+void amx::SlotMap::clear()
+{
+	bits.assign(bits.size(), 0);
+	regIDs.assign(regIDs.size(), string());
+	index.clear();
+	used = 0;
+}
+
+/*
+ * Returns the first free slot in the order of the configuration or 0 if all
+ * slots are in use.
+ */
+int amx::SlotMap::getFree()
+{
+	for (size_t w = 0; w < bits.size(); w++)
+	{
+		uint64_t freeBits = ~bits[w];
+
+		if (freeBits == 0)
+			continue;
+
+		size_t p = w * 64 + __builtin_ctzll(freeBits);
+
+		if (p >= slots.size())
+			return 0;
+
+		return slots[p];
+	}
+
+	return 0;
+}
+
+/*
+ * Returns the slot used by the panel with the registration ID or 0.
+ */
+int amx::SlotMap::find(const string& regID)
+{
+	unordered_map<string, int>::iterator itr = index.find(regID);
+
+	if (itr == index.end())
+		return 0;
+
+	return itr->second;
+}
+
+bool amx::SlotMap::isUsed(int channel)
+{
+	int p = position(channel);
+
+	if (p < 0)
+		return false;
+
+	return (bits[p / 64] & ((uint64_t)1 << (p % 64))) != 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __SLOTMAP_H__
+#define __SLOTMAP_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace amx
+{
+	#define SLOT_FIRST	10000		// Lowest possible panel channel
+	#define SLOT_LAST	11000		// Highest possible panel channel
+
+	/*
+	 * Keeps track of the panel channels (slots) configured with AMXChannel.
+	 * A bitmap in the order of the configuration marks the slots in use,
+	 * so the first free slot is found with a few word operations. The
+	 * registration IDs of the panels in use are indexed, so a panel is
+	 * found without looking at the other registrations.
+	 *
+	 * The class is not thread safe. TouchPanel uses it under its lock.
+	 */
+	class SlotMap
+	{
+		public:
+			void init(const std::vector<int>& channels);
+
+			bool use(int channel, const std::string& regID);
+			bool release(int channel);
+			void clear();
+
+			int getFree();
+			int find(const std::string& regID);
+			bool isUsed(int channel);
+			int getUsed() { return used; }
+
+		private:
+			int position(int channel);
+			void forget(int p, int channel);
+
+			std::vector<int> slots;						// Configured channels
+			std::vector<int> pos;						// Channel --> index in slots
+			std::vector<uint64_t> bits;					// 1 = slot in use
+			std::vector<std::string> regIDs;			// Registration ID of the slot
+			std::unordered_map<std::string, int> index;	// Registration ID --> channel
+			int used{0};
+	};
+}
+
+#endif
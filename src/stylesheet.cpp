@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <string>
+#include <cstdint>
+#include "syslog.h"
+#include "str.h"
+#include "trace.h"
+#include "stylesheet.h"
+
+extern Syslog *sysl;
+
+using namespace std;
+using namespace amx;
+
+string StyleSheet::intern(const CSS_DECL_T& decls)
+{
+	DECL_TRACER("StyleSheet::intern(const CSS_DECL_T& decls)");
+
+	if (decls.empty())
+		return string();
+
+	string body = normalize(decls);
+	size_t h = hash(body);
+	requests++;
+
+	auto range = index.equal_range(h);
+
+	for (auto itr = range.first; itr != range.second; ++itr)
+	{
+		if (rules[itr->second].body.compare(body) == 0)
+			return rules[itr->second].name;
+	}
+
+	CSS_RULE rule;
+	rule.name = "amx_s"+to_string(rules.size());
+	rule.body = body;
+	index.insert(pair<size_t, size_t>(h, rules.size()));
+	rules.push_back(rule);
+	return rule.name;
+}
+
+string StyleSheet::getCss()
+{
+	DECL_TRACER("StyleSheet::getCss()");
+
+	string css;
+	TRACER("StyleSheet::getCss: "+to_string(rules.size())+" unique rules for "+to_string(requests)+" requests.");
+
+	for (size_t i = 0; i < rules.size(); i++)
+		css += "."+rules[i].name+" {\n"+rules[i].body+"}\n";
+
+	return css;
+}
+
+void StyleSheet::clear()
+{
+	DECL_TRACER("StyleSheet::clear()");
+
+	rules.clear();
+	index.clear();
+	requests = 0;
+}
+
+/*
+ * Brings the declarations into a canonical form. Surrounding white space and
+ * a trailing semicolon are removed, so "left: 1px;" and " left: 1px" result
+ * in the same rule.
+ */
+string StyleSheet::normalize(const CSS_DECL_T& decls)
+{
+	string body;
+
+	for (size_t i = 0; i < decls.size(); i++)
+	{
+		string d = decls[i];
+		d = Str::trim(d);
+
+		while (!d.empty() && d.back() == ';')
+			d.pop_back();
+
+		if (d.empty())
+			continue;
+
+		body += "  "+d+";\n";
+	}
+
+	return body;
+}
+
+/*
+ * FNV-1a hash over the normalized declarations. It's cheap and good
+ * enough to spread the rules. Collisions are resolved by comparing the
+ * bodies in intern().
+ */
+size_t StyleSheet::hash(const string& body)
+{
+	uint64_t h = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < body.length(); i++)
+	{
+		h ^= (unsigned char)body[i];
+		h *= 1099511628211ULL;
+	}
+
+	return (size_t)h;
+}
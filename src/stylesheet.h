@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __STYLESHEET_H__
+#define __STYLESHEET_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace amx
+{
+	/*
+	 * A list of CSS declarations like "left: 10px". The order is preserved,
+	 * because it can matter in CSS.
+	 */
+	typedef std::vector<std::string> CSS_DECL_T;
+
+	/*
+	 * This class collects the CSS rules of all pages, popups and buttons.
+	 * Every distinct set of declarations is stored only once and gets a
+	 * short class name. Elements with identical styles share the same
+	 * class instead of carrying their own copy of the rule.
+	 */
+	class StyleSheet
+	{
+		public:
+			StyleSheet() = default;
+			~StyleSheet() = default;
+
+			std::string intern(const CSS_DECL_T& decls);
+			std::string getCss();
+			size_t numRules() { return rules.size(); }
+			size_t numRequests() { return requests; }
+			void clear();
+
+		private:
+			typedef struct CSS_RULE
+			{
+				std::string name;		// The generated class name
+				std::string body;		// The normalized declarations
+			}CSS_RULE;
+
+			static std::string normalize(const CSS_DECL_T& decls);
+			static size_t hash(const std::string& body);
+
+			std::vector<CSS_RULE> rules;
+			std::unordered_multimap<size_t, size_t> index;	// hash --> position in rules
+			size_t requests{0};
+	};
+}
+
+#endif
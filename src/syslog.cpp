@@ -19,8 +19,11 @@
 #include <syslog.h>
 #include <iostream>
 #include <fstream>
+#include <thread>
 #include "syslog.h"
 #include "datetime.h"
+#include "trace.h"
+#include "allocstats.h"
 
 Syslog::Syslog(const std::string &name, Priority p, Option o)
 			: pname(name),
@@ -28,13 +31,15 @@ Syslog::Syslog(const std::string &name, Priority p, Option o)
 			  option(o)
 {
 	fflag = false;
+	debug = false;
 	LogFile = "";
-	deep = 0;
 	lastFileError = false;
 }
 
 Syslog::~Syslog()
 {
+	stopAsync();
+
 	if (fflag)
 		closelog();
 }
@@ -45,8 +50,92 @@ void Syslog::close()
 		closelog();
 }
 
+/*
+ * Starts the asynchronous backend. From now on the messages are queued and
+ * written by a background thread. This must be called after the program
+ * became a daemon, because the thread would not survive the fork.
+ */
+bool Syslog::startAsync(size_t queueSize, size_t rotateSize, int rotateCount)
+{
+	if (sink)
+		return true;
+
+	close();
+	fflag = false;
+	LogSink *s = new LogSink(pname, option, priority, (debug ? LogFile : std::string()), queueSize, rotateSize, rotateCount);
+
+	if (!s->start())
+	{
+		delete s;
+		return false;
+	}
+
+	sink = s;
+	return true;
+}
+
+/*
+ * Stops the asynchronous backend. All queued messages are written before
+ * this method returns. Other threads may still be inside enqueue() with
+ * the old sink, so it is deleted only after they left. Messages logged from
+ * now on are written synchronously again.
+ */
+void Syslog::stopAsync()
+{
+	LogSink *s = sink.exchange(nullptr);
+
+	if (!s)
+		return;
+
+	while (sinkUsers.load() > 0)
+		std::this_thread::yield();
+
+	s->stop();
+	delete s;
+}
+
+/*
+ * Hands a message over to the asynchronous backend, if it is running. The
+ * destinations are the same as with the synchronous methods: The file gets
+ * all messages as long as debugging is on, debug messages are written only
+ * to the file if there is one (\a plain). Returns false if the backend is not
+ * running and the caller must write the message itself.
+ */
+bool Syslog::enqueue(Level l, const std::string& str, bool plain)
+{
+	sinkUsers++;
+	LogSink *s = sink.load();
+
+	if (!s)
+	{
+		sinkUsers--;
+		return false;
+	}
+
+	int flags = 0;
+
+	if (plain)
+		flags = LogSink::LS_FILE;
+	else
+	{
+		flags = LogSink::LS_SYSLOG;
+
+		if (debug && !LogFile.empty())
+			flags |= LogSink::LS_FILE | LogSink::LS_LEVEL;
+	}
+
+	s->push(l, flags, str);
+	sinkUsers--;
+	return true;
+}
+
 void Syslog::log(Level l, const std::string& str)
 {
+	ALLOC_TAG(amx::AT_LOGGING);
+
+	if (enqueue(l, str, debug && l == IDEBUG && !LogFile.empty()))
+		return;
+
 	if (debug && l == IDEBUG && !LogFile.empty())
 	{
 		writeToFile(str);
@@ -73,6 +162,11 @@ void Syslog::log(Syslog::Level l, const std::string& str) const
 
 void Syslog::logThr(Level l, const std::string& str)
 {
+	ALLOC_TAG(amx::AT_LOGGING);
+
+	if (enqueue(l, str, debug && l == IDEBUG && !LogFile.empty()))
+		return;
+
 	std::lock_guard<std::mutex> lock(mut);
 
 	if (debug && l == IDEBUG && !LogFile.empty())
@@ -101,6 +195,11 @@ void Syslog::logThr(Syslog::Level l, const std::string& str) const
 
 void Syslog::errlog(const std::string& str)
 {
+	ALLOC_TAG(amx::AT_LOGGING);
+
+	if (enqueue(ERR, str))
+		return;
+
 	if (!fflag)
 	{
 		openlog(pname.c_str(), option, priority);
@@ -120,6 +219,11 @@ void Syslog::errlog(const std::string& str) const
 
 void Syslog::errlogThr(const std::string& str)
 {
+	ALLOC_TAG(amx::AT_LOGGING);
+
+	if (enqueue(ERR, str))
+		return;
+
 	std::lock_guard<std::mutex> lock(mut);
 
 	if (!fflag)
@@ -141,6 +245,11 @@ void Syslog::errlogThr(const std::string& str) const
 
 void Syslog::warnlog(const std::string& str)
 {
+	ALLOC_TAG(amx::AT_LOGGING);
+
+	if (enqueue(WARNING, str))
+		return;
+
 	if (!fflag)
 	{
 		openlog(pname.c_str(), option, priority);
@@ -160,6 +269,11 @@ void Syslog::warnlog(const std::string& str) const
 
 void Syslog::warnlogThr(const std::string& str)
 {
+	ALLOC_TAG(amx::AT_LOGGING);
+
+	if (enqueue(WARNING, str))
+		return;
+
 	std::lock_guard<std::mutex> lock(mut);
 
 	if (!fflag)
@@ -181,9 +295,14 @@ void Syslog::warnlogThr(const std::string& str) const
 
 void Syslog::log_serial(Level l, const std::string& str)
 {
+	ALLOC_TAG(amx::AT_LOGGING);
+
 	if (!debug && l == IDEBUG)
 		return;
 
+	if (enqueue(l, str))
+		return;
+
 	if (!fflag && LogFile.empty())
 	{
 		openlog(pname.c_str(), option, priority);
@@ -272,20 +391,34 @@ void Syslog::appendToFile(Level l, const std::string& str)
 	}
 }
 
-void Syslog::TRACE(FUNCTION f, const std::string& msg, bool thr)
+/*
+ * Writes a trace message. The nesting depth is kept per thread, so threads
+ * tracing at the same time don't mix up their indentation.
+ */
+void Syslog::TRACE(FUNCTION f, const std::string& msg, bool)
 {
-	std::unique_lock<std::mutex> lock(mut);
+	ALLOC_TAG(amx::AT_LOGGING);
 
-	if (!thr)
-		lock.unlock();
+	if (!debug)
+		return;
 
-	std::string s;
+	int& deep = TraceContext::depth();
 
 	if (f == EXIT && deep > 0)
 		deep--;
 
-	for (int i = 0; i < deep; i++)
-		s += " ";
+	if (TraceContext::isBinary())
+	{
+		TraceContext::write(f, deep, msg);
+
+		if (f == ENTRY)
+			deep++;
+
+		return;
+	}
+
+	std::string s = TraceContext::getTag();
+	s.append(deep, ' ');
 
 	if (f == ENTRY)
 	{
@@ -297,6 +430,6 @@ void Syslog::TRACE(FUNCTION f, const std::string& msg, bool thr)
 	else
 		s += " ";
 
-	DebugMsg(s+msg);
+	s += msg;
+	DebugMsg(s);
 }
-
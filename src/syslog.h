@@ -24,6 +24,8 @@
 #include <sstream>
 #include <syslog.h>
 #include <mutex>
+#include <atomic>
+#include "logsink.h"
 
 class Syslog
 {
@@ -102,7 +104,10 @@ class Syslog
 		void setPriority(Priority p);
 		void setOption(Option o);
 		void setDebug(bool d) { debug = d; }
+		bool isDebug() const { return debug; }
 		void setLogFile(const std::string& lf) { LogFile = lf; }
+		bool startAsync(size_t queueSize, size_t rotateSize, int rotateCount);
+		void stopAsync();
 
 		void DebugMsg(const std::string& msg, bool thr = false)
 		{
@@ -122,6 +127,7 @@ class Syslog
 		void writeToFile(const std::string& str);
 		void appendToFile(Level l, const std::string& str);
 		void close();
+		bool enqueue(Level l, const std::string& str, bool plain = false);
 
 		bool fflag;			// true = log is open
 		bool debug;
@@ -130,9 +136,10 @@ class Syslog
 		Priority priority;
 		Option option;
 		std::ostringstream _ibuf;
-		int deep;
 		bool lastFileError;
 		std::mutex mut;
+		std::atomic<LogSink *> sink{nullptr};
+		std::atomic<int> sinkUsers{0};	// Threads inside enqueue()
 };
 
 #endif
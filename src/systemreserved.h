@@ -78,6 +78,31 @@ namespace amx
 				return none;
 			}
 
+			/*
+			 * Adds the CSS declarations of the border \a name to \a decl.
+			 * Returns FALSE if the border is unknown.
+			 */
+			inline bool getBorderDecl(const std::string& name, std::vector<std::string>& decl)
+			{
+				for (size_t i = 0; i < sysBorders.size(); i++)
+				{
+					if (Str::caseCompare(sysBorders[i].name, name) != 0)
+						continue;
+
+					const std::string *st[] = { &sysBorders[i].style1, &sysBorders[i].style2, &sysBorders[i].style3, &sysBorders[i].style4 };
+
+					for (size_t j = 0; j < 4; j++)
+					{
+						if (!st[j]->empty())
+							decl.push_back(st[j]->substr(0, st[j]->find(';')));
+					}
+
+					return true;
+				}
+
+				return false;
+			}
+
 		private:
 			const std::string none;
 
@@ -137,18 +162,20 @@ namespace amx
 				{ "Circle 155", "border-style: solid;", "border-width: 2px;", "border-radius: 155px;", "" },
 				{ "Circle 165", "border-style: solid;", "border-width: 2px;", "border-radius: 165px;", "" },
 				{ "Circle 175", "border-style: solid;", "border-width: 2px;", "border-radius: 175px;", "" },
-				{ "AMX Elite Inset -L", "border-style: groove;", "border-width: 10px;", "", "" },
-				{ "AMX Elite Raised -L", "border-style: ridge;", "border-width: 10px;", "", "" },
-				{ "AMX Elite Inset -M", "border-style: groove;", "border-width: 5px;", "", "" },
-				{ "AMX Elite Raised -M", "border-style: ridge;", "border-width: 5px;", "", "" },
-				{ "AMX Elite Inset -S", "border-style: groove;", "border-width: 2px;", "", "" },
-				{ "AMX Elite Raised -S", "border-style: ridge;", "border-width: 2px;", "", "" },
-				{ "Bevel Inset -L", "border-style: inset;", "border-width: 10px;", "", "" },
-				{ "Bevel Raised -L", "border-style: outset;", "border-width: 10px;", "", "" },
-				{ "Bevel Inset -M", "border-style: inset;", "border-width: 5px;", "", "" },
-				{ "Bevel Raised -M", "border-style: outset;", "border-width: 5px;", "", "" },
-				{ "Bevel Inset -S", "border-style: inset;", "border-width: 2px;", "", "" },
-				{ "Bevel Raised -S", "border-style: outset;", "border-width: 2px;", "", "" }
+				{ "Circle 185", "border-style: solid;", "border-width: 2px;", "border-radius: 185px;", "" },
+				{ "Circle 195", "border-style: solid;", "border-width: 2px;", "border-radius: 195px;", "" },
+				{ "AMX Elite Inset _L", "border-style: groove;", "border-width: 10px;", "", "" },
+				{ "AMX Elite Raised _L", "border-style: ridge;", "border-width: 10px;", "", "" },
+				{ "AMX Elite Inset _M", "border-style: groove;", "border-width: 5px;", "", "" },
+				{ "AMX Elite Raised _M", "border-style: ridge;", "border-width: 5px;", "", "" },
+				{ "AMX Elite Inset _S", "border-style: groove;", "border-width: 2px;", "", "" },
+				{ "AMX Elite Raised _S", "border-style: ridge;", "border-width: 2px;", "", "" },
+				{ "Bevel Inset _L", "border-style: inset;", "border-width: 10px;", "", "" },
+				{ "Bevel Raised _L", "border-style: outset;", "border-width: 10px;", "", "" },
+				{ "Bevel Inset _M", "border-style: inset;", "border-width: 5px;", "", "" },
+				{ "Bevel Raised _M", "border-style: outset;", "border-width: 5px;", "", "" },
+				{ "Bevel Inset _S", "border-style: inset;", "border-width: 2px;", "", "" },
+				{ "Bevel Raised _S", "border-style: outset;", "border-width: 2px;", "", "" }
 			};
 	};
 }
@@ -37,6 +37,8 @@
 #include "trace.h"
 #include "str.h"
 #include "map.h"
+#include "probes.h"
+#include "allocstats.h"
 
 #ifdef __APPLE__
 using namespace boost;
@@ -49,11 +51,27 @@ extern Config *Configuration;
 extern Syslog *sysl;
 extern atomic<bool> killed;
 
+/*
+ * Time stamps of the command from the controller currently processed in
+ * TouchPanel::setCommand(). TouchPanel::send() uses them to measure the time
+ * until the message is written to the browser.
+ */
+static thread_local uint64_t cmdStamp = 0;		// Time the command was decoded
+static thread_local uint64_t cmdDispatch = 0;	// Time the command was dispatched
+
 TouchPanel::TouchPanel()
 {
-	sysl->TRACE(Syslog::ENTRY, "TouchPanel::TouchPanel()");
+	TRACER(Syslog::ENTRY, "TouchPanel::TouchPanel()");
 	busy = false;
 	serNum = 74201;
+	Metrics& metrics = Metrics::get();
+	mCommands = metrics.gauge("amxpanel_command_queue_length", Metrics::panelLabel(0), "Commands from the controller waiting to be processed");
+	mPanels = metrics.gauge("amxpanel_registered_panels", "", "Number of panels with a valid registration");
+	mRegister = metrics.counter("amxpanel_registrations_total", "event=\"register\"", "Changes of the panel registrations");
+	mRelease = metrics.counter("amxpanel_registrations_total", "event=\"release\"");
+	mConnect = metrics.counter("amxpanel_registrations_total", "event=\"connect\"");
+	mDisconnect = metrics.counter("amxpanel_registrations_total", "event=\"disconnect\"");
+	slots.init(Configuration->getAMXChannels());
 	regCallback(bind(&TouchPanel::webMsg, this, placeholders::_1, placeholders::_2));
 	regCallbackStop(bind(&TouchPanel::stopClient, this));
 	regCallbackConnected(bind(&TouchPanel::setWebConnect, this, placeholders::_1, placeholders::_2));
@@ -61,7 +79,7 @@ TouchPanel::TouchPanel()
 
 	readProject();
 	panType = getProject().projectInfo.panelType;
-	sysl->TRACE("TouchPanel::TouchPanel: Technical name of TP: "+panType);
+	TRACER("TouchPanel::TouchPanel: Technical name of TP: "+panType);
 
 	if (!isParsed())
 	{
@@ -86,38 +104,16 @@ TouchPanel::TouchPanel()
 
 TouchPanel::~TouchPanel()
 {
-	sysl->TRACE(Syslog::EXIT, "TouchPanel::~TouchPanel()");
+	TRACER(Syslog::EXIT, "TouchPanel::~TouchPanel()");
 }
 
 bool TouchPanel::haveFreeSlot()
 {
 	DECL_TRACER("TouchPanel::haveFreeSlot()");
 
-	vector<int>& Slots = Configuration->getAMXChannels();
-	bool loop = false;
-
-	if (registration.size() == 0 && Slots.size() > 0)
+	if (slots.getFree() != 0)
 		return true;
 
-	for (size_t i = 0; i < Slots.size(); i++)
-	{
-		loop = false;
-
-		for (size_t j = 0; j < registration.size(); j++)
-		{
-			if (!registration[j].status && registration[j].channel == Slots[i])
-				return true;
-			else if (registration[j].status && registration[j].channel == Slots[i])
-			{
-				loop = true;
-				break;
-			}
-		}
-
-		if (!loop)
-			return true;
-	}
-
 	sysl->warnlog("TouchPanel::haveFreeSlot: No free slot found!");
 	return false;
 }
@@ -126,51 +122,23 @@ int TouchPanel::getFreeSlot()
 {
 	DECL_TRACER("TouchPanel::getFreeSlot()");
 
-	bool loop = false;
-	vector<int>& Slots = Configuration->getAMXChannels();
+	int slot = slots.getFree();
 
-	for (size_t i = 0; i < Slots.size(); i++)
-	{
-		loop = false;
+	if (slot == 0)
+		sysl->warnlog("TouchPanel::getFreeSlot: No free slot found!");
 
-		for (size_t j = 0; j < registration.size(); j++)
-		{
-			if (!registration[j].status && registration[j].channel == Slots[i])
-				return Slots[i];
-			else if (registration[j].status && registration[j].channel == Slots[i])
-			{
-				loop = true;
-				break;
-			}
-		}
-
-		if (!loop)
-			return Slots[i];
-	}
-
-	sysl->warnlog("TouchPanel::getFreeSlot: No free slot found!");
-	return 0;
+	return slot;
 }
 
+/*
+ * Returns the slot of the panel with the registration ID, as long as the
+ * registration is valid, or 0.
+ */
 int TouchPanel::getSlot(const string& regID)
 {
 	DECL_TRACER("TouchPanel::getSlot(const string& regID)");
 
-	for (size_t i = 0; i < registration.size(); i++)
-	{
-		if (registration[i].regID.compare(regID) == 0)
-		{
-			vector<int>& Slots = Configuration->getAMXChannels();
-
-			for (size_t j = 0; j < Slots.size(); j++)
-			{
-				if (Slots[j] == registration[i].channel)
-					return Slots[j];
-			}
-		}
-	}
-
-	return 0;
+	return slots.find(regID);
 }
 
 bool TouchPanel::replaceSlot(PANELS_T::iterator key, REGISTRATION_T& reg)
@@ -181,13 +149,16 @@ bool TouchPanel::replaceSlot(PANELS_T::iterator key, REGISTRATION_T& reg)
 		return false;
 
 	int id = key->first;
+	int oldKey = id;
 	pair <PANELS_T::iterator, bool> ptr;
+	// The caller may pass the entry itself, which is gone after erase().
+	REGISTRATION_T entry = reg;
 
-	if (id != reg.channel && id == 0 && reg.channel >= 10000 && reg.channel <= 11000)
+	if (id != entry.channel && id == 0 && entry.channel >= 10000 && entry.channel <= 11000)
 	{
-		id = reg.channel;
+		id = entry.channel;
 		registration.erase(key);
-		ptr = registration.insert(PAIR(id, reg));
+		ptr = registration.insert(PAIR(id, entry));
 
 		if (!ptr.second)
 		{
@@ -195,18 +166,40 @@ bool TouchPanel::replaceSlot(PANELS_T::iterator key, REGISTRATION_T& reg)
 			PANELS_T::iterator k = registration.find(id);
 
 			if (k != registration.end())
-				k->second = reg;
+				k->second = entry;
 			else
 				sysl->warnlog("TouchPanel::replaceSlot: Entry with ID "+to_string(id)+" is not in chain!");
 		}
 	}
 	else
-		registration[key->first] = reg;
+		key->second = entry;
+
+	syncSlot(oldKey);
 
-	showContent(reg.pan);
+	if (entry.channel != oldKey)
+		syncSlot(entry.channel);
+
+	showContent(entry.pan);
 	return true;
 }
 
+/*
+ * Brings the slot map in line with the registration of the channel. This is
+ * called after every change of a registration. A slot is in use as long as
+ * the registration of its channel is valid.
+ */
+void TouchPanel::syncSlot(int channel)
+{
+	PANELS_T::iterator itr = registration.find(channel);
+
+	if (itr != registration.end() && itr->second.status && itr->second.channel == channel)
+		slots.use(channel, itr->second.regID);
+	else
+		slots.release(channel);
+
+	mPanels->set(slots.getUsed());
+}
+
 bool TouchPanel::registerSlot (int channel, string& regID, long pan)
 {
 	DECL_TRACER("TouchPanel::registerSlot (int channel, string& regID, long pan)");
@@ -229,6 +222,7 @@ bool TouchPanel::registerSlot (int channel, string& regID, long pan)
 			reg.regID = regID;
 			replaceSlot(itr, reg);
 			sysl->DebugMsg("TouchPanel::registerSlot: Registered channel "+to_string(channel)+" with registration ID "+regID+".");
+			mRegister->inc();
 			return true;
 		}
 
@@ -249,7 +243,11 @@ bool TouchPanel::registerSlot (int channel, string& regID, long pan)
 	if (!ptr.second)
 		sysl->warnlog("TouchPanel::registerSlot: Key "+to_string(channel)+" was not inserted again!");
 	else
+	{
 		sysl->DebugMsg("TouchPanel::registerSlot: Registering channel "+to_string(channel)+" with registration ID "+regID+".");
+		mRegister->inc();
+		syncSlot(channel);
+	}
 
 	showContent(pan);
 	return true;
@@ -265,6 +263,8 @@ bool TouchPanel::releaseSlot (int channel)
 	{
 		itr->second.status = false;
 		sysl->DebugMsg("TouchPanel::registerSlot: Unregistered channel "+to_string(channel)+" with registration ID "+itr->second.regID+".");
+		mRelease->inc();
+		syncSlot(channel);
 		return true;
 	}
 
@@ -284,6 +284,8 @@ bool TouchPanel::releaseSlot (const string& regID)
 		{
 			itr->second.status = false;
 			sysl->DebugMsg("TouchPanel::releaseSlot: Unregistered channel "+to_string(itr->first)+" with registration ID "+regID+".");
+			mRelease->inc();
+			syncSlot(itr->first);
 			return true;
 		}
 
@@ -300,13 +302,7 @@ bool TouchPanel::isRegistered(const string& regID)
 {
 	DECL_TRACER("TouchPanel::isRegistered(string& regID)");
 
-	for (size_t i = 0; i < registration.size(); i++)
-	{
-		if (registration[i].regID.compare(regID) == 0 && registration[i].status)
-			return true;
-	}
-
-	return false;
+	return slots.find(regID) != 0;
 }
 
 bool TouchPanel::isRegistered(int channel)
@@ -387,6 +383,8 @@ bool TouchPanel::delConnection(int id)
 		}
 
 		registration.erase(itr);
+		mDisconnect->inc();
+		syncSlot(id);
 		return true;
 	}
 
@@ -414,6 +412,7 @@ void TouchPanel::regWebConnect(long pan, int id)
 			{
 				itr->second.channel = id;
 				itr->second.pan = pan;
+				syncSlot(itr->first);
 				showContent(pan);
 				return;
 			}
@@ -460,6 +459,7 @@ void TouchPanel::regWebConnect(long pan, int id)
 			sysl->warnlog("TouchPanel::regWebConnect: Key "+to_string(id)+" was not inserted again!");
 	}
 
+	syncSlot(id);
 	showContent(pan);
 }
 
@@ -524,10 +524,11 @@ bool TouchPanel::newConnection(int id)
 
 		thread thr = thread([=] { pANet->Run(); });
 		thr.detach();
+		mConnect->inc();
 	}
 	catch (std::exception& e)
 	{
-		sysl->TRACE(string("TouchPanel::newConnection: Exception: ")+e.what());
+		TRACER(string("TouchPanel::newConnection: Exception: ")+e.what());
 		PANELS_T::iterator key;
 
 		if ((key = registration.find(id)) != registration.end())
@@ -536,6 +537,7 @@ bool TouchPanel::newConnection(int id)
 				delete key->second.amxnet;
 
 			registration.erase(key);
+			syncSlot(id);
 		}
 
 		return false;
@@ -544,9 +546,9 @@ bool TouchPanel::newConnection(int id)
 	return true;
 }
 
-bool TouchPanel::send(int id, string& msg)
+bool TouchPanel::send(int id, string& msg, bool binary, uint64_t key)
 {
-	DECL_TRACER(string("TouchPanel::send(int id, string& msg) [id=")+to_string(id)+", msg="+msg+"]");
+	DECL_TRACER(string("TouchPanel::send(int id, string& msg, bool binary, uint64_t key) [id=")+to_string(id)+", msg="+(binary ? string("<binary>") : msg)+"]");
 
 	PANELS_T::iterator itr;
 	string m(msg);
@@ -562,11 +564,35 @@ bool TouchPanel::send(int id, string& msg)
 		return true;
 	}
 	else if ((itr = registration.find(id)) != registration.end())
-		return WebSocket::send(m, itr->second.pan);
+	{
+		if (!WebSocket::send(m, itr->second.pan, binary, key))
+			return false;
+
+		if (cmdStamp != 0)
+		{
+			Metrics::latency(LAT_CTL_SEND, cmdDispatch);
+			Metrics::latency(LAT_CTL_TOTAL, cmdStamp);
+		}
+
+		return true;
+	}
 
 	return false;
 }
 
+/*
+ * Returns TRUE if the messages for the panel \a id are sent as binary frames.
+ */
+bool TouchPanel::isBinaryPanel(int id)
+{
+	PANELS_T::iterator itr = registration.find(id);
+
+	if (itr == registration.end())
+		return false;
+
+	return WebSocket::isBinary(itr->second.pan);
+}
+
 /*
  * This method is called out of the class AMXNet. Therefore the pointer to this
  * method will be bound to the class. Then this method is a callback method and
@@ -576,11 +602,13 @@ void TouchPanel::setCommand(const ANET_COMMAND& cmd)
 {
 	std::lock_guard<std::mutex> lock(mut);
 	DECL_TRACER("TouchPanel::setCommand(const ANET_COMMAND& cmd)");
+	ALLOC_TAG(AT_DISPATCH);
 
 	if (!isRegistered(cmd.device1))
 		return;
 
 	commands.push_back(cmd);
+	mCommands->set((int64_t)commands.size());
 
 	if (busy)
 		return;
@@ -590,33 +618,74 @@ void TouchPanel::setCommand(const ANET_COMMAND& cmd)
 
 	while (commands.size() > 0)
 	{
-		ANET_COMMAND& bef = commands.at(0);
+		ANET_COMMAND bef = commands.at(0);
 		commands.erase(commands.begin());
+		mCommands->set((int64_t)commands.size());
+		Metrics::latency(LAT_CTL_QUEUE, bef.stamp);
+		AMX_PROBE2(dispatch_controller, bef.device1, bef.MC);
+		cmdStamp = bef.stamp;
+		cmdDispatch = (bef.stamp != 0) ? Metrics::now() : 0;
 		string amxBuffer = getAMXBuffer(bef.device1);
+		bool binary = isBinaryPanel(bef.device1);
 
 		switch (bef.MC)
 		{
 			case 0x0006:
 			case 0x0018:	// feedback channel on
+				if (binary)
+				{
+					WsFrame::channel(com, WB_ON, bef.device1, bef.data.chan_state.port, bef.data.chan_state.channel);
+					send(bef.device1, com, true, WebSocket::updateKey(WS_KEY_CHANNEL, bef.data.chan_state.port, bef.data.chan_state.channel));
+					break;
+				}
+
 				com.assign(to_string(bef.device1));
 				com.append(":");
 				com.append(to_string(bef.data.chan_state.port));
 				com.append("|ON-");
 				com.append(to_string(bef.data.chan_state.channel));
-				send(bef.device1, com);
+				send(bef.device1, com, false, WebSocket::updateKey(WS_KEY_CHANNEL, bef.data.chan_state.port, bef.data.chan_state.channel));
 			break;
 
 			case 0x0007:
 			case 0x0019:	// feedback channel off
+				if (binary)
+				{
+					WsFrame::channel(com, WB_OFF, bef.device1, bef.data.chan_state.port, bef.data.chan_state.channel);
+					send(bef.device1, com, true, WebSocket::updateKey(WS_KEY_CHANNEL, bef.data.chan_state.port, bef.data.chan_state.channel));
+					break;
+				}
+
 				com.assign(to_string(bef.device1));
 				com.append(":");
 				com.append(to_string(bef.data.chan_state.port));
 				com.append("|OFF-");
 				com.append(to_string(bef.data.chan_state.channel));
-				send(bef.device1, com);
+				send(bef.device1, com, false, WebSocket::updateKey(WS_KEY_CHANNEL, bef.data.chan_state.port, bef.data.chan_state.channel));
 			break;
 
 			case 0x000a:	// level value change
+				if (binary)
+				{
+					const ANET_MSG& mv = bef.data.message_value;
+
+					switch (mv.type)
+					{
+						case 0x10: WsFrame::level(com, bef.device1, mv.port, mv.value, (int32_t)mv.content.byte); break;
+						case 0x11: WsFrame::level(com, bef.device1, mv.port, mv.value, (int32_t)mv.content.ch); break;
+						case 0x20: WsFrame::level(com, bef.device1, mv.port, mv.value, (int32_t)mv.content.integer); break;
+						case 0x21: WsFrame::level(com, bef.device1, mv.port, mv.value, (int32_t)mv.content.sinteger); break;
+						case 0x40: WsFrame::level(com, bef.device1, mv.port, mv.value, (double)mv.content.dword); break;
+						case 0x41: WsFrame::level(com, bef.device1, mv.port, mv.value, (int32_t)mv.content.sdword); break;
+						case 0x4f: WsFrame::level(com, bef.device1, mv.port, mv.value, (double)mv.content.fvalue); break;
+						case 0x8f: WsFrame::level(com, bef.device1, mv.port, mv.value, (double)mv.content.dvalue); break;
+						default:   WsFrame::level(com, bef.device1, mv.port, mv.value, (int32_t)0);
+					}
+
+					send(bef.device1, com, true, WebSocket::updateKey(WS_KEY_LEVEL, bef.data.message_value.port, bef.data.message_value.value));
+					break;
+				}
+
 				com.assign(to_string(bef.device1));
 				com.append(":");
 				com.append(to_string(bef.data.message_value.port));
@@ -636,7 +705,7 @@ void TouchPanel::setCommand(const ANET_COMMAND& cmd)
 					case 0x8f: com += to_string(bef.data.message_value.content.dvalue); break;
 				}
 
-				send(bef.device1, com);
+				send(bef.device1, com, false, WebSocket::updateKey(WS_KEY_LEVEL, bef.data.message_value.port, bef.data.message_value.value));
 			break;
 
 			case 0x000c:	// Command string
@@ -658,6 +727,13 @@ void TouchPanel::setCommand(const ANET_COMMAND& cmd)
 					msg.content[len] = 0;
 				}
 
+				if (binary)
+				{
+					WsFrame::command(com, bef.device1, msg.port, NameFormat::cp1250ToUTF8((char *)&msg.content));
+					send(bef.device1, com, true);
+					break;
+				}
+
 				com.assign(to_string(bef.device1));
 				com.append(":");
 				com.append(to_string(msg.port));
@@ -723,6 +799,7 @@ void TouchPanel::setCommand(const ANET_COMMAND& cmd)
 		}
 	}
 
+	cmdStamp = cmdDispatch = 0;
 	busy = false;
 }
 
@@ -731,28 +808,26 @@ void TouchPanel::setCommand(const ANET_COMMAND& cmd)
  * client web browser is received. The messages are processed and then the
  * result is send to the controller, if there is something to send.
  */
-void TouchPanel::webMsg(string& msg, long pan)
+void TouchPanel::webMsg(const WsMessage& msg, long pan)
 {
 	std::lock_guard<std::mutex> lock(mut);
-	DECL_TRACER("TouchPanel::webMsg(string& msg, websocketpp::connection_hdl hdl) ["+msg+"]");
+	DECL_TRACER("TouchPanel::webMsg(const WsMessage& msg, long pan) ["+msg.getMessage()+"]");
+	ALLOC_TAG(AT_DISPATCH);
 
-	vector<string> parts = Str::split(msg, ":");
+	WS_COMMAND cmd = msg.getCommand();
 	ANET_SEND as;
+	as.stamp = Metrics::now();
+	AMX_PROBE2(dispatch_browser, pan, msg.getMessage().c_str());
 
-	if (msg.find("REGISTER:") == string::npos)
-		as.device = atoi(parts[1].c_str());
-	else
+	if (cmd == WC_REGISTER)
+	{
 		as.device = 0;
 
-	if (msg.find("REGISTER:") != string::npos)
-	{
-		if (parts.size() != 2)
+		if (msg.size() != 2)
 			return;
 
-		string regID = parts[1].substr(0, parts[1].length()-1);
+		string regID(msg.field(1));
 		sysl->warnlog("TouchPanel::webMsg: Try to registrate with ID: "+regID+" ...");
-		vector<string> ht;
-
 		string ip = getIP(pan);
 
 		if ((ip.length() > 0 && Configuration->isAllowedNet(ip)))
@@ -807,7 +882,6 @@ void TouchPanel::webMsg(string& msg, long pan)
 			sysl->warnlog("TouchPanel::webMsg: Registration with ID: "+regID+" was successfull.");
 			string com = "0:0|#REG-OK,"+to_string(slot)+","+regID;
 			send(slot, com);
-			return;
 		}
 		else
 		{
@@ -817,149 +891,106 @@ void TouchPanel::webMsg(string& msg, long pan)
 			com = "0:0|#ERR-Access denied!";
 			send(as.device, com);
 		}
-	}
-	else if (isRegistered(as.device) && msg.find("PUSH:") != string::npos)
-	{
-		AMXNet *amxnet;
-
-		if ((amxnet = getConnection(as.device)) == 0)
-		{
-			sysl->errlog(string("TouchPanel::webMsg: Network connection not found for panel ")+to_string(as.device)+"!");
-			return;
-		}
-
-		as.port = atoi(parts[2].c_str());
-		as.channel = atoi(parts[3].c_str());
-		int value = atoi(parts[4].c_str());
-
-		if (value)
-			as.MC = 0x0084;
-		else
-			as.MC = 0x0085;
-
-		sysl->TRACE(string("TouchPanel::webMsg: port: ")+to_string(as.port)+", channel: "+to_string(as.channel)+", value: "+to_string(value)+", MC: 0x"+NameFormat::toHex(as.MC, 4));
 
-		if (amxnet != 0)
-			amxnet->sendCommand(as);
-		else
-			sysl->warnlog(string("TouchPanel::webMsg: Class to talk with an AMX controller was not initialized!"));
+		return;
 	}
-	else if (isRegistered(as.device) && msg.find("LEVEL:") != string::npos)
-	{
-		AMXNet *amxnet;
 
-		if ((amxnet = getConnection(as.device)) == 0)
-		{
-			sysl->errlog(string("TouchPanel::webMsg: Network connection not found for panel ")+to_string(as.device)+"!");
-			return;
-		}
+	as.device = msg.getInt(1);
 
-		as.port = atoi(parts[2].c_str());
-		as.channel = atoi(parts[3].c_str());
-		as.level = as.channel;
-		as.value = atoi(parts[4].c_str());
-		as.MC = 0x008a;
-		sysl->TRACE(string("TouchPanel::webMsg: port: ")+to_string(as.port)+", channel: "+to_string(as.channel)+", value: "+to_string(as.value)+", MC: 0x"+NameFormat::toHex(as.MC, 4));
+	if (!isRegistered(as.device))
+		return;
 
-		if (amxnet != 0)
-			amxnet->sendCommand(as);
-		else
-			sysl->warnlog(string("TouchPanel::webMsg: Class to talk with an AMX controller was not initialized!"));
-	}
-	else if (isRegistered(as.device) && msg.find("PING:") != string::npos)	// PING:<device>:<counter>:<time>
-	{
-		if (parts.size() >= 4)
-		{
-			string answer = parts[1]+":0|#PONG-"+parts[1]+","+parts[2]+","+parts[3];
-			send(as.device, answer);
-		}
-	}
-	else if (isRegistered(as.device) &&
-			 (msg.find("KEY:") != string::npos ||		// KEY:<panelID>:<port>:<channel>:<string>;
-			  msg.find("STRING:") != string::npos))		// STRING:<panelID>:<port>:<channel>:<string>;
-	{
-		AMXNet *amxnet;
+	AMXNet *amxnet = nullptr;
 
+	// All commands except PING are forwarded to the controller.
+	if (cmd == WC_PUSH || cmd == WC_LEVEL || cmd == WC_KEY || cmd == WC_STRING || cmd == WC_CUSTOM)
+	{
 		if ((amxnet = getConnection(as.device)) == 0)
 		{
 			sysl->errlog("TouchPanel::webMsg: Network connection not found for panel "+to_string(as.device)+"!");
 			return;
 		}
+	}
 
-		as.port = atoi(parts[2].c_str());
-		as.channel = atoi(parts[3].c_str());
-		size_t i = 4;
-
-		while (i < parts.size())
+	switch (cmd)
+	{
+		case WC_PUSH:		// PUSH:<panelID>:<port>:<channel>:<value>;
 		{
-			if (i > 4)
-				as.msg.append(":");
+			as.port = msg.getInt(2);
+			as.channel = msg.getInt(3);
+			int value = msg.getInt(4);
 
-			as.msg.append(parts[i]);
-			i++;
-		}
-
-		size_t pos = as.msg.find_last_of(';');
-
-		if (pos != string::npos)
-			as.msg = as.msg.substr(0, pos);
-
-		if (msg.find("KEY:") != string::npos)
-			as.msg = NameFormat::UTF8ToCp1250(as.msg);
-
-		as.MC = 0x008b;
-		sysl->TRACE("TouchPanel::webMsg: port: "+to_string(as.port)+", channel: "+to_string(as.channel)+", msg: "+as.msg+", MC: 0x"+NameFormat::toHex(as.MC, 4));
+			if (value)
+				as.MC = 0x0084;
+			else
+				as.MC = 0x0085;
 
-		if (amxnet != 0)
+			TRACER(string("TouchPanel::webMsg: port: ")+to_string(as.port)+", channel: "+to_string(as.channel)+", value: "+to_string(value)+", MC: 0x"+NameFormat::toHex(as.MC, 4));
 			amxnet->sendCommand(as);
-		else
-			sysl->warnlog("TouchPanel::webMsg: Class to talk with an AMX controller was not initialized!");
-	}
-	else if (isRegistered(as.device) &&
-				msg.find("CUSTOM:") != string::npos)	// CUSTOM:<panelID>:<port>:<channel>:<flag>:<type>:<value1>:<value2>:<value3>:<dType>:<data>;
-	{
-		AMXNet *amxnet;
-
-		if ((amxnet = getConnection(as.device)) == 0)
-		{
-			sysl->errlog("TouchPanel::webMsg: Network connection not found for panel "+to_string(as.device)+"!");
-			return;
 		}
+		break;
+
+		case WC_LEVEL:		// LEVEL:<panelID>:<port>:<level>:<value>;
+			as.port = msg.getInt(2);
+			as.channel = msg.getInt(3);
+			as.level = as.channel;
+			as.value = msg.getInt(4);
+			as.MC = 0x008a;
+			TRACER(string("TouchPanel::webMsg: port: ")+to_string(as.port)+", channel: "+to_string(as.channel)+", value: "+to_string(as.value)+", MC: 0x"+NameFormat::toHex(as.MC, 4));
+			amxnet->sendCommand(as);
+		break;
 
-		as.port = atoi(parts[2].c_str());
-		as.channel = atoi(parts[3].c_str());
-		as.ID = as.channel;
-		as.flag = atoi(parts[4].c_str());
-		as.type = atoi(parts[5].c_str());
-		as.value1 = atol(parts[6].c_str());
-		as.value2 = atol(parts[7].c_str());
-		as.value3 = atol(parts[8].c_str());
-		as.dtype = atoi(parts[9].c_str());
-
-		size_t i = 10;
-
-		while (i < parts.size())
-		{
-			if (i > 10)
-				as.msg.append(":");
+		case WC_PING:		// PING:<device>:<counter>:<time>[:<rtt>]
+			if (msg.size() >= 4)
+			{
+				string answer = string(msg.field(1))+":0|#PONG-"+string(msg.field(1))+","+string(msg.field(2))+","+string(msg.field(3));
+				send(as.device, answer);
+			}
 
-			as.msg.append(parts[i]);
-			i++;
-		}
+			// The browser reports the round trip time of its previous PING in
+			// milliseconds.
+			if (msg.size() >= 5)
+			{
+				int rtt = msg.getInt(4);
 
-		size_t pos = as.msg.find_last_of(';');
+				if (rtt >= 0)
+					Metrics::get().histogram("amxpanel_browser_rtt_us", Metrics::panelLabel(as.device), "Round trip time in microseconds between the server and the browser")->record((uint64_t)rtt * 1000);
+			}
+		break;
 
-		if (pos != string::npos)
-			as.msg = as.msg.substr(0, pos);
+		case WC_KEY:		// KEY:<panelID>:<port>:<channel>:<string>;
+		case WC_STRING:		// STRING:<panelID>:<port>:<channel>:<string>;
+			as.port = msg.getInt(2);
+			as.channel = msg.getInt(3);
+			as.msg = string(msg.rest(4));
 
-//		as.msg = NameFormat::UTF8ToCp1250(as.msg);
-		as.MC = 0x008d;
-		sysl->TRACE("TouchPanel::webMsg: port: "+to_string(as.port)+", channel: "+to_string(as.channel)+", custom msg: "+as.msg+", MC: 0x"+NameFormat::toHex(as.MC, 4));
+			if (cmd == WC_KEY)
+				as.msg = NameFormat::UTF8ToCp1250(as.msg);
 
-		if (amxnet != 0)
+			as.MC = 0x008b;
+			TRACER("TouchPanel::webMsg: port: "+to_string(as.port)+", channel: "+to_string(as.channel)+", msg: "+as.msg+", MC: 0x"+NameFormat::toHex(as.MC, 4));
 			amxnet->sendCommand(as);
-		else
-			sysl->warnlog("TouchPanel::webMsg: Class to talk with an AMX controller was not initialized!");
+		break;
+
+		case WC_CUSTOM:		// CUSTOM:<panelID>:<port>:<channel>:<flag>:<type>:<value1>:<value2>:<value3>:<dType>:<data>;
+			as.port = msg.getInt(2);
+			as.channel = msg.getInt(3);
+			as.ID = as.channel;
+			as.flag = msg.getInt(4);
+			as.type = msg.getInt(5);
+			as.value1 = msg.getLong(6);
+			as.value2 = msg.getLong(7);
+			as.value3 = msg.getLong(8);
+			as.dtype = msg.getInt(9);
+			as.msg = string(msg.rest(10));
+//			as.msg = NameFormat::UTF8ToCp1250(as.msg);
+			as.MC = 0x008d;
+			TRACER("TouchPanel::webMsg: port: "+to_string(as.port)+", channel: "+to_string(as.channel)+", custom msg: "+as.msg+", MC: 0x"+NameFormat::toHex(as.MC, 4));
+			amxnet->sendCommand(as);
+		break;
+
+		default:
+			sysl->DebugMsg("TouchPanel::webMsg: Ignoring unknown command: "+msg.getMessage());
 	}
 }
 
@@ -983,20 +1014,23 @@ void TouchPanel::stopClient()
 
 		registration.erase(itr);
 	}
+
+	slots.clear();
+	mPanels->set(0);
 }
 
 int TouchPanel::findPage(const string& name)
 {
 	DECL_TRACER("TouchPanel::findPage(const string& name)");
-	PROJECT_T pro = getProject();
+	PROJECT_T& pro = getProject();
 
 	for (size_t i = 0; i < pro.pageLists.size(); i++)
 	{
-		PAGE_LIST_T pl = pro.pageLists[i];
+		PAGE_LIST_T& pl = pro.pageLists[i];
 
 		for (size_t j = 0; j < pl.pageList.size(); j++)
 		{
-			PAGE_ENTRY_T pe = pl.pageList[i];
+			PAGE_ENTRY_T& pe = pl.pageList[j];
 
 			if (pe.name.compare(name) == 0)
 				return pe.pageID;
@@ -1006,9 +1040,18 @@ int TouchPanel::findPage(const string& name)
 	return 0;
 }
 
+/*
+ * Reads all pages and popups and writes the generated artifacts immediately.
+ * Each page writes its own structure file (Page<ID>.js); its buttons,
+ * bargraphs and script code are appended to the common files at once.
+ * Only small records of every page are kept in memory, which are needed
+ * later to write the lists of pages, popups and groups and the lookup
+ * tables.
+ */
 void TouchPanel::readPages()
 {
 	DECL_TRACER("TouchPanel::readPages()");
+	ALLOC_TAG(AT_PAGEGEN);
 
 	if (isParsed())
 		return;
@@ -1016,29 +1059,65 @@ void TouchPanel::readPages()
 	if (!isOk())
 		readProject();
 
+	fstream btFile, bgFile, codeFile;
+
+	if (!openOutput(btFile, "/scripts/btarray.js") || !openOutput(bgFile, "/scripts/bargraphs.js") ||
+		!openOutput(codeFile, "/scripts/pagecode.js"))
+	{
+		sysl->errlog("TouchPanel::readPages: Can't write the pages!");
+		exit(1);
+	}
+
 	try
 	{
 		vector<string> pgs = getPageFileNames();
-		scBtArray = "\"buttons\":[";
-		bool first = false;
+		bool firstBt = true, firstBg = true;
+		btFile << "var buttonArray = {\"buttons\":[";
+		bgFile << "var bargraphs = {\"bargraphs\":[\n";
 
 		for (size_t i = 0; i < pgs.size(); i++)
 		{
-			sysl->TRACE("TouchPanel::readPages: Parsing page "+pgs[i]);
+			TRACER("TouchPanel::readPages: Parsing page "+pgs[i]);
+			AMX_PROBE1(page_start, pgs[i].c_str());
 			Page p(pgs[i]);
 			p.setPalette(getPalettes());
 			p.setParentSize(getProject().panelSetup.screenWidth, getProject().panelSetup.screenHeight);
 			p.setFontClass(getFontList());
 			p.setProject(&getProject());
 			p.setIconClass(getIconClass());
+			p.setStyleSheet(&styleSheet);
 
 			if (!p.parsePage())
 			{
 				sysl->warnlog("TouchPanel::readPages: Page "+p.getPageName()+" had an error! Page will be ignored.");
+				AMX_PROBE2(page_end, pgs[i].c_str(), -1);
 				continue;
 			}
 
-			pageList.push_back(p.getPageData());
+			// This creates the styles and the buttons.
+			p.getStyleCode();
+			codeFile << p.getScriptCode();
+			scrStart += p.getScriptStart();
+
+			if (p.haveBargraphs())
+			{
+				if (!firstBg)
+					bgFile << ",\n";
+
+				firstBg = false;
+				bgFile << p.getBargraphs();
+				bgIndex.insert(bgIndex.end(), p.getBgAddresses().begin(), p.getBgAddresses().end());
+			}
+
+			if (p.haveBtArray())
+			{
+				if (!firstBt)
+					btFile << ",";
+
+				firstBt = false;
+				btFile << p.getBtArray();
+				btIndex.insert(btIndex.end(), p.getBtAddresses().begin(), p.getBtAddresses().end());
+			}
 
 			if (p.getType() == PAGE)
 			{
@@ -1046,26 +1125,6 @@ void TouchPanel::readPages()
 				pg.ID = p.getPageID();
 				pg.name = p.getPageName();
 				pg.file = p.getFileName();
-				pg.styles = p.getStyleCode();
-				pg.webcode = p.getWebCode();
-				scrBuffer += p.getScriptCode();
-				scrStart += p.getScriptStart();
-
-				if (!sBargraphs.empty() && p.haveBargraphs())
-					sBargraphs += ",\n";
-
-				if (p.haveBargraphs())
-					sBargraphs += p.getBargraphs();
-
-				if (p.haveBtArray())
-				{
-					if (first)
-						scBtArray += ",";
-					else
-						first = true;
-
-					scBtArray += p.getBtArray();
-				}
 
 				if (pg.name.compare(getProject().panelSetup.powerUpPage) == 0)
 					pg.active = true;
@@ -1073,7 +1132,6 @@ void TouchPanel::readPages()
 					pg.active = false;
 
 				stPages.push_back(pg);
-				p.serializeToFile();
 			}
 			else
 			{
@@ -1082,28 +1140,8 @@ void TouchPanel::readPages()
 				pop.name = p.getPageName();
 				pop.file = p.getFileName();
 				pop.group = p.getGroupName();
-				pop.styles = p.getStyleCode();
-				pop.webcode = p.getWebCode();
 				pop.active = false;
 				pop.modal = p.getModal();
-				scrBuffer += p.getScriptCode();
-				scrStart += p.getScriptStart();
-
-				if (!sBargraphs.empty() && p.haveBargraphs())
-					sBargraphs += ",\n";
-
-				if (p.haveBargraphs())
-					sBargraphs += p.getBargraphs();
-
-				if (p.haveBtArray())
-				{
-					if (first)
-						scBtArray += ",";
-					else
-						first = true;
-
-				    scBtArray += p.getBtArray();
-				}
 
 				for (size_t j = 0; j < getProject().panelSetup.powerUpPopup.size(); j++)
 				{
@@ -1120,11 +1158,17 @@ void TouchPanel::readPages()
 				}
 
 				stPopups.push_back(pop);
-				p.serializeToFile();
 			}
+
+			p.serializeToFile();
+			AMX_PROBE2(page_end, pgs[i].c_str(), p.getPageID());
 		}
 
-		scBtArray += "]";
+		writeBtArray(btFile);
+		writeBargraphs(bgFile);
+		btFile.close();
+		bgFile.close();
+		codeFile.close();
 	}
 	catch (std::exception& e)
 	{
@@ -1133,9 +1177,35 @@ void TouchPanel::readPages()
 	}
 }
 
+bool TouchPanel::openOutput(fstream& file, const string& name)
+{
+	DECL_TRACER("TouchPanel::openOutput(fstream& file, const string& name)");
+
+	string fname = Configuration->getHTTProot()+name;
+
+	try
+	{
+		file.open(fname, ios::in | ios::out | ios::trunc | ios::binary);
+
+		if (!file.is_open())
+		{
+			sysl->errlog(string("TouchPanel::openOutput: Error opening file ")+fname);
+			return false;
+		}
+	}
+	catch (const fstream::failure& e)
+	{
+		sysl->errlog(string("TouchPanel::openOutput: I/O Error: ")+e.what());
+		return false;
+	}
+
+	return true;
+}
+
 bool TouchPanel::parsePages()
 {
 	DECL_TRACER(string("TouchPanel::parsePages()"));
+	ALLOC_TAG(AT_PAGEGEN);
 
 	fstream pgFile, cssFile, jsFile, cacheFile;
 	// Did we've already parsed?
@@ -1176,7 +1246,10 @@ bool TouchPanel::parsePages()
 	cssFile << "* {\n\tbox-sizing: border-box;\n}\n";
 	// Font faces
 	cssFile << getFontList()->getFontStyles();
+	// Shared classes of pages, popups and buttons
+	cssFile << styleSheet.getCss();
 	cssFile.close();
+	TRACER("TouchPanel::parsePages: Wrote "+to_string(styleSheet.numRules())+" CSS classes for "+to_string(styleSheet.numRequests())+" elements.");
 
 	try
 	{
@@ -1353,28 +1426,6 @@ bool TouchPanel::parsePages()
 		return false;
 	}
 
-	try
-	{
-		string jsname = Configuration->getHTTProot()+"/scripts/btarray.js";
-		jsFile.open(jsname, ios::in | ios::out | ios::trunc | ios::binary);
-
-		if (!jsFile.is_open())
-		{
-			sysl->errlog(string("TouchPanel::parsePages: Error opening file ")+jsname);
-			pgFile.close();
-			return false;
-		}
-
-		writeBtArray(jsFile);
-		jsFile.close();
-	}
-	catch (const fstream::failure e)
-	{
-		sysl->errlog(string("TouchPanel::parsePages: I/O Error: ")+e.what());
-		pgFile.close();
-		return false;
-	}
-
 	try
 	{
 		string jsname = Configuration->getHTTProot()+"/scripts/icons.js";
@@ -1397,28 +1448,6 @@ bool TouchPanel::parsePages()
 		return false;
 	}
 
-	try
-	{
-		string jsname = Configuration->getHTTProot()+"/scripts/bargraphs.js";
-		jsFile.open(jsname, ios::in | ios::out | ios::trunc | ios::binary);
-
-		if (!jsFile.is_open())
-		{
-			sysl->errlog(string("TouchPanel::parsePages: Error opening file ")+jsname);
-			pgFile.close();
-			return false;
-		}
-
-		writeBargraphs(jsFile);
-		jsFile.close();
-	}
-	catch (const fstream::failure e)
-	{
-		sysl->errlog(string("TouchPanel::parsePages: I/O Error: ")+e.what());
-		pgFile.close();
-		return false;
-	}
-
 	try
 	{
 		string jsname = Configuration->getHTTProot()+"/scripts/palette.js";
@@ -1610,8 +1639,8 @@ bool TouchPanel::parsePages()
 	pgFile << endl << "<script type=\"text/javascript\" src=\"scripts/page.js\"></script>" << endl;
 	pgFile << "<script type=\"text/javascript\" src=\"scripts/amxpanel.js\"></script>" << endl;
 	// Add some special script functions
+	pgFile << "<script type=\"text/javascript\" src=\"scripts/pagecode.js\"></script>" << endl;
 	pgFile << "<script>\n";
-	pgFile << scrBuffer << endl;
 	// This is the WebSocket connection function
 	pgFile << "function connect()\n{\n";
 	pgFile << "\tif (wsocket !== null && (wsocket.readyState == WebSocket.OPEN || wsocket.readyState == WebSocket.CLOSING) && ws_online > 0)" << endl;
@@ -1623,8 +1652,13 @@ bool TouchPanel::parsePages()
 	else
 		pgFile << "\t\twsocket = new WebSocket(\"ws://" << Configuration->getWebSocketServer() << ":" << Configuration->getSidePort() << "/\");\n";
 
+	pgFile << "\t\twsocket.binaryType = \"arraybuffer\";" << endl;
 	pgFile << "\t\twsocket.onopen = function() {" << endl;
     pgFile << "\t\t\tgetRegistrationID();\n\t\t\tws_online = 1;\t\t// online\n\t\t\tsetOnlineStatus(1);\n" << endl;
+	// Ask for binary frames and batches. The server ignores what is not enabled.
+	pgFile << "\t\t\tvar proto = 'PROTO:BATCH';\n" << endl;
+	pgFile << "\t\t\tif (typeof DataView != \"undefined\" && typeof TextDecoder != \"undefined\")\n\t\t\t\tproto += ':BIN';\n" << endl;
+	pgFile << "\t\t\twsocket.send(proto + ';');\n" << endl;
 	pgFile << "\t\t\tif (!regStatus)\n\t\t\t{" << endl;
 	pgFile << "\t\t\t\tif (typeof registrationID == \"string\" && registrationID.length > 0)\n";
 	pgFile << "\t\t\t\t\twsocket.send('REGISTER:'+registrationID+';');\n";
@@ -1776,11 +1810,38 @@ void TouchPanel::writePopups (fstream& pgFile)
 	pgFile << "\n\t]};\n";
 }
 
+/*
+ * Closes the button array, which was written by readPages(), and appends
+ * the lookup tables.
+ */
 void TouchPanel::writeBtArray(fstream& pgFile)
 {
 	DECL_TRACER(string("TouchPanel::writeBtArray(fstream& pgFile)"));
 
-	pgFile << "var buttonArray = {" << scBtArray << "\n\t};\n";
+	pgFile << "]\n\t};\n";
+
+	// Lookup tables: (port, channel) and (port, address) --> positions in buttonArray
+	// and (page, button) --> position in buttonArray
+	ADDR_INDEX_T chIdx, adIdx, btIdx;
+
+	for (size_t i = 0; i < btIndex.size(); i++)
+	{
+		if (btIndex[i].ch > 0)
+			chIdx[std::make_pair(btIndex[i].cp, btIndex[i].ch)].push_back(i);
+
+		if (btIndex[i].ad > 0)
+			adIdx[std::make_pair(btIndex[i].ap, btIndex[i].ad)].push_back(i);
+
+		btIdx[std::make_pair(btIndex[i].pnum, btIndex[i].bi)].push_back(i);
+	}
+
+	pgFile << "var buttonIndex = {";
+	writeIndex(pgFile, "ch", chIdx);
+	pgFile << ",";
+	writeIndex(pgFile, "ad", adIdx);
+	pgFile << ",";
+	writeIndex(pgFile, "bt", btIdx);
+	pgFile << "\n\t};\n";
 }
 
 void TouchPanel::writeIconTable(fstream& pgFile)
@@ -1803,10 +1864,62 @@ void TouchPanel::writeIconTable(fstream& pgFile)
     pgFile << "\n\t]};\n\n";
 }
 
+/*
+ * Closes the list of bargraphs, which was written by readPages(), and
+ * appends the lookup tables.
+ */
 void TouchPanel::writeBargraphs(fstream& pgFile)
 {
 	DECL_TRACER("TouchPanel::writeBargraphs(fstream& pgFile)");
-	pgFile << "var bargraphs = {\"bargraphs\":[\n" << sBargraphs << "\n]};\n";
+	pgFile << "\n]};\n";
+
+	// Lookup tables: (level port, level) and (page, button) --> positions in bargraphs
+	ADDR_INDEX_T lvIdx, btIdx;
+
+	for (size_t i = 0; i < bgIndex.size(); i++)
+	{
+		lvIdx[std::make_pair(bgIndex[i].lp, bgIndex[i].lv)].push_back(i);
+		btIdx[std::make_pair(bgIndex[i].pnum, bgIndex[i].bi)].push_back(i);
+	}
+
+	pgFile << "var bargraphIndex = {";
+	writeIndex(pgFile, "lv", lvIdx);
+	pgFile << ",";
+	writeIndex(pgFile, "bt", btIdx);
+	pgFile << "\n\t};\n";
+}
+
+/*
+ * Writes an index as a JSON object. The key is "<a>,<b>" and the value is an
+ * array with the positions of the matching entries.
+ */
+void TouchPanel::writeIndex(fstream& pgFile, const string& name, ADDR_INDEX_T& idx)
+{
+	DECL_TRACER("TouchPanel::writeIndex(fstream& pgFile, const string& name, ADDR_INDEX_T& idx)");
+
+	bool first = true;
+	pgFile << "\n\t\"" << name << "\":{";
+
+	for (auto itr = idx.begin(); itr != idx.end(); ++itr)
+	{
+		if (!first)
+			pgFile << ",";
+
+		first = false;
+		pgFile << "\n\t\t\"" << itr->first.first << "," << itr->first.second << "\":[";
+
+		for (size_t i = 0; i < itr->second.size(); i++)
+		{
+			if (i > 0)
+				pgFile << ",";
+
+			pgFile << itr->second[i];
+		}
+
+		pgFile << "]";
+	}
+
+	pgFile << "}";
 }
 
 bool TouchPanel::isParsed()
@@ -1849,6 +1962,7 @@ void TouchPanel::setWebConnect(bool s, long pan)
 		if (itr->second.pan == pan)
 		{
 			itr->second.status = s;
+			syncSlot(itr->first);
 			break;
 		}
 
@@ -37,6 +37,8 @@
 #include "websocket.h"
 #include "fontlist.h"
 #include "atomicvector.h"
+#include "stylesheet.h"
+#include "slotmap.h"
 
 #define VERSION		"1.2.3"
 #define PAIR(ID, REG)	std::pair<int, REGISTRATION_T>(ID, REG)
@@ -49,8 +51,6 @@ namespace amx
 		std::string name;		// Name of page
 		std::string file;		// File name of page
 		bool active{false};		// true = active/visible.
-		std::string styles;		// The needed styles
-		std::string webcode;	// The webcode
 	}ST_PAGE;
 
 	typedef struct ST_POPUP
@@ -62,8 +62,6 @@ namespace amx
 		bool modal{0};					// true = popup is modal
 		std::string group;			// Group name
 		std::vector<int> onPages;	// Linked to page ID
-		std::string styles;			// The needed styles
-		std::string webcode;		// The webcode
 	}ST_POPUP;
 
 	typedef struct REGISTRATION_T
@@ -77,17 +75,18 @@ namespace amx
 	}REGISTRATION_T;
 
 	typedef std::map<int, REGISTRATION_T> PANELS_T;
+	typedef std::map<std::pair<int, int>, std::vector<size_t> > ADDR_INDEX_T;
 
 	class TouchPanel : public Panel, WebSocket
 	{
 		PANELS_T registration;
-		std::string scrBuffer;
+		SlotMap slots;							// Channels in use and their registration IDs
 		std::string scrStart;
-		std::string scBtArray;
-		std::string sBargraphs;
 		std::vector<ST_PAGE> stPages;
 		std::vector<ST_POPUP> stPopups;
-		std::vector<PAGE_T> pageList;
+		std::vector<BT_ADDR_T> btIndex;			// Addresses of the entries in btarray.js
+		std::vector<BT_ADDR_T> bgIndex;			// Addresses of the entries in bargraphs.js
+		StyleSheet styleSheet;					// Shared CSS classes of all pages
 		std::atomic<bool> busy{false};
 		std::string none;
 		long serNum{0};
@@ -96,6 +95,13 @@ namespace amx
 		AtomicVector<ANET_COMMAND> commands;		// Commands from controller
 		std::mutex mut;
 
+		Gauge *mCommands{nullptr};				// Length of commands
+		Gauge *mPanels{nullptr};				// Number of registered panels
+		Counter *mRegister{nullptr};			// Registration churn
+		Counter *mRelease{nullptr};
+		Counter *mConnect{nullptr};
+		Counter *mDisconnect{nullptr};
+
 		public:
 			TouchPanel();
 			~TouchPanel();
@@ -104,19 +110,21 @@ namespace amx
 			bool parsePages();
 
 			void setCommand(const ANET_COMMAND& cmd);
-			void webMsg(std::string& msg, long pan);
+			void webMsg(const WsMessage& msg, long pan);
 			void stopClient();
 			void setWebConnect(bool s, long pan);
 			void regWebConnect(long pan, int id);
 
 		private:
 			void readPages();
+			bool openOutput(std::fstream& file, const std::string& name);
 			void writePages(std::fstream& pgFile);
 			void writeGroups(std::fstream& pgFile);
 			void writePopups(std::fstream& pgFile);
 			void writeBtArray(std::fstream& pgFile);
 			void writeIconTable(std::fstream& pgFile);
 			void writeBargraphs(std::fstream& pgFile);
+			void writeIndex(std::fstream& pgFile, const std::string& name, ADDR_INDEX_T& idx);
 			bool isParsed();
 			bool haveFreeSlot();
 			int getFreeSlot();
@@ -131,8 +139,10 @@ namespace amx
 			bool delConnection(int id);
 			std::string& getAMXBuffer(int id);
 			void setAMXBuffer(int id, const std::string& buf);
-			bool send(int id, std::string& msg);
+			bool send(int id, std::string& msg, bool binary = false, uint64_t key = 0);
+			bool isBinaryPanel(int id);
 			bool replaceSlot(PANELS_T::iterator key, REGISTRATION_T& reg);
+			void syncSlot(int channel);
 			std::string getSerialNum();
 			void showContent(long pan);
 	};
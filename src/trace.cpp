@@ -18,32 +18,44 @@
 
 #include <string>
 #include <string.h>
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <unistd.h>
 #include "trace.h"
+#include "tracebuf.h"
 #include "str.h"
 
 extern Syslog *sysl;
 
 using namespace std;
 
-Trace::Trace(const std::string& msg, const char* fname, const int line, bool thr)
-			: message(msg),
-			  mFileName(fname),
-			  mLine(line)
+Trace::Trace(const char* fname, const int line, bool thr)
+			: mFileName(fname),
+			  mLine(line),
+			  mThr(thr)
 {
-	if (sysl == 0)
+	active = (sysl != 0 && sysl->isDebug() && TraceContext::isEnabled());
+}
+
+void Trace::enter(const std::string& msg)
+{
+	if (!active)
 		return;
 
 	char buf[64];
-	sysl->TRACE(Syslog::ENTRY, getFName(buf, sizeof(buf))+msg);
+	message = msg;
+	entered = true;
+	sysl->TRACE(Syslog::ENTRY, getFName(buf, sizeof(buf))+msg, mThr);
 }
 
 Trace::~Trace()
 {
-	if (sysl == 0)
+	if (!entered || sysl == 0)
 		return;
 
 	char buf[64];
-	sysl->TRACE(Syslog::EXIT, getFName(buf, sizeof(buf))+string(" ")+message);
+	sysl->TRACE(Syslog::EXIT, getFName(buf, sizeof(buf))+string(" ")+message, mThr);
 }
 
 char *Trace::getFName(char* buf, size_t len)
@@ -64,3 +76,149 @@ char *Trace::getFName(char* buf, size_t len)
 	snprintf(buf, len, "%s: %d: ", nm, mLine);
 	return buf;
 }
+
+unsigned int TraceContext::getThread()
+{
+	if (context.thread == 0)
+		context.thread = ++nextThread;
+
+	return context.thread;
+}
+
+/*
+ * Returns the prefix for a trace message in the log. It identifies the
+ * thread and, if set, the panel and the connection.
+ */
+string TraceContext::getTag()
+{
+	string tag = "[T"+to_string(getThread());
+
+	if (context.panel)
+		tag += " P"+to_string(context.panel);
+
+	if (context.connection)
+		tag += " C"+to_string(context.connection);
+
+	return tag+"] ";
+}
+
+/*
+ * Must be called before any thread starts tracing. An empty directory
+ * switches back to the text trace in the log.
+ */
+void TraceContext::setTraceDir(const string& dir)
+{
+	traceDir = dir;
+	binary = !dir.empty();
+}
+
+namespace
+{
+	/*
+	 * The binary trace buffer of one thread. The buffer is written to the
+	 * file of the thread when it is full, if it is older than a second and
+	 * when the thread ends.
+	 */
+	class ThreadTraceBuffer
+	{
+		public:
+			~ThreadTraceBuffer()
+			{
+				flush();
+
+				if (fp)
+					fclose(fp);
+			}
+
+			void append(const amx::TRACE_RECORD& rec, const string& msg)
+			{
+				const char *r = (const char *)&rec;
+				buffer.insert(buffer.end(), r, r + sizeof(rec));
+				buffer.insert(buffer.end(), msg.begin(), msg.end());
+
+				if (buffer.size() >= 65536 || (rec.ns - lastFlush) >= 1000000000ULL)
+				{
+					flush();
+					lastFlush = rec.ns;
+				}
+			}
+
+			void flush()
+			{
+				if (buffer.empty() || !isOpen())
+					return;
+
+				if (fwrite(buffer.data(), 1, buffer.size(), fp) != buffer.size())
+				{
+					fclose(fp);
+					fp = nullptr;
+					failed = true;
+				}
+				else
+					fflush(fp);
+
+				buffer.clear();
+			}
+
+			uint64_t elapsed()
+			{
+				return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+			}
+
+			bool open(const string& dir, unsigned int thread)
+			{
+				if (fp || failed)
+					return fp != nullptr;
+
+				string file = dir+"/trace."+to_string(getpid())+"."+to_string(thread)+".bin";
+
+				if (!(fp = fopen(file.c_str(), "wb")))
+				{
+					failed = true;
+					return false;
+				}
+
+				amx::TRACE_FILE_HEADER hdr;
+				memcpy(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic));
+				hdr.pid = (uint32_t)getpid();
+				hdr.thread = thread;
+				hdr.start = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+				fwrite(&hdr, sizeof(hdr), 1, fp);
+				return true;
+			}
+
+		private:
+			bool isOpen() { return fp != nullptr; }
+
+			vector<char> buffer;
+			FILE *fp{nullptr};
+			bool failed{false};
+			uint64_t lastFlush{0};
+			chrono::steady_clock::time_point start{chrono::steady_clock::now()};
+	};
+
+	thread_local ThreadTraceBuffer traceBuffer;
+}
+
+/*
+ * Appends a record to the binary trace buffer of the current thread.
+ */
+void TraceContext::write(int type, int depth, const string& msg)
+{
+	if (!traceBuffer.open(traceDir, getThread()))
+		return;
+
+	amx::TRACE_RECORD rec;
+	rec.ns = traceBuffer.elapsed();
+	rec.panel = (uint32_t)context.panel;
+	rec.connection = (uint32_t)context.connection;
+	rec.type = (uint16_t)type;
+	rec.depth = (uint16_t)depth;
+	rec.len = (uint32_t)msg.length();
+	traceBuffer.append(rec, msg);
+}
+
+void TraceContext::flush()
+{
+	traceBuffer.flush();
+}
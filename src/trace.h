@@ -19,29 +19,130 @@
 #ifndef __TRACE_H__
 #define __TRACE_H__
 
+#include <string>
+#include <atomic>
 #include "syslog.h"
 
-#define DECL_TRACER(msg)\
-	Trace _hidden_tracer(msg, __FILE__, __LINE__);
+/*
+ * The trace macros check whether debugging is enabled before the message is
+ * evaluated. As long as debugging is off, the argument of the macros is never
+ * built and nothing is allocated. If the program is compiled with _NOTRACE
+ * defined (cmake -DNOTRACE=ON), tracing is removed completely.
+ */
+#ifdef _NOTRACE
+   #define DECL_TRACER(msg)
+   #define DECL_TRACTHR(msg)
+   #define TRACER(...)\
+	do { if (false) sysl->TRACE(__VA_ARGS__); } while (0)
+#else
+   #define DECL_TRACER(msg)\
+	Trace _hidden_tracer(__FILE__, __LINE__);\
+	if (_hidden_tracer.isActive())\
+		_hidden_tracer.enter(msg);
+
+   #define DECL_TRACTHR(msg)\
+	Trace _hidden_tracer(__FILE__, __LINE__, true);\
+	if (_hidden_tracer.isActive())\
+		_hidden_tracer.enter(msg);
+
+   #define TRACER(...)\
+	do { if (sysl && sysl->isDebug() && TraceContext::isEnabled()) sysl->TRACE(__VA_ARGS__); } while (0)
+#endif
+
+typedef struct TRACE_CTX
+{
+	int panel{0};				// Panel ID (channel) the thread works for
+	long connection{0};			// Internal ID of the websocket connection
+	int depth{0};				// Nesting depth of the traced functions
+	unsigned int thread{0};		// Short number of the thread
+}TRACE_CTX;
+
+/*
+ * The trace context of a thread. Each thread has its own nesting depth, a
+ * short number and the IDs of the panel and the websocket connection it is
+ * currently working for. The IDs are written with every trace message.
+ *
+ * If a panel filter is set (TracePanel in the configuration), only threads
+ * working for this panel write trace messages. If a trace directory is set
+ * (TraceDir), the messages are not written to the log, but to a binary file
+ * per thread. This is much cheaper and the files can be decoded offline with
+ * "amxtrcdump".
+ */
+class TraceContext
+{
+	public:
+		static void setPanel(int panel) { context.panel = panel; }
+		static int getPanel() { return context.panel; }
+		static void setConnection(long con) { context.connection = con; }
+		static long getConnection() { return context.connection; }
+		static int& depth() { return context.depth; }
+		static unsigned int getThread();
+		static std::string getTag();
 
-#define DECL_TRACTHR(msg)\
-	Trace _hidden_tracer(msg, __FILE__, __LINE__, true);
+		static void setPanelFilter(int panel) { panelFilter = panel; }
+		static void setTraceDir(const std::string& dir);
+		static bool isBinary() { return binary; }
+		static void write(int type, int depth, const std::string& msg);
+		static void flush();
 
-#define TRACER(msg)\
-	sysl->TRACE(msg);
+		static bool isEnabled()
+		{
+			int filter = panelFilter.load(std::memory_order_relaxed);
+			return (filter == 0 || context.panel == filter);
+		}
+
+	private:
+		static inline thread_local TRACE_CTX context;
+		static inline std::atomic<int> panelFilter{0};
+		static inline std::atomic<bool> binary{false};
+		static inline std::string traceDir;
+		static inline std::atomic<unsigned int> nextThread{0};
+};
+
+/*
+ * Sets the panel and connection of the current thread for the lifetime of
+ * the object. The previous values are restored by the destructor.
+ */
+class TraceTag
+{
+	public:
+		TraceTag(int panel, long con = 0)
+			: oldPanel(TraceContext::getPanel()),
+			  oldCon(TraceContext::getConnection())
+		{
+			TraceContext::setPanel(panel);
+			TraceContext::setConnection(con);
+		}
+
+		~TraceTag()
+		{
+			TraceContext::setPanel(oldPanel);
+			TraceContext::setConnection(oldCon);
+		}
+
+	private:
+		int oldPanel;
+		long oldCon;
+};
 
 class Trace
 {
 	public:
-		Trace(const std::string& msg, const char *fname, const int line, bool thr = false);
+		Trace(const char *fname, const int line, bool thr = false);
 		~Trace();
 
+		bool isActive() { return active; }
+		void enter(const std::string& msg);
+
 	private:
 		char *getFName(char *buf, size_t len);
 
 		std::string message;
 		const char *mFileName;
 		int mLine;
+		bool mThr;
+		bool active;
+		bool entered{false};
 };
 
 #endif
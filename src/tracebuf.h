@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __TRACEBUF_H__
+#define __TRACEBUF_H__
+
+#include <cstdint>
+
+/*
+ * Layout of the binary trace files.
+ *
+ * Every thread writes its own file "trace.<pid>.<thread>.bin" into the
+ * directory set with "TraceDir" in the configuration. A file starts with a
+ * TRACE_FILE_HEADER followed by any number of records. Each record is a
+ * TRACE_RECORD followed by "len" bytes of the message text (not terminated).
+ * All numbers are in the byte order of the host which wrote the file.
+ *
+ * The files are decoded offline with the tool "amxtrcdump".
+ */
+#define TRACE_MAGIC		"AMXTRC01"
+
+namespace amx
+{
+	typedef struct TRACE_FILE_HEADER
+	{
+		char magic[8];			// TRACE_MAGIC
+		uint32_t pid;			// Process ID of the writer
+		uint32_t thread;		// Internal number of the thread
+		uint64_t start;			// Time of creation in nanoseconds since the epoch
+	}TRACE_FILE_HEADER;
+
+	typedef struct TRACE_RECORD
+	{
+		uint64_t ns;			// Nanoseconds since the start of the file
+		uint32_t panel;			// Panel ID (channel) the thread worked for, or 0
+		uint32_t connection;	// Internal ID of the websocket connection, or 0
+		uint16_t type;			// 0 = entry, 1 = message, 2 = exit (Syslog::FUNCTION)
+		uint16_t depth;			// Nesting depth of the thread
+		uint32_t len;			// Length of the following text
+	}TRACE_RECORD;
+}
+
+#endif
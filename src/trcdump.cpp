@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * amxtrcdump: Prints the binary trace files written by amxpanel.
+ *
+ * Usage: amxtrcdump [-p <panel>] <file> [<file> ...]
+ *
+ * With -p only the records written while working for the given panel are
+ * printed.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "tracebuf.h"
+
+using namespace std;
+using namespace amx;
+
+static bool dumpFile(const char *fname, uint32_t panel)
+{
+	FILE *fp = fopen(fname, "rb");
+
+	if (!fp)
+	{
+		fprintf(stderr, "%s: %s\n", fname, strerror(errno));
+		return false;
+	}
+
+	TRACE_FILE_HEADER hdr;
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) != 0)
+	{
+		fprintf(stderr, "%s: Not a trace file!\n", fname);
+		fclose(fp);
+		return false;
+	}
+
+	time_t start = (time_t)(hdr.start / 1000000000ULL);
+	struct tm lt;
+	char ts[64];
+	localtime_r(&start, &lt);
+	strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &lt);
+	printf("# %s: process %u, thread %u, started %s\n", fname, hdr.pid, hdr.thread, ts);
+
+	TRACE_RECORD rec;
+	vector<char> text;
+
+	while (fread(&rec, sizeof(rec), 1, fp) == 1)
+	{
+		text.resize(rec.len);
+
+		if (rec.len > 0 && fread(text.data(), 1, rec.len, fp) != rec.len)
+		{
+			fprintf(stderr, "%s: Truncated record!\n", fname);
+			break;
+		}
+
+		if (panel && rec.panel != panel)
+			continue;
+
+		const char *what = (rec.type == 0) ? "{ Entry: " : (rec.type == 2) ? "} Exit: " : " ";
+		printf("%12.6f T%u P%u C%u %*s%s%.*s\n", (double)rec.ns / 1e9, hdr.thread, rec.panel, rec.connection,
+			   (int)rec.depth, "", what, (int)rec.len, text.data());
+	}
+
+	fclose(fp);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t panel = 0;
+	int i = 1;
+
+	if (argc > 2 && strcmp(argv[1], "-p") == 0)
+	{
+		panel = (uint32_t)atoi(argv[2]);
+		i = 3;
+	}
+
+	if (i >= argc)
+	{
+		fprintf(stderr, "Usage: %s [-p <panel>] <file> [<file> ...]\n", argv[0]);
+		return 1;
+	}
+
+	int ret = 0;
+
+	for (; i < argc; i++)
+	{
+		if (!dumpFile(argv[i], panel))
+			ret = 1;
+	}
+
+	return ret;
+}
@@ -17,12 +17,15 @@
  */
 
 #include <iostream>
+#include <thread>
+#include <vector>
 #include "datetime.h"
 #include "config.h"
 #include "syslog.h"
 #include "websocket.h"
-#include "str.h"
 #include "trace.h"
+#include "probes.h"
+#include "allocstats.h"
 
 extern Config *Configuration;
 extern Syslog *sysl;
@@ -36,19 +39,72 @@ using websocketpp::lib::bind;
 using namespace amx;
 using namespace std;
 
+/*
+ * Holds a read or a write lock of a pthread_rwlock_t as long as it exists.
+ */
+class RwLockGuard
+{
+	public:
+		RwLockGuard(pthread_rwlock_t *l, bool write)
+			: lock(l)
+		{
+			if (write)
+				pthread_rwlock_wrlock(lock);
+			else
+				pthread_rwlock_rdlock(lock);
+		}
+
+		~RwLockGuard() { pthread_rwlock_unlock(lock); }
+
+	private:
+		pthread_rwlock_t *lock;
+};
+
+#ifdef _DEFLATE
+bool amx::deflateEnabled()
+{
+	return Configuration->getWebSocketDeflate();
+}
+
+int amx::deflateWindowBits()
+{
+	return Configuration->getDeflateWindowBits();
+}
+
+/*
+ * Called by DeflateExtension if websocketpp rejects DeflateWindowBits. The
+ * extension is created for every connection, so this is logged only once.
+ */
+void amx::deflateWindowError(const char *side, const websocketpp::lib::error_code& ec)
+{
+	static std::atomic<bool> logged{false};
+
+	if (logged.exchange(true))
+		return;
+
+	sysl->warnlog(string("WebSocket: DeflateWindowBits=")+to_string(Configuration->getDeflateWindowBits())+" rejected for the "+side+" window, using the default: "+ec.message());
+}
+#endif
+
 WebSocket::WebSocket()
 {
-	sysl->TRACE(Syslog::ENTRY, "WebSocket::WebSocket()");
+	TRACER(Syslog::ENTRY, "WebSocket::WebSocket()");
 	cbInit = false;
 	cbInitStop = false;
 	cbInitCon = false;
 	cbInitRegister = false;
 	websocketsLock = PTHREAD_RWLOCK_INITIALIZER;
+	// The sum over all browsers has its own name. Otherwise summing up the
+	// per panel series would count every frame twice.
+	framesAll = Metrics::get().counter("amxpanel_websocket_frames_all_total", "", "Websocket frames sent to all browsers");
+	bytesAll = Metrics::get().counter("amxpanel_websocket_bytes_all_total", "", "Bytes sent to all browsers");
+	coalesced = Metrics::get().counter("amxpanel_websocket_coalesced_total", "", "Updates replaced by a newer value because the browser was too slow");
+	slowDrops = Metrics::get().counter("amxpanel_websocket_slow_drops_total", "", "Connections closed because the browser was too slow");
 }
 
-void WebSocket::regCallback(function<void(string&, long)> func)
+void WebSocket::regCallback(function<void(const WsMessage&, long)> func)
 {
-	DECL_TRACER("WebSocket::regCallback(function<void(string&, long)> func)");
+	DECL_TRACER("WebSocket::regCallback(function<void(const WsMessage&, long)> func)");
 
     if (func == nullptr)
         return;
@@ -103,6 +159,7 @@ void WebSocket::setConStatus(bool s, long pan)
 void WebSocket::run()
 {
 	DECL_TRACER("WebSocket::run()");
+	ALLOC_TAG(AT_WEBSOCKET);
 	// Create a server endpoint
 
 	while (repeatCount < 5)
@@ -111,7 +168,7 @@ void WebSocket::run()
 		{
 			if (Configuration->getWSStatus())
 			{
-				sysl->TRACE("WebSocket::run: Using encrypted communication.");
+				TRACER("WebSocket::run: Using encrypted communication.");
 				// Set logging settings
 				sock_server.set_access_channels(websocketpp::log::alevel::all);
 				sock_server.clear_access_channels(websocketpp::log::alevel::frame_payload);
@@ -129,12 +186,12 @@ void WebSocket::run()
 				// Start the server accept loop
 				sock_server.start_accept();
 				// Start the ASIO io_service run loop
-				sock_server.run();
+				runThreads(sock_server);
 				repeatCount = 0;
 			}
 			else
 			{
-				sysl->TRACE("WebSocket::run: Using plain communication!");
+				TRACER("WebSocket::run: Using plain communication!");
 				// Set logging settings
 				sock_server_ws.set_access_channels(websocketpp::log::alevel::all);
 				sock_server_ws.clear_access_channels(websocketpp::log::alevel::frame_payload);
@@ -151,7 +208,7 @@ void WebSocket::run()
 				// Start the server accept loop
 				sock_server_ws.start_accept();
 				// Start the ASIO io_service run loop
-				sock_server_ws.run();
+				runThreads(sock_server_ws);
 				repeatCount = 0;
 			}
 		}
@@ -189,6 +246,69 @@ void WebSocket::run()
 		fcallStop();
 }
 
+/*
+ * Runs the io_service of the server on a pool of threads (WebSocketThreads)
+ * and returns when it was stopped. The calling thread is one of them.
+ * websocketpp gives every connection its own strand, so the handlers of one
+ * connection are never called at the same time, while the handshakes and
+ * messages of different browsers are handled in parallel.
+ */
+template<typename S>
+void WebSocket::runThreads(S& srv)
+{
+	DECL_TRACER("WebSocket::runThreads(S& srv)");
+
+	int count = Configuration->getWebSocketThreads();
+
+	if (count <= 0)
+		count = (int)thread::hardware_concurrency();
+
+	if (count <= 0)
+		count = 1;
+
+	vector<thread> pool;
+
+	for (int i = 1; i < count; i++)
+	{
+		pool.push_back(thread([&srv] {
+			DECL_TRACTHR("WebSocket::runThreads: worker");
+			ALLOC_TAG(AT_WEBSOCKET);
+
+			try
+			{
+				srv.run();
+			}
+			catch (websocketpp::exception const& e)
+			{
+				sysl->errlogThr(string("WebSocket::runThreads: WEBSocketPP exception: ")+e.what());
+			}
+			catch (std::exception& e)
+			{
+				sysl->errlogThr(string("WebSocket::runThreads: ")+e.what());
+			}
+		}));
+	}
+
+	sysl->DebugMsg("WebSocket::runThreads: Running the websocket server with "+to_string(count)+" threads.");
+
+	try
+	{
+		srv.run();
+	}
+	catch (...)
+	{
+		srv.stop();
+
+		for (size_t i = 0; i < pool.size(); i++)
+			pool[i].join();
+
+		throw;
+	}
+
+	for (size_t i = 0; i < pool.size(); i++)
+		pool[i].join();
+}
+
 WebSocket::~WebSocket()
 {
 	websocketpp::lib::error_code ec;
@@ -201,7 +321,7 @@ WebSocket::~WebSocket()
 	if (ec)
 	{
 		sysl->errlog("WebSocket::~WebSocket: Error stopping listening: "+ec.message());
-		sysl->TRACE(Syslog::EXIT, "WebSocket::~WebSocket()");
+		TRACER(Syslog::EXIT, "WebSocket::~WebSocket()");
 		return;
 	}
 
@@ -242,260 +362,853 @@ WebSocket::~WebSocket()
 	}
 
 
-	sysl->TRACE(Syslog::EXIT, "WebSocket::~WebSocket()");
+	TRACER(Syslog::EXIT, "WebSocket::~WebSocket()");
 }
 
-bool WebSocket::send(string& msg, long pan)
+/*
+ * Sends the message to the browser of the panel \a pan. Messages with a
+ * \a key (see updateKey()) may be replaced by a newer message with the same
+ * key, if the browser doesn't read fast enough.
+ */
+bool WebSocket::send(string& msg, long pan, bool binary, uint64_t key)
 {
-	DECL_TRACER("WebSocket::send(strings::String& msg, long pan)");
+	DECL_TRACER("WebSocket::send(strings::String& msg, long pan, bool binary, uint64_t key)");
+	return sendMsg(msg, pan, binary, key, true);
+}
+
+/*
+ * With \a limit the rate limit of levels is applied. A message kept by the
+ * rate limit is sent later by levelTimer().
+ */
+bool WebSocket::sendMsg(string& msg, long pan, bool binary, uint64_t key, bool limit)
+{
+	ALLOC_TAG(AT_WEBSOCKET);
+
+	if (limit && (key >> 48) == WS_KEY_LEVEL && throttle(pan, msg, binary, key))
+		return true;
 
-	REG_DATA_T::iterator itr;
-	bool found = false;
 	websocketpp::connection_hdl hdl;
+	Counter *frames = nullptr, *bytes = nullptr;
+	bool batch = false;
+
+	{
+		RwLockGuard lock(&websocketsLock, false);
+		REG_DATA_T::iterator itr = findPan(pan);
+
+		if (itr == __regs.end())
+		{
+			sysl->errlog("WebSocket::send: Unknown websocket handle!");
+			return false;
+		}
+
+		hdl = itr->first;
+		frames = itr->second.frames;
+		bytes = itr->second.bytes;
+		batch = itr->second.batch;
+	}
 
 	try
 	{
-		for (itr = __regs.begin(); itr != __regs.end(); ++itr)
+		bool drop = false;
+
+		if (backpressure(hdl, pan, msg, binary, key, frames, bytes, drop))
 		{
-			if (itr->second.ID == pan)
+			if (drop)
 			{
-				hdl = itr->first;
-				found = true;
-				break;
+				dropSlow(hdl, pan);
+				return false;
 			}
-		}
 
-		if (!found)
-		{
-			sysl->errlog("WebSocket::send: Unknown websocket handle!");
-			return false;
+			return true;
 		}
+
+		if (!batch || !addBatch(hdl, pan, msg, binary, frames, bytes))
+			sendFrame(hdl, msg, binary, frames, bytes);
 	}
-	catch (std::exception& e)
+	catch (websocketpp::exception const & e)
 	{
-		sysl->errlog("WebSocket::send: "+string(e.what()));
+		sysl->errlog(string("WebSocket::send: Error sending a message: ")+e.what());
 		return false;
 	}
 
-	try
+	AMX_PROBE3(ws_send, pan, msg.length(), msg.c_str());
+	return true;
+}
+
+/*
+ * Limits the updates of a level to the rate configured for its port.
+ * Returns TRUE if the message was kept to be sent later.
+ */
+bool WebSocket::throttle(long pan, string& msg, bool binary, uint64_t key)
+{
+	int rate = Configuration->getLevelRate((int)((key >> 32) & 0xffff));
+
+	if (rate <= 0)
+		return false;
+
+	uint64_t interval = 1000000 / (uint64_t)rate;
+	uint64_t now = Metrics::now();
+	// removeConnection() erases the levels of a pan under the write lock.
+	// No state must be created again for a pan which is gone.
+	RwLockGuard rlock(&websocketsLock, false);
+
+	if (findPan(pan) == __regs.end())
+		return false;
+
+	std::lock_guard<std::mutex> lock(levelMut);
+	WS_LEVEL_T& lv = levels[pan][key];
+
+	if (lv.timer)
 	{
-		if (Configuration->getWSStatus())
-			sock_server.send(hdl, msg, websocketpp::frame::opcode::text);
-		else
-			sock_server_ws.send(hdl, msg, websocketpp::frame::opcode::text);
+		lv.pending.msg = msg;
+		lv.pending.binary = binary;
+		coalesced->inc();
+		return true;
 	}
-	catch (websocketpp::exception const & e)
+
+	if (now - lv.last >= interval)
 	{
-		sysl->errlog(string("WebSocket::send: Error sending a message: ")+e.what());
+		lv.last = now;
 		return false;
 	}
 
+	lv.pending.msg = msg;
+	lv.pending.binary = binary;
+	lv.timer = true;
+	long wait = (long)((interval - (now - lv.last) + 999) / 1000);
+
+	if (Configuration->getWSStatus())
+		sock_server.set_timer(wait, bind(&WebSocket::levelTimer, this, pan, key, ::_1));
+	else
+		sock_server_ws.set_timer(wait, bind(&WebSocket::levelTimer, this, pan, key, ::_1));
+
 	return true;
 }
 
-void WebSocket::tcp_post_init(connection_hdl hdl)
+/*
+ * Sends the latest value of a level at the end of its interval.
+ */
+void WebSocket::levelTimer(long pan, uint64_t key, websocketpp::lib::error_code const& ec)
 {
-	DECL_TRACER("WebSocket::tcp_post_init(websocketpp::connection_hdl hdl)");
-	server_hdl = hdl;
+	DECL_TRACTHR("WebSocket::levelTimer(long pan, uint64_t key, websocketpp::lib::error_code const& ec)");
+	WS_PENDING_T pend;
 
-	if (!cbInitRegister)
 	{
-		sysl->errlog("WebSocket::tcp_post_init: Callback function for registering web socket connection was not initialized!");
-		return;
+		std::lock_guard<std::mutex> lock(levelMut);
+		map<long, map<uint64_t, WS_LEVEL_T> >::iterator itr = levels.find(pan);
+
+		if (itr == levels.end())
+			return;
+
+		map<uint64_t, WS_LEVEL_T>::iterator lv = itr->second.find(key);
+
+		if (lv == itr->second.end() || !lv->second.timer)
+			return;
+
+		lv->second.timer = false;
+		lv->second.last = Metrics::now();
+		pend.msg.swap(lv->second.pending.msg);
+		pend.binary = lv->second.pending.binary;
 	}
 
-	PAN_ID_T pid;
-	pid.channel = 0;
-	pid.ID = random();
-	string ip;
+	if (!ec)
+		sendMsg(pend.msg, pan, pend.binary, key, false);
+}
 
-	try
+/*
+ * Returns the key of a channel (\a type = WS_KEY_CHANNEL) or a level
+ * (\a type = WS_KEY_LEVEL) update.
+ */
+uint64_t WebSocket::updateKey(int type, int port, int num)
+{
+	return ((uint64_t)type << 48) | ((uint64_t)(port & 0xffff) << 32) | (uint32_t)num;
+}
+
+void WebSocket::sendFrame(connection_hdl hdl, string& msg, bool binary, Counter *frames, Counter *bytes)
+{
+	websocketpp::frame::opcode::value op = binary ? websocketpp::frame::opcode::binary : websocketpp::frame::opcode::text;
+
+#ifdef _DEFLATE
+	// The frame is only compressed if it is big enough to gain anything.
+	// Compressing a few bytes costs more time than it saves.
+	message_ptr m = websocketpp::lib::make_shared<websocketpp::config::asio::message_type>(websocketpp::config::asio::con_msg_manager_type::ptr(), op, msg.length());
+	m->append_payload(msg);
+	m->set_compressed(msg.length() >= Configuration->getDeflateThreshold());
+
+	if (Configuration->getWSStatus())
+		sock_server.send(hdl, m);
+	else
+		sock_server_ws.send(hdl, m);
+#else
+	if (Configuration->getWSStatus())
+		sock_server.send(hdl, msg, op);
+	else
+		sock_server_ws.send(hdl, msg, op);
+#endif
+
+	if (frames)
+	{
+		frames->inc();
+		bytes->inc(msg.length());
+	}
+
+	framesAll->inc();
+	bytesAll->inc(msg.length());
+}
+
+/*
+ * Adds the message to the batch of the browser. The first message of a
+ * batch starts a timer, which sends the batch after WebSocketBatchTime
+ * milliseconds. Text and binary frames are not mixed, and a batch never
+ * grows beyond WS_BATCH_MAX bytes. In both cases the batch collected so far
+ * is sent at once, so the order of the messages is kept.
+ *
+ * Returns FALSE if the message must be sent on its own. A message for a pan
+ * closed in the meantime is dropped.
+ */
+bool WebSocket::addBatch(connection_hdl hdl, long pan, string& msg, bool binary, Counter *frames, Counter *bytes)
+{
+	// removeConnection() erases the batch of a pan under the write lock.
+	// A pan closed in the meantime must not get a new batch and timer.
+	RwLockGuard rlock(&websocketsLock, false);
+
+	if (findPan(pan) == __regs.end())
+		return true;
+
+	std::lock_guard<std::mutex> lock(batchMut);
+	WS_BATCH_T& b = batches[pan];
+
+	if (!b.msgs.empty() && (b.binary != binary || b.size + msg.length() > WS_BATCH_MAX))
+		flushBatch(b);
+
+	if (msg.length() > WS_BATCH_MAX)
+	{
+		flushBatch(b);
+		sendFrame(hdl, msg, binary, frames, bytes);
+		return true;
+	}
+
+	if (b.msgs.empty())
+	{
+		b.hdl = hdl;
+		b.binary = binary;
+		b.frames = frames;
+		b.bytes = bytes;
+	}
+
+	b.msgs.push_back(msg);
+	b.size += msg.length();
+
+	if (!b.timer)
 	{
+		b.timer = true;
+
 		if (Configuration->getWSStatus())
-			ip = sock_server.get_con_from_hdl(hdl)->get_remote_endpoint();
+			sock_server.set_timer(Configuration->getWebSocketBatchTime(), bind(&WebSocket::batchTimer, this, pan, ::_1));
 		else
-			ip = sock_server_ws.get_con_from_hdl(hdl)->get_remote_endpoint();
+			sock_server_ws.set_timer(Configuration->getWebSocketBatchTime(), bind(&WebSocket::batchTimer, this, pan, ::_1));
+	}
 
-		pid.ip = cutIpAddress(ip);
+	return true;
+}
+
+/*
+ * Sends the collected messages. A single message is sent as it is.
+ * batchMut must be locked.
+ */
+void WebSocket::flushBatch(WS_BATCH_T& b)
+{
+	if (b.msgs.empty())
+		return;
+
+	try
+	{
+		if (b.msgs.size() == 1)
+			sendFrame(b.hdl, b.msgs[0], b.binary, b.frames, b.bytes);
+		else
+		{
+			if (b.binary)
+				WsFrame::batch(b.buf, b.msgs);
+			else
+				WsFrame::batchText(b.buf, b.msgs);
 
-		__regs.insert(pair<websocketpp::connection_hdl, PAN_ID_T>(hdl, pid));
-		sysl->DebugMsg("WebSocket::tcp_post_init: Registering pan "+to_string(pid.ID)+" for remote "+pid.ip);
-		fcallRegister(pid.ID, 0);
+			sendFrame(b.hdl, b.buf, b.binary, b.frames, b.bytes);
+		}
 	}
-	catch (websocketpp::exception const& s)
+	catch (websocketpp::exception const & e)
 	{
-		sysl->errlog("WebSocket::tcp_post_init: WebSocket error: "+string(s.what()));
+		sysl->errlog(string("WebSocket::flushBatch: Error sending a message: ")+e.what());
 	}
-	catch (std::exception& e)
+
+	b.msgs.clear();
+	b.size = 0;
+}
+
+void WebSocket::batchTimer(long pan, websocketpp::lib::error_code const& ec)
+{
+	DECL_TRACTHR("WebSocket::batchTimer(long pan, websocketpp::lib::error_code const& ec)");
+	std::lock_guard<std::mutex> lock(batchMut);
+	map<long, WS_BATCH_T>::iterator itr = batches.find(pan);
+
+	if (itr == batches.end())
+		return;
+
+	itr->second.timer = false;
+
+	if (!ec)
+		flushBatch(itr->second);
+	else
 	{
-		sysl->errlog("WebSocket::tcp_post_init: "+string(e.what()));
+		if (!itr->second.msgs.empty())
+			sysl->warnlog("WebSocket::batchTimer: Discarded "+to_string(itr->second.msgs.size())+" messages of pan "+to_string(pan)+": "+ec.message());
+
+		itr->second.msgs.clear();
+		itr->second.size = 0;
 	}
 }
 
-// Define a callback to handle incoming messages
-void WebSocket::on_message(server* s, connection_hdl hdl, message_ptr msg)
+/*
+ * Returns the number of bytes waiting to be written to the browser.
+ */
+size_t WebSocket::getBuffered(connection_hdl hdl)
 {
-	DECL_TRACER("WebSocket::on_message(server* s, websocketpp::connection_hdl hdl, message_ptr msg)");
+	websocketpp::lib::error_code ec;
 
-	try
+	if (Configuration->getWSStatus())
 	{
-		REG_DATA_T::iterator key;
-		bool validKey = false;
-		key = __regs.find(hdl);
+		server::connection_ptr con = sock_server.get_con_from_hdl(hdl, ec);
 
-		if (key != __regs.end())
-			validKey = true;
+		if (!ec && con)
+			return con->get_buffered_amount();
+	}
+	else
+	{
+		server_ws::connection_ptr con = sock_server_ws.get_con_from_hdl(hdl, ec);
 
-		if (validKey)
-			setConStatus(true, key->second.ID);
+		if (!ec && con)
+			return con->get_buffered_amount();
+	}
 
-		server_hdl = hdl;
-		server::connection_ptr con = s->get_con_from_hdl(hdl);
+	return 0;
+}
 
-		if (validKey && key->second.ip.length() == 0)
-		{
-			string ip = con->get_remote_endpoint();
-			key->second.ip = cutIpAddress(ip);
-			sysl->DebugMsg("WebSocket::on_message: Endpoint: "+key->second.ip);
-		}
+/*
+ * Keeps the memory used for a browser which doesn't read its frames (a
+ * tablet gone to sleep with the connection still open) in bounds.
+ *
+ * Returns TRUE if the message must not be sent now. This is the case if the
+ * message was kept as the latest value of its key or if the connection must
+ * be dropped (\a drop). A browser is dropped if it stays above
+ * WebSocketHighWater longer than WebSocketSlowTimeout seconds, or if the
+ * messages without a key let the buffer grow far beyond the limit.
+ */
+bool WebSocket::backpressure(connection_hdl hdl, long pan, string& msg, bool binary, uint64_t key, Counter *frames, Counter *bytes, bool& drop)
+{
+	size_t limit = Configuration->getWebSocketHighWater();
 
-		string send = msg->get_payload();
-		sysl->TRACE("WebSocket::on_message: Called with hdl: message: "+send);
-		int id = 0;
-		long pan = 0;
-		size_t pos;
+	if (limit == 0)
+		return false;
+
+	size_t buffered = getBuffered(hdl);
+
+	if (buffered <= limit && slowCount.load() == 0)
+		return false;
 
-		if ((pos = send.find("DEBUG:")) != string::npos)
+	std::lock_guard<std::mutex> lock(slowMut);
+	map<long, WS_SLOW_T>::iterator itr = slowPans.find(pan);
+
+	if (buffered <= limit)
+	{
+		// The browser caught up. The updates kept go out first.
+		if (itr != slowPans.end())
 		{
-			string text = send.substr(pos + 6);
-			appendToFile(text);
-			return;
+			flushPending(pan, itr->second);
+			slowPans.erase(itr);
+			slowCount--;
+			sysl->DebugMsg("WebSocket::backpressure: Browser of pan "+to_string(pan)+" caught up.");
 		}
 
-		if (send.find("REGISTER:") == string::npos)
-		{
-			vector<string> parts = Str::split(send, ":");
+		return false;
+	}
 
-			if (parts.size() > 0)
-				id = atoi(parts[1].c_str());
-		}
+	uint64_t now = Metrics::now();
 
-		if (!cbInit)
-		{
-			sysl->warnlog("WebSocket::on_message: No callback function registered!");
+	if (itr == slowPans.end())
+	{
+		WS_SLOW_T slow;
+		slow.hdl = hdl;
+		slow.since = now;
+		slow.frames = frames;
+		slow.bytes = bytes;
+		itr = slowPans.insert(pair<long, WS_SLOW_T>(pan, slow)).first;
+		slowCount++;
+		setSlowTimer(pan);
+		sysl->warnlog("WebSocket::backpressure: Browser of pan "+to_string(pan)+" is too slow ("+to_string(buffered)+" bytes buffered).");
+	}
+
+	if (buffered > limit * WS_DROP_FACTOR || (now - itr->second.since) > (uint64_t)Configuration->getWebSocketSlowTimeout() * 1000000)
+	{
+		slowPans.erase(itr);
+		slowCount--;
+		drop = true;
+		return true;
+	}
+
+	if (key == 0)
+		return false;
+
+	WS_PENDING_T& pend = itr->second.pending[key];
+
+	if (!pend.msg.empty())
+		coalesced->inc();
+
+	pend.msg = msg;
+	pend.binary = binary;
+	return true;
+}
+
+/*
+ * Sends all kept updates of a browser. slowMut must be locked.
+ * The batch collected for the browser goes out first. It holds older
+ * values than the kept updates.
+ */
+bool WebSocket::flushPending(long pan, WS_SLOW_T& slow)
+{
+	{
+		std::lock_guard<std::mutex> lock(batchMut);
+		map<long, WS_BATCH_T>::iterator bitr = batches.find(pan);
+
+		if (bitr != batches.end())
+			flushBatch(bitr->second);
+	}
+
+	try
+	{
+		map<uint64_t, WS_PENDING_T>::iterator itr;
+
+		for (itr = slow.pending.begin(); itr != slow.pending.end(); ++itr)
+			sendFrame(slow.hdl, itr->second.msg, itr->second.binary, slow.frames, slow.bytes);
+	}
+	catch (websocketpp::exception const & e)
+	{
+		sysl->errlog(string("WebSocket::flushPending: Error sending a message: ")+e.what());
+		slow.pending.clear();
+		return false;
+	}
+
+	slow.pending.clear();
+	return true;
+}
+
+void WebSocket::setSlowTimer(long pan)
+{
+	if (Configuration->getWSStatus())
+		sock_server.set_timer(WS_SLOW_CHECK, bind(&WebSocket::checkSlow, this, pan, ::_1));
+	else
+		sock_server_ws.set_timer(WS_SLOW_CHECK, bind(&WebSocket::checkSlow, this, pan, ::_1));
+}
+
+/*
+ * Called by a timer as long as a browser is too slow. The kept updates must
+ * reach the browser even if no new messages for it arrive.
+ */
+void WebSocket::checkSlow(long pan, websocketpp::lib::error_code const& ec)
+{
+	DECL_TRACTHR("WebSocket::checkSlow(long pan, websocketpp::lib::error_code const& ec)");
+
+	if (ec)
+		return;
+
+	connection_hdl hdl;
+
+	{
+		std::lock_guard<std::mutex> lock(slowMut);
+		map<long, WS_SLOW_T>::iterator itr = slowPans.find(pan);
+
+		if (itr == slowPans.end())
 			return;
-		}
 
-		if (!validKey && id >= 10000 && id <= 11000)
+		if (getBuffered(itr->second.hdl) <= Configuration->getWebSocketHighWater())
 		{
-			PAN_ID_T reg;
-			reg.channel = id;
-			reg.ID = random();
-			__regs.insert(pair<connection_hdl, PAN_ID_T>(hdl, reg));
-			sysl->DebugMsg("WebSocket::on_message: Registering id "+to_string(id)+" for pan "+to_string(reg.ID));
-			fcallRegister(reg.ID, id);
-			pan = reg.ID;
+			flushPending(pan, itr->second);
+			slowPans.erase(itr);
+			slowCount--;
+			return;
 		}
-		else if (validKey && id >= 10000 && id <= 11000 && key->second.channel == 0)
+
+		if ((Metrics::now() - itr->second.since) <= (uint64_t)Configuration->getWebSocketSlowTimeout() * 1000000)
 		{
-			pan = key->second.ID;
-			key->second.channel = id;
-			sysl->DebugMsg("WebSocket::on_message: Channel was set to "+to_string(id)+" for pan "+to_string(pan));
+			setSlowTimer(pan);
+			return;
 		}
-		else if (validKey)
-			pan = key->second.ID;
 
-		if (send.find("PANEL:") != string::npos)
-			return;
+		hdl = itr->second.hdl;
+		slowPans.erase(itr);
+		slowCount--;
+	}
+
+	dropSlow(hdl, pan);
+}
+
+/*
+ * Closes the connection of a browser which didn't read its frames for too
+ * long. The close handler cleans up the registration.
+ */
+void WebSocket::dropSlow(connection_hdl hdl, long pan)
+{
+	websocketpp::lib::error_code ec;
+	sysl->warnlog("WebSocket::dropSlow: Dropping the connection of pan "+to_string(pan)+" because the browser doesn't read its messages.");
+	slowDrops->inc();
+
+	if (Configuration->getWSStatus())
+		sock_server.close(hdl, websocketpp::close::status::policy_violation, "Client too slow", ec);
+	else
+		sock_server_ws.close(hdl, websocketpp::close::status::policy_violation, "Client too slow", ec);
 
-		fcall(send, pan);
+	if (ec)
+		sysl->errlog("WebSocket::dropSlow: "+ec.message());
+}
+
+/*
+ * Returns TRUE if the browser of the panel asked for binary frames and they
+ * are allowed by the configuration.
+ */
+bool WebSocket::isBinary(long pan)
+{
+	RwLockGuard lock(&websocketsLock, false);
+	REG_DATA_T::iterator itr = findPan(pan);
+
+	if (itr == __regs.end())
+		return false;
+
+	return itr->second.binary;
+}
+
+/*
+ * The connections are numbered densely: The lower PAN_INDEX_BITS of a pan
+ * are its position in the table panTable, the upper bits count up with
+ * every new connection. So a pan is found without searching, and a pan of
+ * a closed connection never matches the new connection at the same
+ * position. All methods below must be called with websocketsLock held.
+ */
+REG_DATA_T::iterator WebSocket::findPan(long pan)
+{
+	size_t idx = (size_t)(pan & PAN_INDEX_MASK);
+
+	if (pan <= 0 || idx >= panTable.size())
+		return __regs.end();
+
+	REG_DATA_T::iterator itr = panTable[idx];
+
+	if (itr == __regs.end() || itr->second.ID != pan)
+		return __regs.end();
+
+	return itr;
+}
+
+REG_DATA_T::iterator WebSocket::addConnection(connection_hdl hdl, int channel)
+{
+	DECL_TRACER("WebSocket::addConnection(websocketpp::connection_hdl hdl, int channel)");
+
+	size_t idx;
+
+	if (!panFree.empty())
+	{
+		idx = panFree.back();
+		panFree.pop_back();
 	}
-	catch (websocketpp::exception const& s)
+	else if (panTable.size() <= PAN_INDEX_MASK)
 	{
-		sysl->errlog("WebSocket::on_message: WebSocket error: "+string(s.what()));
+		idx = panTable.size();
+		panTable.push_back(__regs.end());
 	}
-	catch (std::exception& e)
+	else
 	{
-		sysl->errlog("WebSocket::on_message: "+string(e.what()));
+		sysl->errlog("WebSocket::addConnection: Too many connections!");
+		return __regs.end();
 	}
+
+	panGeneration = (panGeneration + 1) & PAN_GEN_MASK;
+
+	if (panGeneration == 0)
+		panGeneration = 1;
+
+	PAN_ID_T pid;
+	pid.ID = (panGeneration << PAN_INDEX_BITS) | (long)idx;
+	pair<REG_DATA_T::iterator, bool> ptr = __regs.insert(pair<connection_hdl, PAN_ID_T>(hdl, pid));
+
+	if (!ptr.second)
+	{
+		panFree.push_back(idx);
+		return ptr.first;
+	}
+
+	panTable[idx] = ptr.first;
+	setChannel(ptr.first->second, channel);
+	return ptr.first;
 }
 
-void WebSocket::on_message_ws(server_ws* s, connection_hdl hdl, message_ptr msg)
+/*
+ * Removes the connection and returns its pan or 0 if it was not known.
+ */
+long WebSocket::removeConnection(connection_hdl hdl)
 {
-	DECL_TRACER("WebSocket::on_message_ws(server_ws* s, websocketpp::connection_hdl hdl, message_ptr msg)");
+	DECL_TRACER("WebSocket::removeConnection(websocketpp::connection_hdl hdl)");
 
-	try
+	REG_DATA_T::iterator key = __regs.find(hdl);
+
+	if (key == __regs.end())
+		return 0;
+
+	long pan = key->second.ID;
+	size_t idx = (size_t)(pan & PAN_INDEX_MASK);
+
+	if (idx < panTable.size() && panTable[idx] == key)
 	{
-		REG_DATA_T::iterator key;
-		bool validKey = false;
-		key = __regs.find(hdl);
+		panTable[idx] = __regs.end();
+		panFree.push_back(idx);
+	}
 
-		if (key != __regs.end())
-			validKey = true;
+	__regs.erase(key);
 
-		if (validKey)
-			setConStatus(true, key->second.ID);
+	{
+		std::lock_guard<std::mutex> lock(slowMut);
 
-		server_hdl = hdl;
-		server_ws::connection_ptr con = s->get_con_from_hdl(hdl);
+		if (slowPans.erase(pan) > 0)
+			slowCount--;
+	}
 
-		if (validKey && key->second.ip.length() == 0)
-		{
-			string ip = con->get_remote_endpoint();
-			key->second.ip = cutIpAddress(ip);
-			sysl->DebugMsg("WebSocket::on_message_ws: Endpoint: "+key->second.ip);
-		}
+	{
+		std::lock_guard<std::mutex> lock(batchMut);
+		batches.erase(pan);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(levelMut);
+		levels.erase(pan);
+	}
+
+	return pan;
+}
+
+/*
+ * Sets the channel of a connection and the counters for the frames sent to
+ * it. Connections without a channel are only counted in the total.
+ */
+void WebSocket::setChannel(PAN_ID_T& pid, int channel)
+{
+	pid.channel = channel;
+
+	if (channel <= 0)
+	{
+		pid.frames = pid.bytes = nullptr;
+		return;
+	}
 
-		string send = msg->get_payload();
-		sysl->TRACE("WebSocket::on_message_ws: Called with hdl: message: "+send);
-		int id = 0;
-		long pan = 0;
-		size_t pos;
+	string lbl = Metrics::panelLabel(channel);
+	pid.frames = Metrics::get().counter("amxpanel_websocket_frames_total", lbl, "Websocket frames sent to the browsers of a panel");
+	pid.bytes = Metrics::get().counter("amxpanel_websocket_bytes_total", lbl, "Bytes sent to the browsers of a panel");
+}
 
-		if ((pos = send.find("DEBUG:")) != string::npos)
+/*
+ * A browser lists the extensions of the protocol it understands:
+ * "PROTO:BIN" asks for binary frames, "PROTO:BATCH" for batches of
+ * messages. There is no answer. As long as the server doesn't use an
+ * extension, the browser gets plain text messages, so an older server or one
+ * with the extensions disabled simply keeps the text protocol.
+ */
+void WebSocket::setProtocol(PAN_ID_T& pid, const WsMessage& wm)
+{
+	DECL_TRACER("WebSocket::setProtocol(PAN_ID_T& pid, const WsMessage& wm)");
+
+	pid.binary = false;
+	pid.batch = false;
+
+	for (size_t i = 1; i < wm.size(); i++)
+	{
+		if (wm.field(i) == "BIN" && Configuration->getWebSocketBinary())
 		{
-			string text = send.substr(pos + 6);
-			appendToFile(text);
-			return;
+			pid.binary = true;
+			sysl->DebugMsg("WebSocket::setProtocol: Pan "+to_string(pid.ID)+" uses binary frames.");
+		}
+		else if (wm.field(i) == "BATCH" && Configuration->getWebSocketBatchTime() > 0)
+		{
+			pid.batch = true;
+			sysl->DebugMsg("WebSocket::setProtocol: Pan "+to_string(pid.ID)+" gets batches of messages.");
 		}
+	}
+}
+
+void WebSocket::tcp_post_init(connection_hdl hdl)
+{
+	DECL_TRACER("WebSocket::tcp_post_init(websocketpp::connection_hdl hdl)");
+
+	if (!cbInitRegister)
+	{
+		sysl->errlog("WebSocket::tcp_post_init: Callback function for registering web socket connection was not initialized!");
+		return;
+	}
+
+	string ip;
+	long pan = 0;
+
+	try
+	{
+		if (Configuration->getWSStatus())
+			ip = sock_server.get_con_from_hdl(hdl)->get_remote_endpoint();
+		else
+			ip = sock_server_ws.get_con_from_hdl(hdl)->get_remote_endpoint();
 
-		if (send.find_first_of("REGISTER:") == string::npos)
 		{
-			vector<string> parts = Str::split(send, ":");
+			RwLockGuard lock(&websocketsLock, true);
+			REG_DATA_T::iterator key = addConnection(hdl, 0);
 
-			if (parts.size() > 0)
-				id = atoi(parts[1].c_str());
+			if (key == __regs.end())
+				return;
+
+			key->second.ip = cutIpAddress(ip);
+			pan = key->second.ID;
+			sysl->DebugMsg("WebSocket::tcp_post_init: Registering pan "+to_string(pan)+" for remote "+key->second.ip);
 		}
 
-		if (!cbInit)
+		fcallRegister(pan, 0);
+	}
+	catch (websocketpp::exception const& s)
+	{
+		sysl->errlog("WebSocket::tcp_post_init: WebSocket error: "+string(s.what()));
+	}
+	catch (std::exception& e)
+	{
+		sysl->errlog("WebSocket::tcp_post_init: "+string(e.what()));
+	}
+}
+
+/*
+ * Handles a message of a browser for both kinds of servers. The connection
+ * table is changed under the write lock, but the callbacks into the class
+ * TouchPanel are called without any lock, because they send messages and
+ * therefore need the read lock.
+ */
+template<typename S>
+void WebSocket::handleMessage(S *s, connection_hdl hdl, message_ptr msg)
+{
+	DECL_TRACER("WebSocket::handleMessage(S *s, websocketpp::connection_hdl hdl, message_ptr msg)");
+
+	const string& payload = msg->get_payload();
+	WsMessage wm(payload);
+	WS_COMMAND cmd = wm.getCommand();
+	int id = 0;
+	long pan = 0;
+	int channel = 0;
+	bool validKey = false;
+	bool newPan = false;
+
+	if (cmd != WC_REGISTER && cmd != WC_DEBUG && cmd != WC_PROTO)
+		id = wm.getInt(1);
+
+	{
+		RwLockGuard lock(&websocketsLock, true);
+		REG_DATA_T::iterator key = __regs.find(hdl);
+
+		if (key != __regs.end())
 		{
-			sysl->warnlog("WebSocket::on_message_ws: No callback function registered!");
-			return;
+			validKey = true;
+
+			if (key->second.ip.length() == 0)
+			{
+				string ip = s->get_con_from_hdl(hdl)->get_remote_endpoint();
+				key->second.ip = cutIpAddress(ip);
+				sysl->DebugMsg("WebSocket::handleMessage: Endpoint: "+key->second.ip);
+			}
+
+			if (cmd == WC_PROTO)
+				setProtocol(key->second, wm);
 		}
 
-		if (id >= 10000 && id <= 11000 && !validKey)
+		if (cbInit && cmd != WC_DEBUG && cmd != WC_PROTO)
 		{
-			PAN_ID_T reg;
-			reg.channel = id;
-			reg.ID = random();
-			__regs.insert(pair<connection_hdl, PAN_ID_T>(hdl, reg));
-			sysl->DebugMsg("WebSocket::on_message_ws: Registering id "+to_string(id)+" for pan "+to_string(reg.ID));
-			fcallRegister(reg.ID, id);
-			pan = reg.ID;
+			if (!validKey && id >= 10000 && id <= 11000)
+			{
+				key = addConnection(hdl, id);
+
+				if (key != __regs.end())
+				{
+					newPan = true;
+					sysl->DebugMsg("WebSocket::handleMessage: Registering id "+to_string(id)+" for pan "+to_string(key->second.ID));
+				}
+			}
+			else if (validKey && id >= 10000 && id <= 11000 && key->second.channel == 0)
+			{
+				setChannel(key->second, id);
+				sysl->DebugMsg("WebSocket::handleMessage: Channel was set to "+to_string(id)+" for pan "+to_string(key->second.ID));
+			}
 		}
-		else if (validKey && id >= 10000 && id <= 11000 && key->second.channel == 0)
+
+		if (key != __regs.end())
 		{
 			pan = key->second.ID;
-			key->second.channel = id;
-			sysl->DebugMsg("WebSocket::on_message_ws: Channel was set to "+to_string(id)+" for pan "+to_string(pan));
+			channel = key->second.channel;
 		}
-		else if (validKey)
-			pan = key->second.ID;
+	}
 
-		if (send.find("PANEL:") != string::npos)
-			return;
+	if (validKey)
+		setConStatus(true, pan);
+
+	AMX_PROBE3(ws_receive, pan, payload.length(), payload.c_str());
+	TRACER("WebSocket::handleMessage: Called with hdl: message: "+payload);
+
+	if (cmd == WC_DEBUG)
+	{
+		appendToFile(string(wm.rest(1)));
+		return;
+	}
+
+	if (cmd == WC_PROTO)
+		return;
 
-		fcall(send, pan);
+	if (!cbInit)
+	{
+		sysl->warnlog("WebSocket::handleMessage: No callback function registered!");
+		return;
+	}
+
+	if (newPan)
+		fcallRegister(pan, id);
+
+	TraceTag traceTag((validKey ? channel : id), pan);
+
+	if (cmd == WC_PANEL)
+		return;
+
+	fcall(wm, pan);
+}
+
+// Define a callback to handle incoming messages
+void WebSocket::on_message(server* s, connection_hdl hdl, message_ptr msg)
+{
+	DECL_TRACER("WebSocket::on_message(server* s, websocketpp::connection_hdl hdl, message_ptr msg)");
+
+	try
+	{
+		handleMessage(s, hdl, msg);
+	}
+	catch (websocketpp::exception const& s)
+	{
+		sysl->errlog("WebSocket::on_message: WebSocket error: "+string(s.what()));
+	}
+	catch (std::exception& e)
+	{
+		sysl->errlog("WebSocket::on_message: "+string(e.what()));
+	}
+}
+
+void WebSocket::on_message_ws(server_ws* s, connection_hdl hdl, message_ptr msg)
+{
+	DECL_TRACER("WebSocket::on_message_ws(server_ws* s, websocketpp::connection_hdl hdl, message_ptr msg)");
+
+	try
+	{
+		handleMessage(s, hdl, msg);
 	}
 	catch (websocketpp::exception const& s)
 	{
@@ -510,7 +1223,6 @@ void WebSocket::on_message_ws(server_ws* s, connection_hdl hdl, message_ptr msg)
 void WebSocket::on_fail(server* s, connection_hdl hdl)
 {
 	DECL_TRACER("WebSocket::on_fail(server* s, websocketpp::connection_hdl hdl)");
-	server_hdl = hdl;
 	long pan = 0;
 
 	try
@@ -525,10 +1237,10 @@ void WebSocket::on_fail(server* s, connection_hdl hdl)
 		if (ec)
 			sysl->errlog(string("WebSocket::on_fail: ")+ec.message());
 
-		REG_DATA_T::iterator key = __regs.find(hdl);
-
-		if (key != __regs.end())
-			__regs.erase(key);
+		{
+			RwLockGuard lock(&websocketsLock, true);
+			removeConnection(hdl);
+		}
 
 		fcallRegister(pan, -1);
 	}
@@ -545,7 +1257,6 @@ void WebSocket::on_fail(server* s, connection_hdl hdl)
 void WebSocket::on_fail_ws(server_ws* s, connection_hdl hdl)
 {
 	DECL_TRACER("WebSocket::on_fail_ws(server_ws* s, websocketpp::connection_hdl hdl)");
-	server_hdl = hdl;
 
 	try
 	{
@@ -559,10 +1270,10 @@ void WebSocket::on_fail_ws(server_ws* s, connection_hdl hdl)
 		if (ec)
 			sysl->errlog(string("WebSocket::on_fail_ws: ")+ec.message());
 
-		REG_DATA_T::iterator key = __regs.find(hdl);
-
-		if (key != __regs.end())
-			__regs.erase(key);
+		{
+			RwLockGuard lock(&websocketsLock, true);
+			removeConnection(hdl);
+		}
 
 		fcallRegister(pan, -1);
 	}
@@ -579,7 +1290,6 @@ void WebSocket::on_fail_ws(server_ws* s, connection_hdl hdl)
 void WebSocket::on_close(connection_hdl hdl)
 {
 	DECL_TRACER("WebSocket::on_close(websocketpp::connection_hdl)");
-	server_hdl = hdl;
 	long pan = getPanelID(hdl);
 	setConStatus(false, pan);
 	websocketpp::lib::error_code ec;
@@ -594,13 +1304,13 @@ void WebSocket::on_close(connection_hdl hdl)
 		if (ec)
 			sysl->errlog(string("WebSocket::on_close: ")+ec.message());
 
-		REG_DATA_T::iterator key = __regs.find(hdl);
-
-		if (key != __regs.end())
-			__regs.erase(key);
+		{
+			RwLockGuard lock(&websocketsLock, true);
+			removeConnection(hdl);
+		}
 
 		fcallRegister(pan, -1);
-		sysl->TRACE("WebSocket::on_close: Connection for pan "+to_string(pan)+" terminated.", true);
+		TRACER("WebSocket::on_close: Connection for pan "+to_string(pan)+" terminated.", true);
 	}
 	catch (websocketpp::exception const& s)
 	{
@@ -616,9 +1326,8 @@ context_ptr WebSocket::on_tls_init(tls_mode mode, connection_hdl hdl)
 {
 	DECL_TRACER("WebSocket::on_tls_init(tls_mode mode, websocketpp::connection_hdl hdl)");
 	namespace asio = websocketpp::lib::asio;
-	server_hdl = hdl;
 
-	sysl->TRACE(string("WebSocket::on_tls_init: Using TLS mode: ")+(mode == MOZILLA_MODERN ? "Mozilla Modern" : "Mozilla Intermediate"));
+	TRACER(string("WebSocket::on_tls_init: Using TLS mode: ")+(mode == MOZILLA_MODERN ? "Mozilla Modern" : "Mozilla Intermediate"));
 
 	context_ptr ctx = websocketpp::lib::make_shared<asio::ssl::context>(asio::ssl::context::sslv23);
 
@@ -644,16 +1353,16 @@ context_ptr WebSocket::on_tls_init(tls_mode mode, connection_hdl hdl)
 		if (!Configuration->getSSHPassword().empty())
 			ctx->set_password_callback(bind(&WebSocket::getPassword, this));
 
-		sysl->TRACE("WebSocket::on_tls_init: Reading certificate chain file: "+Configuration->getSSHServerFile());
+		TRACER("WebSocket::on_tls_init: Reading certificate chain file: "+Configuration->getSSHServerFile());
 		ctx->use_certificate_chain_file(Configuration->getSSHServerFile());
-		sysl->TRACE("WebSocket::on_tls_init: Reading private key file: "+Configuration->getSSHServerFile());
+		TRACER("WebSocket::on_tls_init: Reading private key file: "+Configuration->getSSHServerFile());
 		ctx->use_private_key_file(Configuration->getSSHServerFile(), asio::ssl::context::pem);
 
 		// Example method of generating this file:
 		// `openssl dhparam -out dh.pem 2048`
 		// Mozilla Intermediate suggests 1024 as the minimum size to use
 		// Mozilla Modern suggests 2048 as the minimum size to use.
-		sysl->TRACE("WebSocket::on_tls_init: Reading DH parameter file: "+Configuration->getSSHDHFile());
+		TRACER("WebSocket::on_tls_init: Reading DH parameter file: "+Configuration->getSSHDHFile());
 		ctx->use_tmp_dh_file(Configuration->getSSHDHFile());
 
 		string ciphers;
@@ -693,6 +1402,7 @@ long WebSocket::getPanelID(websocketpp::connection_hdl hdl)
 	if (hdl.expired())
 		return 0;
 
+	RwLockGuard lock(&websocketsLock, false);
 	REG_DATA_T::iterator key;
 
 	if ((key = __regs.find(hdl)) != __regs.end())
@@ -701,17 +1411,15 @@ long WebSocket::getPanelID(websocketpp::connection_hdl hdl)
 	return 0;
 }
 
-string WebSocket::getIP(int pan)
+string WebSocket::getIP(long pan)
 {
-	DECL_TRACER("WebSocket::getIP(int pan)");
+	DECL_TRACER("WebSocket::getIP(long pan)");
 
-	REG_DATA_T::iterator key;
+	RwLockGuard lock(&websocketsLock, false);
+	REG_DATA_T::iterator key = findPan(pan);
 
-	for (key = __regs.begin(); key != __regs.end(); ++key)
-	{
-		if (key->second.ID == pan)
-			return key->second.ip;
-	}
+	if (key != __regs.end())
+		return key->second.ip;
 
 	return "";
 }
@@ -734,6 +1442,7 @@ void WebSocket::appendToFile(const std::string& str)
 	if (Configuration->getClientLog().length() == 0)
 		return;
 
+	std::lock_guard<std::mutex> lock(mut);
 	DateTime dt;
 	std::fstream file;
 	std::string lvl;
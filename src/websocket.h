@@ -26,9 +26,69 @@
 #include <websocketpp/server.hpp>
 #include <atomic>
 #include <map>
+#include <vector>
+#include <climits>
+#include "metrics.h"
+#include "wsmessage.h"
 
+#ifdef _DEFLATE
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+
+namespace amx
+{
+	bool deflateEnabled();
+	int deflateWindowBits();
+	void deflateWindowError(const char *side, const websocketpp::lib::error_code& ec);
+
+	/*
+	 * The permessage-deflate extension of websocketpp with the limits of the
+	 * configuration. The size of the LZ77 window is the memory zlib needs
+	 * per connection and direction, so it is negotiated down to
+	 * DeflateWindowBits. With WebSocketDeflate=0 the extension is not
+	 * offered at all.
+	 */
+	template <typename config>
+	class DeflateExtension : public websocketpp::extensions::permessage_deflate::enabled<config>
+	{
+		public:
+			DeflateExtension()
+			{
+				uint8_t bits = (uint8_t)deflateWindowBits();
+				websocketpp::lib::error_code ec;
+
+				ec = this->set_server_max_window_bits(bits, websocketpp::extensions::permessage_deflate::mode::smallest);
+
+				if (ec)
+					deflateWindowError("server", ec);
+
+				ec = this->set_client_max_window_bits(bits, websocketpp::extensions::permessage_deflate::mode::smallest);
+
+				if (ec)
+					deflateWindowError("client", ec);
+			}
+
+			bool is_implemented() const { return deflateEnabled(); }
+	};
+
+	struct asio_tls_deflate : public websocketpp::config::asio_tls
+	{
+		typedef asio_tls_deflate type;
+		typedef DeflateExtension<websocketpp::config::asio_tls::permessage_deflate_config> permessage_deflate_type;
+	};
+
+	struct asio_deflate : public websocketpp::config::asio
+	{
+		typedef asio_deflate type;
+		typedef DeflateExtension<websocketpp::config::asio::permessage_deflate_config> permessage_deflate_type;
+	};
+}
+
+typedef websocketpp::server<amx::asio_tls_deflate> server;
+typedef websocketpp::server<amx::asio_deflate> server_ws;
+#else
 typedef websocketpp::server<websocketpp::config::asio_tls> server;
 typedef websocketpp::server<websocketpp::config::asio> server_ws;
+#endif
 
 // pull out the type of messages sent by our config
 typedef websocketpp::config::asio::message_type::ptr message_ptr;
@@ -41,26 +101,92 @@ namespace amx
 		int channel{0};
 		long ID{0};
 		std::string ip;
+		Counter *frames{nullptr};	// Frames sent to the panel
+		Counter *bytes{nullptr};	// Bytes sent to the panel
+		bool binary{false};			// TRUE = The browser understands binary frames
+		bool batch{false};			// TRUE = The browser unpacks batches of messages
 	}PAN_ID_T;
 
 	typedef std::map<websocketpp::connection_hdl, PAN_ID_T, std::owner_less<websocketpp::connection_hdl> > REG_DATA_T;
 
+	/*
+	 * A connection whose browser doesn't read the frames fast enough. As
+	 * long as more than WebSocketHighWater bytes wait to be written, updates
+	 * of channels and levels are kept here. A newer value of the same
+	 * channel or level replaces the older one. They are sent when the
+	 * browser has caught up.
+	 */
+	typedef struct WS_PENDING_T
+	{
+		std::string msg;
+		bool binary{false};
+	}WS_PENDING_T;
+
+	typedef struct WS_SLOW_T
+	{
+		websocketpp::connection_hdl hdl;
+		std::map<uint64_t, WS_PENDING_T> pending;	// Update key --> latest message
+		uint64_t since{0};							// Time in µs the browser fell behind
+		Counter *frames{nullptr};
+		Counter *bytes{nullptr};
+	}WS_SLOW_T;
+
+	/*
+	 * The messages collected for a browser during WebSocketBatchTime
+	 * milliseconds. They are sent as one frame (see WsFrame::batch()).
+	 */
+	typedef struct WS_BATCH_T
+	{
+		websocketpp::connection_hdl hdl;
+		std::vector<std::string> msgs;
+		std::string buf;							// The batch frame, reused
+		size_t size{0};								// Sum of the lengths of msgs
+		bool binary{false};							// TRUE = msgs are binary frames
+		bool timer{false};							// TRUE = A timer will send the batch
+		Counter *frames{nullptr};
+		Counter *bytes{nullptr};
+	}WS_BATCH_T;
+
+	/*
+	 * The rate limit of a level sent to a browser. A value arriving before
+	 * the interval of the level is over, is kept until then. A newer value
+	 * replaces it.
+	 */
+	typedef struct WS_LEVEL_T
+	{
+		uint64_t last{0};							// Time in µs the last value was sent
+		WS_PENDING_T pending;						// Latest value not sent yet
+		bool timer{false};							// TRUE = A timer will send pending
+	}WS_LEVEL_T;
+
+	#define WS_BATCH_MAX	16384		// Maximum size of a batch in bytes
+	#define WS_KEY_CHANNEL	1			// Key type: Channel feedback
+	#define WS_KEY_LEVEL	2			// Key type: Level value
+	#define WS_SLOW_CHECK	100			// Milliseconds between the checks of a slow browser
+	#define WS_DROP_FACTOR	8			// Dropped at once if more than WebSocketHighWater * WS_DROP_FACTOR are buffered
+
+	#define PAN_INDEX_BITS	16
+	#define PAN_INDEX_MASK	((1L << PAN_INDEX_BITS) - 1)
+	#define PAN_GEN_MASK	(LONG_MAX >> PAN_INDEX_BITS)
+
 	class WebSocket
 	{
 		public:
 			WebSocket();
 			~WebSocket();
 
-			void regCallback(std::function<void(std::string&, long)> func);
+			void regCallback(std::function<void(const WsMessage&, long)> func);
 			void regCallbackStop(std::function<void()> func);
 			void regCallbackConnected(std::function<void(bool, long)> func);
 			void regCallbackRegister(std::function<void(long, int)> func);
 			void run();
-			bool send(std::string& msg, long pan);
+			bool send(std::string& msg, long pan, bool binary = false, uint64_t key = 0);
+			static uint64_t updateKey(int type, int port, int num);
+			bool isBinary(long pan);
 			server& getServer() { return sock_server; }
 			server_ws& getServer_ws() { return sock_server_ws; }
 			void setConStatus(bool s, long pan);
-			std::string getIP(int pan);
+			std::string getIP(long pan);
 
 			enum tls_mode
 			{
@@ -80,11 +206,30 @@ namespace amx
 			long getPanelID(websocketpp::connection_hdl hdl);
 			std::string cutIpAddress(std::string& addr);
 			void appendToFile(const std::string& str);
+			void setProtocol(PAN_ID_T& pid, const WsMessage& wm);
+			template<typename S> void runThreads(S& srv);
+			template<typename S> void handleMessage(S *s, websocketpp::connection_hdl hdl, message_ptr msg);
+			REG_DATA_T::iterator findPan(long pan);
+			REG_DATA_T::iterator addConnection(websocketpp::connection_hdl hdl, int channel);
+			long removeConnection(websocketpp::connection_hdl hdl);
+			void setChannel(PAN_ID_T& pid, int channel);
+			void sendFrame(websocketpp::connection_hdl hdl, std::string& msg, bool binary, Counter *frames, Counter *bytes);
+			size_t getBuffered(websocketpp::connection_hdl hdl);
+			bool backpressure(websocketpp::connection_hdl hdl, long pan, std::string& msg, bool binary, uint64_t key, Counter *frames, Counter *bytes, bool& drop);
+			bool flushPending(long pan, WS_SLOW_T& slow);
+			void checkSlow(long pan, websocketpp::lib::error_code const& ec);
+			void setSlowTimer(long pan);
+			void dropSlow(websocketpp::connection_hdl hdl, long pan);
+			bool sendMsg(std::string& msg, long pan, bool binary, uint64_t key, bool limit);
+			bool throttle(long pan, std::string& msg, bool binary, uint64_t key);
+			void levelTimer(long pan, uint64_t key, websocketpp::lib::error_code const& ec);
+			bool addBatch(websocketpp::connection_hdl hdl, long pan, std::string& msg, bool binary, Counter *frames, Counter *bytes);
+			void flushBatch(WS_BATCH_T& b);
+			void batchTimer(long pan, websocketpp::lib::error_code const& ec);
 
-			std::mutex mut;
+			std::mutex mut;								// Serializes the client log
 			server sock_server;
 			server_ws sock_server_ws;
-			websocketpp::connection_hdl server_hdl;
 			pthread_rwlock_t websocketsLock;
 			std::atomic<int> repeatCount{0};
 
@@ -92,11 +237,25 @@ namespace amx
 			bool cbInitStop{false};
 			bool cbInitCon{false};
 			bool cbInitRegister{false};
-			std::function<void(std::string&, long)> fcall{nullptr};
+			std::function<void(const WsMessage&, long)> fcall{nullptr};
 			std::function<void()> fcallStop{nullptr};
 			std::function<void(bool, long)> fcallConn{nullptr};
 			std::function<void(long, int)> fcallRegister{nullptr};
-			REG_DATA_T __regs;
+			REG_DATA_T __regs;							// Protected by websocketsLock
+			std::vector<REG_DATA_T::iterator> panTable;	// Pan index --> connection
+			std::vector<size_t> panFree;				// Free positions in panTable
+			long panGeneration{0};
+			Counter *framesAll{nullptr};
+			Counter *bytesAll{nullptr};
+			std::mutex slowMut;							// Protects slowPans
+			std::map<long, WS_SLOW_T> slowPans;			// Pan --> browser which fell behind
+			std::atomic<int> slowCount{0};				// Number of entries in slowPans
+			std::mutex batchMut;						// Protects batches
+			std::map<long, WS_BATCH_T> batches;			// Pan --> messages not sent yet
+			std::mutex levelMut;						// Protects levels
+			std::map<long, std::map<uint64_t, WS_LEVEL_T> > levels;	// Pan --> level key --> rate limit
+			Counter *coalesced{nullptr};
+			Counter *slowDrops{nullptr};
 	};
 }
 
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <charconv>
+#include <cstring>
+#include "wsmessage.h"
+#include "xmltags.h"
+
+using namespace std;
+using namespace amx;
+
+amx::WsMessage::WsMessage(const string& msg)
+	: message(msg),
+	  body(msg)
+{
+	size_t pos = body.find(':');
+	string_view cmd = body.substr(0, pos);
+
+	// The command is the part in front of the first colon. Only one
+	// switch is needed to find it.
+	switch (tagHash(cmd.data(), cmd.length()))
+	{
+		case "REGISTER"_tag:	command = WC_REGISTER; break;
+		case "PANEL"_tag:		command = WC_PANEL; break;
+		case "DEBUG"_tag:		command = WC_DEBUG; break;
+		case "PROTO"_tag:		command = WC_PROTO; break;
+		case "PUSH"_tag:		command = WC_PUSH; break;
+		case "LEVEL"_tag:		command = WC_LEVEL; break;
+		case "PING"_tag:		command = WC_PING; break;
+		case "KEY"_tag:			command = WC_KEY; break;
+		case "STRING"_tag:		command = WC_STRING; break;
+		case "CUSTOM"_tag:		command = WC_CUSTOM; break;
+		default:				command = WC_UNKNOWN;
+	}
+
+	// The text of a debug message is taken as it is.
+	if (command != WC_DEBUG && !body.empty() && body.back() == ';')
+		body.remove_suffix(1);
+
+	size_t start = 0;
+
+	while (count < WS_MAX_FIELDS)
+	{
+		pos = body.find(':', start);
+
+		if (pos == string_view::npos || count == WS_MAX_FIELDS - 1)
+		{
+			fields[count++] = body.substr(start);
+			break;
+		}
+
+		fields[count++] = body.substr(start, pos - start);
+		start = pos + 1;
+	}
+}
+
+string_view amx::WsMessage::field(size_t idx) const
+{
+	if (idx >= count)
+		return string_view();
+
+	return fields[idx];
+}
+
+/*
+ * Returns the message starting with the field \a idx up to the end,
+ * including all colons. This is used for the free text of a message, which
+ * may contain colons itself.
+ */
+string_view amx::WsMessage::rest(size_t idx) const
+{
+	if (idx >= count)
+		return string_view();
+
+	return body.substr(fields[idx].data() - body.data());
+}
+
+int amx::WsMessage::getInt(size_t idx) const
+{
+	return (int)getLong(idx);
+}
+
+long amx::WsMessage::getLong(size_t idx) const
+{
+	string_view f = field(idx);
+	long value = 0;
+
+	while (!f.empty() && f.front() == ' ')
+		f.remove_prefix(1);
+
+	if (!f.empty() && f.front() == '+')
+		f.remove_prefix(1);
+
+	from_chars(f.data(), f.data() + f.length(), value);
+	return value;
+}
+
+/*
+ * WsFrame
+ *
+ * The frame is written into the buffer given by the caller. Because the
+ * buffer keeps its capacity, a buffer used again and again doesn't allocate
+ * any memory after the first few frames.
+ */
+void amx::WsFrame::header(string& buf, WS_BIN_TYPE type, int panel, int port)
+{
+	buf.clear();
+	buf.push_back((char)type);
+	put16(buf, (uint16_t)panel);
+	put16(buf, (uint16_t)port);
+}
+
+void amx::WsFrame::put16(string& buf, uint16_t v)
+{
+	buf.push_back((char)(v >> 8));
+	buf.push_back((char)(v & 0xff));
+}
+
+void amx::WsFrame::put32(string& buf, uint32_t v)
+{
+	put16(buf, (uint16_t)(v >> 16));
+	put16(buf, (uint16_t)(v & 0xffff));
+}
+
+void amx::WsFrame::put64(string& buf, uint64_t v)
+{
+	put32(buf, (uint32_t)(v >> 32));
+	put32(buf, (uint32_t)(v & 0xffffffff));
+}
+
+void amx::WsFrame::channel(string& buf, WS_BIN_TYPE type, int panel, int port, int channel)
+{
+	header(buf, type, panel, port);
+	put16(buf, (uint16_t)channel);
+}
+
+void amx::WsFrame::level(string& buf, int panel, int port, int level, int32_t value)
+{
+	header(buf, WB_LEVEL_INT, panel, port);
+	put16(buf, (uint16_t)level);
+	put32(buf, (uint32_t)value);
+}
+
+void amx::WsFrame::level(string& buf, int panel, int port, int level, double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	header(buf, WB_LEVEL_FLOAT, panel, port);
+	put16(buf, (uint16_t)level);
+	put64(buf, bits);
+}
+
+void amx::WsFrame::command(string& buf, int panel, int port, const string& cmd)
+{
+	header(buf, WB_COMMAND, panel, port);
+	buf.append(cmd);
+}
+
+/*
+ * Puts several binary frames into one. No frame may be longer than 65535
+ * bytes.
+ */
+void amx::WsFrame::batch(string& buf, const vector<string>& frames)
+{
+	buf.clear();
+	buf.push_back((char)WB_BATCH);
+
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		put16(buf, (uint16_t)frames[i].length());
+		buf.append(frames[i]);
+	}
+}
+
+/*
+ * Puts several text messages into one JSON array of strings.
+ */
+void amx::WsFrame::batchText(string& buf, const vector<string>& msgs)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	buf.clear();
+	buf.push_back('[');
+
+	for (size_t i = 0; i < msgs.size(); i++)
+	{
+		if (i > 0)
+			buf.push_back(',');
+
+		buf.push_back('"');
+
+		for (size_t j = 0; j < msgs[i].length(); j++)
+		{
+			unsigned char ch = (unsigned char)msgs[i][j];
+
+			switch (ch)
+			{
+				case '"':	buf.append("\\\""); break;
+				case '\\':	buf.append("\\\\"); break;
+				case '\n':	buf.append("\\n"); break;
+				case '\r':	buf.append("\\r"); break;
+				case '\t':	buf.append("\\t"); break;
+
+				default:
+					if (ch < 0x20)
+					{
+						buf.append("\\u00");
+						buf.push_back(hex[ch >> 4]);
+						buf.push_back(hex[ch & 0x0f]);
+					}
+					else
+						buf.push_back((char)ch);
+			}
+		}
+
+		buf.push_back('"');
+	}
+
+	buf.push_back(']');
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __WSMESSAGE_H__
+#define __WSMESSAGE_H__
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace amx
+{
+	/*
+	 * The commands a browser sends over the websocket.
+	 */
+	enum WS_COMMAND
+	{
+		WC_UNKNOWN,
+		WC_REGISTER,	// REGISTER:<regID>;
+		WC_PANEL,		// PANEL:<panelID>:<regID>
+		WC_DEBUG,		// DEBUG:<text>
+		WC_PROTO,		// PROTO:<protocol>[:<protocol>...]
+		WC_PUSH,		// PUSH:<panelID>:<port>:<channel>:<value>;
+		WC_LEVEL,		// LEVEL:<panelID>:<port>:<level>:<value>;
+		WC_PING,		// PING:<panelID>:<counter>:<time>[:<rtt>];
+		WC_KEY,			// KEY:<panelID>:<port>:<channel>:<string>;
+		WC_STRING,		// STRING:<panelID>:<port>:<channel>:<string>;
+		WC_CUSTOM		// CUSTOM:<panelID>:<port>:<channel>:<flag>:<type>:<value1>:<value2>:<value3>:<dType>:<data>;
+	};
+
+	#define WS_MAX_FIELDS	16
+
+	/*
+	 * A message received from a browser, split into its fields. The message
+	 * is parsed only once, when it arrives, and then handed over to all
+	 * layers which need it. The fields are views into the original payload,
+	 * so parsing allocates nothing, but the payload must live as long as
+	 * the object.
+	 *
+	 * A trailing ';' is not part of the fields. If a message has more than
+	 * WS_MAX_FIELDS fields, the last field holds the rest of the message.
+	 */
+	class WsMessage
+	{
+		public:
+			explicit WsMessage(const std::string& msg);
+
+			WS_COMMAND getCommand() const { return command; }
+			const std::string& getMessage() const { return message; }
+			size_t size() const { return count; }
+			std::string_view field(size_t idx) const;
+			std::string_view rest(size_t idx) const;
+			int getInt(size_t idx) const;
+			long getLong(size_t idx) const;
+
+		private:
+			const std::string& message;
+			std::string_view body;
+			std::string_view fields[WS_MAX_FIELDS];
+			size_t count{0};
+			WS_COMMAND command{WC_UNKNOWN};
+	};
+
+	/*
+	 * The binary frames sent to a browser which asked for them with
+	 * "PROTO:BIN". All numbers are in network byte order. Every frame starts
+	 * with the type (1 byte), the panel ID (2 bytes) and the port (2 bytes).
+	 * Then follows:
+	 *
+	 *    WB_ON, WB_OFF     channel (2 bytes)
+	 *    WB_LEVEL_INT      level (2 bytes), value (signed, 4 bytes)
+	 *    WB_LEVEL_FLOAT    level (2 bytes), value (IEEE 754 double, 8 bytes)
+	 *    WB_COMMAND        the command as UTF-8 up to the end of the frame
+	 *
+	 * All other messages are still sent as text.
+	 *
+	 * A browser which asked for "PROTO:BATCH" may get several frames in one
+	 * WB_BATCH frame. It has only the type byte, then follow the frames, each
+	 * as length (2 bytes) and frame. Several text messages are sent as a
+	 * JSON array of strings.
+	 */
+	enum WS_BIN_TYPE
+	{
+		WB_ON = 1,
+		WB_OFF,
+		WB_LEVEL_INT,
+		WB_LEVEL_FLOAT,
+		WB_COMMAND,
+		WB_BATCH
+	};
+
+	class WsFrame
+	{
+		public:
+			static void channel(std::string& buf, WS_BIN_TYPE type, int panel, int port, int channel);
+			static void level(std::string& buf, int panel, int port, int level, int32_t value);
+			static void level(std::string& buf, int panel, int port, int level, double value);
+			static void command(std::string& buf, int panel, int port, const std::string& cmd);
+			static void batch(std::string& buf, const std::vector<std::string>& frames);
+			static void batchText(std::string& buf, const std::vector<std::string>& msgs);
+
+		private:
+			static void header(std::string& buf, WS_BIN_TYPE type, int panel, int port);
+			static void put16(std::string& buf, uint16_t v);
+			static void put32(std::string& buf, uint32_t v);
+			static void put64(std::string& buf, uint64_t v);
+	};
+}
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libxml/xmlIO.h>
+#include "syslog.h"
+#include "nameformat.h"
+#include "trace.h"
+#include "xmlinput.h"
+
+#define XML_SCHEME		"cp1250:"
+#define XML_SCHEME_LEN	7
+
+extern Syslog *sysl;
+
+using namespace std;
+using namespace amx;
+
+string XmlInput::getUri(const string& file)
+{
+	DECL_TRACER("XmlInput::getUri(const string& file)");
+
+	init();
+	return string(XML_SCHEME)+file;
+}
+
+void XmlInput::init()
+{
+	static std::once_flag registered;
+
+	std::call_once(registered, []
+	{
+		if (xmlRegisterInputCallbacks(XmlInput::match, XmlInput::open, XmlInput::read, XmlInput::close) < 0)
+			sysl->errlog("XmlInput::init: Error registering the input handler!");
+	});
+}
+
+int XmlInput::match(const char *uri)
+{
+	if (uri && strncmp(uri, XML_SCHEME, XML_SCHEME_LEN) == 0)
+		return 1;
+
+	return 0;
+}
+
+void *XmlInput::open(const char *uri)
+{
+	DECL_TRACER("XmlInput::open(const char *uri)");
+
+	const char *fname = uri + XML_SCHEME_LEN;
+	struct stat st;
+	int fd = ::open(fname, O_RDONLY);
+
+	if (fd < 0)
+	{
+		sysl->errlog(string("XmlInput::open: Error opening the file ")+fname+": "+strerror(errno));
+		return nullptr;
+	}
+
+	if (fstat(fd, &st) < 0)
+	{
+		sysl->errlog(string("XmlInput::open: Error reading the size of file ")+fname+": "+strerror(errno));
+		::close(fd);
+		return nullptr;
+	}
+
+	XML_INPUT *ctx = new XML_INPUT;
+	ctx->fd = fd;
+	ctx->size = (size_t)st.st_size;
+
+	if (ctx->size > 0)
+	{
+		void *map = mmap(nullptr, ctx->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (map == MAP_FAILED)
+		{
+			sysl->errlog(string("XmlInput::open: Error mapping the file ")+fname+": "+strerror(errno));
+			::close(fd);
+			delete ctx;
+			return nullptr;
+		}
+
+		madvise(map, ctx->size, MADV_SEQUENTIAL);
+		ctx->data = (const unsigned char *)map;
+	}
+
+	TRACER("XmlInput::open: Mapped "+to_string(ctx->size)+" bytes of file "+fname);
+	return ctx;
+}
+
+/*
+ * Delivers the next chunk of the file converted to UTF-8. A character is
+ * never split, except the buffer is smaller than the UTF-8 sequence. In
+ * this case the rest is kept and delivered with the next call.
+ */
+int XmlInput::read(void *context, char *buffer, int len)
+{
+	XML_INPUT *ctx = (XML_INPUT *)context;
+
+	if (!ctx || len <= 0)
+		return -1;
+
+	int written = 0;
+
+	while (ctx->pendPos < ctx->pendLen && written < len)
+		buffer[written++] = ctx->pending[ctx->pendPos++];
+
+	while (written < len && ctx->pos < ctx->size)
+	{
+		unsigned char ch = ctx->data[ctx->pos];
+
+		if (ch < 0x80)		// Plain ASCII is the most common case
+		{
+			buffer[written++] = ch;
+			ctx->pos++;
+			continue;
+		}
+
+		char utf[4];
+		int n = NameFormat::cp1250ToUTF8(ch, utf);
+
+		if (written + n > len)
+		{
+			if (written > 0)
+				break;
+
+			// The buffer is too small for even one character
+			memcpy(ctx->pending, utf, n);
+			ctx->pendLen = n;
+			ctx->pendPos = 0;
+			ctx->pos++;
+
+			while (ctx->pendPos < ctx->pendLen && written < len)
+				buffer[written++] = ctx->pending[ctx->pendPos++];
+
+			break;
+		}
+
+		memcpy(buffer + written, utf, n);
+		written += n;
+		ctx->pos++;
+	}
+
+	return written;
+}
+
+int XmlInput::close(void *context)
+{
+	DECL_TRACER("XmlInput::close(void *context)");
+
+	XML_INPUT *ctx = (XML_INPUT *)context;
+
+	if (!ctx)
+		return -1;
+
+	if (ctx->data)
+		munmap((void *)ctx->data, ctx->size);
+
+	if (ctx->fd >= 0)
+		::close(ctx->fd);
+
+	delete ctx;
+	return 0;
+}
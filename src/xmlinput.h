@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __XMLINPUT_H__
+#define __XMLINPUT_H__
+
+#include <string>
+
+namespace amx
+{
+	/*
+	 * The files written by TPDesign4 are encoded in the Windows code page,
+	 * no matter what the XML header says. This class registers an input
+	 * handler with libxml2 for the pseudo scheme "cp1250:". A file opened
+	 * this way is mapped into memory and converted to UTF-8 chunk by chunk
+	 * while the parser reads it. There is no copy of the whole file.
+	 *
+	 * Usage:
+	 *    xmlpp::TextReader reader(XmlInput::getUri(fileName));
+	 */
+	class XmlInput
+	{
+		public:
+			static std::string getUri(const std::string& file);
+
+		private:
+			typedef struct XML_INPUT
+			{
+				int fd{-1};
+				const unsigned char *data{nullptr};	// The mapped file
+				size_t size{0};						// Size of the file
+				size_t pos{0};						// Next byte to convert
+				char pending[4];					// Rest of a character not delivered yet
+				size_t pendLen{0};
+				size_t pendPos{0};
+			}XML_INPUT;
+
+			static void init();
+			static int match(const char *uri);
+			static void *open(const char *uri);
+			static int read(void *context, char *buffer, int len);
+			static int close(void *context);
+	};
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2018 by Andreas Theofilu <andreas@theosys.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#ifndef __XMLTAGS_H__
+#define __XMLTAGS_H__
+
+#include <string>
+#include <cstdint>
+
+/*
+ * Dispatching of XML element names.
+ *
+ * The name of an element is converted into a case insensitive 64 bit hash
+ * (FNV-1a). Because the hash function is "constexpr", the same hash can be
+ * calculated at compile time for the known names. This allows to write
+ *
+ *    switch (tagHash(name))
+ *    {
+ *        case "pageID"_tag: ...
+ *    }
+ *
+ * instead of long chains of Str::caseCompare(). The compiler refuses two
+ * case labels with the same value, so the known names of one switch are
+ * guaranteed to be free of collisions.
+ */
+namespace amx
+{
+	typedef uint64_t XMLTAG;
+
+	constexpr XMLTAG tagHash(const char *str, size_t len)
+	{
+		XMLTAG h = 14695981039346656037ULL;
+
+		for (size_t i = 0; i < len; i++)
+		{
+			unsigned char ch = (unsigned char)str[i];
+
+			if (ch >= 'A' && ch <= 'Z')
+				ch += 'a' - 'A';
+
+			h ^= ch;
+			h *= 1099511628211ULL;
+		}
+
+		return h;
+	}
+
+	inline XMLTAG tagHash(const std::string& str)
+	{
+		return tagHash(str.c_str(), str.length());
+	}
+
+	constexpr XMLTAG operator "" _tag(const char *str, size_t len)
+	{
+		return tagHash(str, len);
+	}
+}
+
+#endif